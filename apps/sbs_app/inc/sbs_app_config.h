@@ -52,6 +52,9 @@
 
 #endif
 
+/* Input, H1 to H5 and the output layer of the MNIST topology */
+#define SBS_APP_LAYERS           7
+
 // EUNUMERATIONS ---------------------------------------------------------------
 
 // DECLARATIONS ----------------------------------------------------------------
@@ -75,13 +75,16 @@ Result SnnApp_run(void)
 {
   NeuronState * output_vector;
   uint16_t output_vector_size;
+  SbsLayerMemory layer_memory[SBS_APP_LAYERS];
+  size_t pool_size;
+  int layer;
 
   /*********************/
   // ********** Create SBS Neural Network **********
   printf("\n==========  SbS Neural Network  ===============\n");
   printf("\n==========  MNIST example  ====================\n");
 
-  SbsNetwork * network = sbs_new.Network();
+  SbsNetwork * network = sbs_new.Network(NULL);
 
   // Instantiate SBS Network objects
 
@@ -137,6 +140,14 @@ Result SnnApp_run(void)
   HY->giveWeights(HY, P_H5_HY);
   network->giveLayer(network, HY);
 
+  if ((P_IN_H1 == NULL) || (P_H1_H2 == NULL) || (P_H2_H3 == NULL)
+      || (P_H3_H4 == NULL) || (P_H4_H5 == NULL) || (P_H5_HY == NULL))
+  {
+    printf("\n Unable to load the weights\n");
+    network->delete(&network);
+    return ERROR;
+  }
+
     // Perform Network load pattern and update cycle
   network->loadInput(network, SBS_INPUT_PATTERN_FILE);
   network->updateCycle(network, 1000);
@@ -156,13 +167,23 @@ Result SnnApp_run(void)
     printf(" [ %d ] = %.6f\n", output_vector_size, h);
   }
 
+  printf("\n==========  Layer memory  =====================\n");
+
+  pool_size = network->getMemoryReport(network, layer_memory, SBS_APP_LAYERS);
+
+  printf("\n Layer      State   Spikes    Weights    Arena    Heap\n");
+
+  for (layer = 0; layer < SBS_APP_LAYERS; layer ++)
+    printf(" %5d %10lu %8lu %10lu %8lu %7lu\n", layer,
+           (unsigned long) layer_memory[layer].state_bytes,
+           (unsigned long) layer_memory[layer].spike_bytes,
+           (unsigned long) layer_memory[layer].weight_bytes,
+           (unsigned long) layer_memory[layer].arena_bytes,
+           (unsigned long) layer_memory[layer].heap_bytes);
+
   printf("\n===============================================\n");
 
-#ifdef USE_XILINX
-  printf("\n Pool size: %d \n", network->getMemorySize(network));
-#else
-  printf("\n Pool size: %ld \n", network->getMemorySize(network));
-#endif
+  printf("\n Pool size: %lu \n", (unsigned long) pool_size);
 
   network->delete(&network);
 
@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_benchmark.h
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network benchmark application (host only)
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ */
+//------------------------------------------------------------------------------
+
+// IFNDEF ----------------------------------------------------------------------
+#ifndef SBS_BENCHMARK_H_
+#define SBS_BENCHMARK_H_
+
+// INCLUDES --------------------------------------------------------------------
+#include "stdint.h"
+#include "stddef.h"
+
+#include "sbs_benchmark_config.h"
+
+#include "result.h"
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// DECLARATIONS ----------------------------------------------------------------
+
+typedef struct
+{
+  Result  (* initialize)(void);
+  Result  (* run)(void);
+  void    (* dispose)(void);
+} SbsBenchmark;
+
+SbsBenchmark * SbsBenchmark_instance(void);
+#endif /* SBS_BENCHMARK_H_ */
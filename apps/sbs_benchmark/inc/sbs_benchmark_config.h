@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_benchmark_config.h
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network benchmark application
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ */
+//------------------------------------------------------------------------------
+// IFNDEF ----------------------------------------------------------------------
+#ifndef SBS_BENCHMARK_CONFIG_H_
+#define SBS_BENCHMARK_CONFIG_H_
+
+// INCLUDES --------------------------------------------------------------------
+
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_INPUT_PATTERN_FORMAT "MNIST/Pattern/Input_%d.bin"
+
+#define SBS_P_IN_H1_WEIGHTS_FILE "MNIST/W_X_H1.bin"
+#define SBS_P_H1_H2_WEIGHTS_FILE "MNIST/W_H1_H2.bin"
+#define SBS_P_H2_H3_WEIGHTS_FILE "MNIST/W_H2_H3.bin"
+#define SBS_P_H3_H4_WEIGHTS_FILE "MNIST/W_H3_H4.bin"
+#define SBS_P_H4_H5_WEIGHTS_FILE "MNIST/W_H4_H5.bin"
+#define SBS_P_H5_HY_WEIGHTS_FILE "MNIST/W_H5_HY.bin"
+
+#define SBS_BENCHMARK_MEMORY_SIZE (1 << 20) /* Context arena, layer states only */
+
+#define SBS_BENCHMARK_PATTERNS   10
+#define SBS_BENCHMARK_CYCLES     1000
+#define SBS_BENCHMARK_CHECK_CYCLES 10   /* Convergence sampling period */
+#define SBS_BENCHMARK_PRUNE_THRESHOLD 1e-3f /* Sparse weights of the update order runs */
+#define SBS_BENCHMARK_FRAMES     2      /* Consecutive presentations per pattern */
+#define SBS_BENCHMARK_INSTANCES  4      /* Networks sharing one set of weights */
+#define SBS_BENCHMARK_CHAINS     4      /* Largest ensemble, doubling from 1 */
+#define SBS_BENCHMARK_WORKERS    4      /* Most accelerator workers, doubling from 1 */
+#define SBS_BENCHMARK_QUEUE_DEPTH 8     /* Accelerator descriptor queue */
+#define SBS_BENCHMARK_SD_LATENCY 100e-6 /* Emulated SD card: seconds per f_read() */
+#define SBS_BENCHMARK_SD_BANDWIDTH 20e6 /* Emulated SD card: bytes per second */
+#define SBS_BENCHMARK_TRACE_FILE "sbs_benchmark_trace.bin"
+#define SBS_BENCHMARK_TRACE_BUFFER (1 << 20) /* Spike trace ring buffer */
+#define SBS_BENCHMARK_TELEMETRY_FILE "sbs_benchmark_telemetry.json"
+#define SBS_BENCHMARK_PROFILE_RANGE 250 /* Cycles per profiler range */
+#define SBS_BENCHMARK_SCALE_WEIGHTS_FORMAT "sbs_benchmark_scale_W%d.bin" /* Synthetic weights */
+#define SBS_BENCHMARK_SCALE_CYCLES 100
+#define SBS_BENCHMARK_SCALE_MEMORY_SIZE (256 << 10) /* Arena of the scale topologies, the rest spills to the heap */
+#define SBS_BENCHMARK_SCALE_FC_NEURONS 256 /* Wide topology: 76800 x 256 weights, 75 MB */
+#define SBS_BENCHMARK_SCALE_DEPTH 300   /* Deep topology: hidden layers */
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// DECLARATIONS ----------------------------------------------------------------
+
+#endif /* SBS_BENCHMARK_CONFIG_H_ */
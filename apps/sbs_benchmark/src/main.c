@@ -0,0 +1,24 @@
+#include "sbs_benchmark.h"
+
+int main(void)
+{
+  Result rc;
+
+  SbsBenchmark * benchmark = SbsBenchmark_instance();
+
+  rc = (benchmark != NULL)? OK: ERROR;
+
+  if (rc == OK)
+  {
+    rc = benchmark->initialize();
+
+    if (rc == OK)
+    {
+      rc = benchmark->run();
+    }
+
+    benchmark->dispose();
+  }
+
+  return rc;
+}
@@ -0,0 +1,1124 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_benchmark.c
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network benchmark application (host only)
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ *
+ */
+//------------------------------------------------------------------------------
+// INCLUDES --------------------------------------------------------------------
+#include "sbs_neural_network.h"
+#include "sbs_profiler.h"
+#include "sbs_benchmark.h"
+#include "buffered_file.h"
+#include "ff_posix.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_BENCHMARK_LAYERS  7
+#define SBS_BENCHMARK_CLASSES 10
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// STRUCTS AND NAMESPACES ------------------------------------------------------
+
+typedef struct
+{
+  double   time;
+  uint16_t correct;
+  uint8_t  output[SBS_BENCHMARK_PATTERNS];
+  float    output_vector[SBS_BENCHMARK_PATTERNS][SBS_BENCHMARK_CLASSES];
+} SbsBenchmarkResult;
+
+typedef struct
+{
+  SbsContext * context;
+  SbsNetwork * network;
+  SbsLayer *   layer[SBS_BENCHMARK_LAYERS];
+  size_t       weight_size[SBS_BENCHMARK_LAYERS];
+} SbsBenchmarkModel;
+
+// DEFINITIONs -----------------------------------------------------------------
+
+static SbsBenchmarkModel  SbsBenchmark_model;
+static SbsBenchmarkResult SbsBenchmark_reference;
+
+static double SbsBenchmark_now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+/* NULL when the weight file could not be loaded, the layer is given anyway */
+static SbsLayer * SbsBenchmark_giveLayer(SbsNetwork * network, SbsLayer * layer, float epsilon,
+                                         uint16_t weight_rows, uint16_t weight_columns,
+                                         char * weight_file, size_t * weight_size)
+{
+  SbsWeightMatrix weights = NULL;
+
+  if (weight_file != NULL)
+  {
+    weights = sbs_new.WeightMatrix(weight_rows, weight_columns, weight_file);
+
+    layer->setEpsilon(layer, epsilon);
+
+    if (weights != NULL)
+      layer->giveWeights(layer, weights);
+    else
+      printf("\n Unable to load %s\n", weight_file);
+
+    *weight_size = (size_t) weight_rows * weight_columns * sizeof(float);
+  }
+
+  network->giveLayer(network, layer);
+
+  return ((weight_file == NULL) || (weights != NULL)) ? layer : NULL;
+}
+
+/* MNIST topology, see sbs_app.c. NULL when a weight file could not be loaded */
+static SbsNetwork * SbsBenchmark_newNetwork(SbsContext * context,
+                                            SbsLayer *   layer[SBS_BENCHMARK_LAYERS],
+                                            size_t       weight_size[SBS_BENCHMARK_LAYERS])
+{
+  SbsNetwork * network = sbs_new.Network(context);
+  int          i;
+
+  layer[0] = SbsBenchmark_giveLayer(network, sbs_new.InputLayer(24, 24, 50),
+                                    0.0f, 0, 0, NULL, &weight_size[0]);
+
+  layer[1] = SbsBenchmark_giveLayer(network, sbs_new.ConvolutionLayer(24, 24, 32, 1, ROW_SHIFT, 50),
+                                    0.1, 2 * 5 * 5, 32, SBS_P_IN_H1_WEIGHTS_FILE, &weight_size[1]);
+
+  layer[2] = SbsBenchmark_giveLayer(network, sbs_new.PoolingLayer(12, 12, 32, 2, COLUMN_SHIFT, 32),
+                                    0.1 / 4.0, 32 * 2 * 2, 32, SBS_P_H1_H2_WEIGHTS_FILE, &weight_size[2]);
+
+  layer[3] = SbsBenchmark_giveLayer(network, sbs_new.ConvolutionLayer(8, 8, 64, 5, COLUMN_SHIFT, 32),
+                                    0.1 / 25.0, 32 * 5 * 5, 64, SBS_P_H2_H3_WEIGHTS_FILE, &weight_size[3]);
+
+  layer[4] = SbsBenchmark_giveLayer(network, sbs_new.PoolingLayer(4, 4, 64, 2, COLUMN_SHIFT, 64),
+                                    0.1 / 4.0, 64 * 2 * 2, 64, SBS_P_H3_H4_WEIGHTS_FILE, &weight_size[4]);
+
+  layer[5] = SbsBenchmark_giveLayer(network, sbs_new.FullyConnectedLayer(1024, 4, ROW_SHIFT, 64),
+                                    0.1 / 16.0, 64 * 4 * 4, 1024, SBS_P_H4_H5_WEIGHTS_FILE, &weight_size[5]);
+
+  layer[6] = SbsBenchmark_giveLayer(network, sbs_new.OutputLayer(10, ROW_SHIFT, 0),
+                                    0.1, 1024, 10, SBS_P_H5_HY_WEIGHTS_FILE, &weight_size[6]);
+
+  for (i = 0; i < SBS_BENCHMARK_LAYERS; i ++)
+    if (layer[i] == NULL)
+    {
+      network->delete(&network);
+      break;
+    }
+
+  return network;
+}
+
+static void SbsBenchmark_runPatterns(SbsBenchmarkResult * result)
+{
+  SbsNetwork * network = SbsBenchmark_model.network;
+  char         file_name[80];
+  NeuronState * output_vector;
+  uint16_t      output_vector_size;
+  double        start;
+  int           pattern;
+
+  memset(result, 0x00, sizeof(SbsBenchmarkResult));
+
+  SbsBenchmark_model.context->seed(SbsBenchmark_model.context, 666); /* Same spike sequence for every run */
+
+  for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+  {
+    sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, pattern + 1);
+    network->loadInput(network, file_name);
+
+    start = SbsBenchmark_now();
+    network->updateCycle(network, SBS_BENCHMARK_CYCLES);
+    result->time += SbsBenchmark_now() - start;
+
+    result->output[pattern] = network->getInferredOutput(network);
+    result->correct += (result->output[pattern] == network->getInputLabel(network));
+
+    network->getOutputVector(network, &output_vector, &output_vector_size);
+
+    while (output_vector_size --)
+    {
+      NeuronState h = output_vector[output_vector_size]; /* Ensure data alignment */
+      if (output_vector_size < SBS_BENCHMARK_CLASSES)
+        result->output_vector[pattern][output_vector_size] = h;
+    }
+  }
+}
+
+static void SbsBenchmark_printResult(char * name, SbsBenchmarkResult * result)
+{
+  SbsBenchmarkResult * reference = &SbsBenchmark_reference;
+  uint16_t agreement = 0;
+  double   distance = 0.0;
+  int      pattern;
+  int      i;
+
+  for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+  {
+    agreement += (result->output[pattern] == reference->output[pattern]);
+    for (i = 0; i < SBS_BENCHMARK_CLASSES; i ++)
+    {
+      double difference = result->output_vector[pattern][i] - reference->output_vector[pattern][i];
+      distance += (difference < 0) ? -difference : difference;
+    }
+  }
+
+  printf(" %-24s %9.3f ms/pattern  %6.2fx  accuracy %3d/%d  agreement %3d/%d  L1 %.6f\n",
+         name,
+         1e3 * result->time / SBS_BENCHMARK_PATTERNS,
+         reference->time / result->time,
+         result->correct, SBS_BENCHMARK_PATTERNS,
+         agreement, SBS_BENCHMARK_PATTERNS,
+         distance / SBS_BENCHMARK_PATTERNS);
+}
+
+/* Returns the sparse weight bytes, 0 when 'threshold' < 0 restores the dense weights */
+static size_t SbsBenchmark_pruneAll(float threshold)
+{
+  size_t size = 0;
+  int    i;
+  for (i = 1; i < SBS_BENCHMARK_LAYERS; i ++)
+    size += SbsBenchmark_model.layer[i]->pruneWeights(SbsBenchmark_model.layer[i], threshold);
+  return size;
+}
+
+static size_t SbsBenchmark_denseSize(void)
+{
+  size_t size = 0;
+  int    i;
+  for (i = 1; i < SBS_BENCHMARK_LAYERS; i ++)
+    size += SbsBenchmark_model.weight_size[i];
+  return size;
+}
+
+static void SbsBenchmark_sparseWeights(void)
+{
+  static const float threshold_list[] = { 1e-4f, 1e-3f, 1e-2f };
+  SbsBenchmarkResult result;
+  char               name[40];
+  size_t             dense_size;
+  size_t             sparse_size;
+  unsigned int       t;
+
+  printf("\n==========  Sparse weights  ===================\n");
+
+  for (t = 0; t < sizeof(threshold_list) / sizeof(float); t ++)
+  {
+    dense_size  = SbsBenchmark_denseSize();
+    sparse_size = SbsBenchmark_pruneAll(threshold_list[t]);
+
+    SbsBenchmark_runPatterns(&result);
+
+    sprintf(name, "threshold %g", threshold_list[t]);
+    SbsBenchmark_printResult(name, &result);
+    printf(" %-24s %9lu bytes (dense %lu bytes, %.1f%%)\n", "", (unsigned long) sparse_size,
+           (unsigned long) dense_size, 100.0 * sparse_size / dense_size);
+  }
+
+  SbsBenchmark_pruneAll(-1.0f);
+}
+
+static void SbsBenchmark_setUpdateOrder(UpdateOrder update_order)
+{
+  int i;
+  for (i = 1; i < SBS_BENCHMARK_LAYERS; i ++)
+    SbsBenchmark_model.layer[i]->setUpdateOrder(SbsBenchmark_model.layer[i], update_order);
+}
+
+static void SbsBenchmark_updateOrder(void)
+{
+  SbsBenchmarkResult result;
+  size_t             sparse_size;
+
+  printf("\n==========  Update order  =====================\n");
+
+  SbsBenchmark_setUpdateOrder(WEIGHT_ROW_ORDER);
+  SbsBenchmark_runPatterns(&result);
+  SbsBenchmark_printResult("weight row order", &result);
+
+  sparse_size = SbsBenchmark_pruneAll(SBS_BENCHMARK_PRUNE_THRESHOLD);
+  SbsBenchmark_runPatterns(&result);
+  SbsBenchmark_printResult("weight row order, sparse", &result);
+  printf(" %-24s %9lu bytes (dense %lu bytes, threshold %g)\n", "", (unsigned long) sparse_size,
+         (unsigned long) SbsBenchmark_denseSize(), SBS_BENCHMARK_PRUNE_THRESHOLD);
+  SbsBenchmark_pruneAll(-1.0f);
+
+  SbsBenchmark_setUpdateOrder(WINDOW_ORDER);
+  SbsBenchmark_runPatterns(&result);
+  SbsBenchmark_printResult("window order (fused)", &result);
+
+  SbsBenchmark_setUpdateOrder(RASTER_ORDER);
+}
+
+static void SbsBenchmark_setStateLayout(StateLayout layout)
+{
+  int i;
+  for (i = 0; i < SBS_BENCHMARK_LAYERS; i ++)
+    SbsBenchmark_model.layer[i]->setStateLayout(SbsBenchmark_model.layer[i], layout);
+}
+
+static void SbsBenchmark_layout(void)
+{
+  static const uint16_t tile_list[] = { 2, 4, 8 };
+  SbsContext *       context = SbsBenchmark_model.context;
+  SbsBenchmarkResult result;
+  char               name[32];
+  size_t             t;
+
+  printf("\n==========  Tiles and layout  =================\n");
+
+  for (t = 0; t < sizeof(tile_list) / sizeof(uint16_t); t ++)
+  {
+    context->setOption(context, UPDATE_TILE, tile_list[t]);
+    SbsBenchmark_runPatterns(&result);
+    sprintf(name, "tiles %ux%u", tile_list[t], tile_list[t]);
+    SbsBenchmark_printResult(name, &result);
+  }
+
+  context->setOption(context, UPDATE_TILE, 0);
+
+  SbsBenchmark_setStateLayout(NEURON_MAJOR);
+  SbsBenchmark_runPatterns(&result);
+  SbsBenchmark_printResult("neuron-major states", &result);
+  SbsBenchmark_setStateLayout(POSITION_MAJOR);
+}
+
+static void SbsBenchmark_setSparseState(float threshold, uint16_t top_k)
+{
+  int i;
+  for (i = 1; i < SBS_BENCHMARK_LAYERS; i ++)
+    SbsBenchmark_model.layer[i]->setSparseState(SbsBenchmark_model.layer[i], threshold, top_k);
+}
+
+static void SbsBenchmark_sparseState(void)
+{
+  static const struct
+  {
+    float    threshold;
+    uint16_t top_k;
+  } mode_list[] = { { 1e-6f, 0 }, { 1e-4f, 0 }, { 1e-3f, 8 }, { 1e-2f, 4 } };
+  SbsBenchmarkResult result;
+  char               name[40];
+  unsigned int       m;
+
+  printf("\n==========  Sparse state  =====================\n");
+
+  for (m = 0; m < sizeof(mode_list) / sizeof(mode_list[0]); m ++)
+  {
+    SbsBenchmark_setSparseState(mode_list[m].threshold, mode_list[m].top_k);
+    SbsBenchmark_runPatterns(&result);
+
+    if (mode_list[m].top_k)
+      sprintf(name, "top %d, mass %g", mode_list[m].top_k, mode_list[m].threshold);
+    else
+      sprintf(name, "threshold %g", mode_list[m].threshold);
+    SbsBenchmark_printResult(name, &result);
+  }
+
+  SbsBenchmark_setSparseState(-1.0f, 0);
+}
+
+/* Mean number of cycles after which the inferred output no longer changes,
+ * sampled every SBS_BENCHMARK_CHECK_CYCLES. Each pattern is presented
+ * SBS_BENCHMARK_FRAMES times in a row, as similar consecutive inputs */
+static double SbsBenchmark_convergenceCycles(float blend, double * time)
+{
+  SbsNetwork * network = SbsBenchmark_model.network;
+  uint8_t      output[SBS_BENCHMARK_CYCLES / SBS_BENCHMARK_CHECK_CYCLES];
+  char         file_name[80];
+  double       cycles = 0.0;
+  double       start;
+  int          checks;
+  int          check;
+  int          pattern;
+  int          frame;
+
+  SbsBenchmark_model.context->seed(SbsBenchmark_model.context, 666); /* Same spike sequence for every run */
+  network->setWarmStart(network, blend);
+  *time = 0.0;
+
+  for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+  {
+    sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, pattern + 1);
+
+    for (frame = 0; frame < SBS_BENCHMARK_FRAMES; frame ++)
+    {
+      network->loadInput(network, file_name);
+
+      start = SbsBenchmark_now();
+      network->reset(network);
+
+      for (checks = 0; checks < SBS_BENCHMARK_CYCLES / SBS_BENCHMARK_CHECK_CYCLES; checks ++)
+      {
+        network->step(network, SBS_BENCHMARK_CHECK_CYCLES);
+        output[checks] = network->getInferredOutput(network);
+      }
+      *time += SbsBenchmark_now() - start;
+
+      for (check = checks - 1; (0 < check) && (output[check - 1] == output[checks - 1]); check --);
+
+      cycles += (check + 1) * SBS_BENCHMARK_CHECK_CYCLES;
+    }
+  }
+
+  network->setWarmStart(network, 0.0f);
+
+  return cycles / (SBS_BENCHMARK_PATTERNS * SBS_BENCHMARK_FRAMES);
+}
+
+static void SbsBenchmark_warmStart(void)
+{
+  static const float blend_list[] = { 0.0f, 0.5f, 0.9f, 1.0f };
+  double       cycles;
+  double       time;
+  unsigned int b;
+
+  printf("\n==========  Warm start  =======================\n");
+
+  for (b = 0; b < sizeof(blend_list) / sizeof(float); b ++)
+  {
+    /* Cold reset, so every blend starts from the same states */
+    SbsBenchmark_model.network->reset(SbsBenchmark_model.network);
+
+    cycles = SbsBenchmark_convergenceCycles(blend_list[b], &time);
+
+    printf(" %s blend %.2f %9.3f ms/pattern  converged after %7.1f cycles\n",
+           (blend_list[b] == 0.0f) ? "cold" : "warm", blend_list[b],
+           1e3 * time / (SBS_BENCHMARK_PATTERNS * SBS_BENCHMARK_FRAMES), cycles);
+  }
+}
+
+/* Networks on their own contexts attached to the same weight matrices */
+static void SbsBenchmark_sharedWeights(void)
+{
+  SbsContext * context[SBS_BENCHMARK_INSTANCES];
+  SbsNetwork * network[SBS_BENCHMARK_INSTANCES];
+  SbsLayer *   layer[SBS_BENCHMARK_LAYERS];
+  size_t       weight_size[SBS_BENCHMARK_LAYERS] = { 0 };
+  size_t       state_size = 0;
+  size_t       weights = 0;
+  int          i;
+
+  printf("\n==========  Shared weights  ===================\n");
+
+  for (i = 0; i < SBS_BENCHMARK_INSTANCES; i ++)
+  {
+    context[i] = sbs_new.Context(SBS_BENCHMARK_MEMORY_SIZE, 666);
+    network[i] = SbsBenchmark_newNetwork(context[i], layer, weight_size);
+    state_size += network[i]->getMemoryReport(network[i], NULL, 0);
+  }
+
+  for (i = 0; i < SBS_BENCHMARK_LAYERS; i ++)
+    weights += weight_size[i];
+
+  printf(" %d networks: %lu bytes of states + %lu bytes of weights (%lu bytes with a copy per network)\n",
+         SBS_BENCHMARK_INSTANCES, (unsigned long) state_size, (unsigned long) weights,
+         (unsigned long) (state_size + SBS_BENCHMARK_INSTANCES * weights));
+
+  for (i = 0; i < SBS_BENCHMARK_INSTANCES; i ++)
+  {
+    network[i]->delete(&network[i]);
+    context[i]->delete(&context[i]);
+  }
+}
+
+typedef struct
+{
+  uint8_t output;
+  uint8_t label;
+} SbsBenchmarkInference;
+
+static void SbsBenchmark_complete(void * data, SbsNetwork * network)
+{
+  SbsBenchmarkInference * inference = data;
+
+  inference->output = network->getInferredOutput(network);
+  inference->label  = network->getInputLabel(network);
+}
+
+/* One thread keeps a pool of networks busy through submit(): the next input
+ * is read while the previous ones run on the library workers */
+static void SbsBenchmark_asynchronous(void)
+{
+  SbsContext *          context[SBS_BENCHMARK_INSTANCES];
+  SbsNetwork *          network[SBS_BENCHMARK_INSTANCES];
+  SbsLayer *            layer[SBS_BENCHMARK_LAYERS];
+  size_t                weight_size[SBS_BENCHMARK_LAYERS];
+  SbsBenchmarkInference inference[SBS_BENCHMARK_PATTERNS];
+  SbsBenchmarkResult    result;
+  char                  file_name[80];
+  double                start;
+  int                   instances;
+  int                   pattern;
+  int                   i;
+
+  printf("\n==========  Asynchronous  =====================\n");
+
+  for (i = 0; i < SBS_BENCHMARK_INSTANCES; i ++)
+  {
+    context[i] = sbs_new.Context(SBS_BENCHMARK_MEMORY_SIZE, 666 + i);
+    context[i]->setOption(context[i], PROGRESS_INTERVAL, 0);
+    network[i] = SbsBenchmark_newNetwork(context[i], layer, weight_size);
+  }
+
+  for (instances = 1; instances <= SBS_BENCHMARK_INSTANCES; instances *= 2)
+  {
+    memset(&result, 0x00, sizeof(result));
+    start = SbsBenchmark_now();
+
+    for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+    {
+      SbsNetwork * next = network[pattern % instances];
+
+      next->wait(next);
+      sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, pattern + 1);
+      next->loadInput(next, file_name);
+      next->submit(next, SBS_BENCHMARK_CYCLES, SbsBenchmark_complete, &inference[pattern]);
+    }
+
+    for (i = 0; i < instances; i ++)
+      network[i]->wait(network[i]);
+
+    result.time = SbsBenchmark_now() - start;
+
+    for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+    {
+      result.output[pattern] = inference[pattern].output;
+      result.correct += (inference[pattern].output == inference[pattern].label);
+    }
+
+    sprintf(file_name, "submit, %d network%s", instances, (instances == 1) ? "" : "s");
+    printf(" %-24s %9.3f ms/pattern  %6.2fx  accuracy %3d/%d\n", file_name,
+           1e3 * result.time / SBS_BENCHMARK_PATTERNS, SbsBenchmark_reference.time / result.time,
+           result.correct, SBS_BENCHMARK_PATTERNS);
+  }
+
+  for (i = 0; i < SBS_BENCHMARK_INSTANCES; i ++)
+  {
+    network[i]->delete(&network[i]);
+    context[i]->delete(&context[i]);
+  }
+}
+
+/* Cycles each sampling mode needs to reach the accuracy of the dense reference
+ * (independent draws, SBS_BENCHMARK_CYCLES cycles), checked every CHECK_CYCLES */
+static void SbsBenchmark_sampling(void)
+{
+  static const char * sampling_name[] = { "random", "R1", "Sobol", "stratified", "antithetic" };
+  SbsNetwork * network = SbsBenchmark_model.network;
+  SbsContext * context = SbsBenchmark_model.context;
+  uint16_t     correct[SBS_BENCHMARK_CYCLES / SBS_BENCHMARK_CHECK_CYCLES];
+  uint8_t      output[SBS_BENCHMARK_CYCLES / SBS_BENCHMARK_CHECK_CYCLES];
+  char         file_name[80];
+  double       time;
+  double       converged;
+  double       start;
+  int          checks = SBS_BENCHMARK_CYCLES / SBS_BENCHMARK_CHECK_CYCLES;
+  int          sampling;
+  int          pattern;
+  int          check;
+  int          target;
+
+  printf("\n==========  Sampling  =========================\n");
+  printf("\n mode         ms/pattern  accuracy  target %d/%d after  converged after\n",
+         SbsBenchmark_reference.correct, SBS_BENCHMARK_PATTERNS);
+
+  for (sampling = SAMPLING_RANDOM; sampling <= SAMPLING_ANTITHETIC; sampling ++)
+  {
+    memset(correct, 0x00, sizeof(correct));
+    time = 0.0;
+    converged = 0.0;
+
+    context->setOption(context, SAMPLING, sampling);
+    context->seed(context, 666);
+
+    for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+    {
+      sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, pattern + 1);
+      network->loadInput(network, file_name);
+
+      start = SbsBenchmark_now();
+      network->reset(network);
+
+      for (check = 0; check < checks; check ++)
+      {
+        network->step(network, SBS_BENCHMARK_CHECK_CYCLES);
+        output[check] = network->getInferredOutput(network);
+        correct[check] += (output[check] == network->getInputLabel(network));
+      }
+      time += SbsBenchmark_now() - start;
+
+      for (check = checks - 1; (0 < check) && (output[check - 1] == output[checks - 1]); check --);
+      converged += (check + 1) * SBS_BENCHMARK_CHECK_CYCLES;
+    }
+
+    for (target = 0; (target < checks) && (correct[target] < SbsBenchmark_reference.correct); target ++);
+
+    printf(" %-10s  %10.3f  %5d/%d  ", sampling_name[sampling],
+           1e3 * time / SBS_BENCHMARK_PATTERNS, correct[checks - 1], SBS_BENCHMARK_PATTERNS);
+
+    if (target < checks)
+      printf("%9d cycles", (target + 1) * SBS_BENCHMARK_CHECK_CYCLES);
+    else
+      printf("%16s", "not reached");
+
+    printf("  %8.1f cycles\n", converged / SBS_BENCHMARK_PATTERNS);
+  }
+
+  context->setOption(context, SAMPLING, SAMPLING_RANDOM);
+}
+
+/* Accuracy of the mean of parallel chains after growing cycle budgets, against
+ * wall time: shorter chains averaged vs. a single long one */
+static void SbsBenchmark_ensemble(void)
+{
+  static const uint16_t budget[] = { SBS_BENCHMARK_CYCLES / 8, SBS_BENCHMARK_CYCLES / 4,
+                                     SBS_BENCHMARK_CYCLES / 2, SBS_BENCHMARK_CYCLES };
+  SbsNetwork * network = SbsBenchmark_model.network;
+  double       time[sizeof(budget) / sizeof(budget[0])];
+  uint16_t     correct[sizeof(budget) / sizeof(budget[0])];
+  char         file_name[80];
+  double       start;
+  int          chains;
+  int          pattern;
+  unsigned int b;
+
+  printf("\n==========  Ensemble  =========================\n");
+  printf("\n chains  cycles/chain  ms/pattern  accuracy\n");
+
+  for (chains = 1; chains <= SBS_BENCHMARK_CHAINS; chains *= 2)
+  {
+    memset(time, 0x00, sizeof(time));
+    memset(correct, 0x00, sizeof(correct));
+
+    network->setEnsemble(network, chains);
+    SbsBenchmark_model.context->seed(SbsBenchmark_model.context, 666);
+
+    for (pattern = 0; pattern < SBS_BENCHMARK_PATTERNS; pattern ++)
+    {
+      sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, pattern + 1);
+      network->loadInput(network, file_name);
+
+      start = SbsBenchmark_now();
+      network->reset(network);
+
+      for (b = 0; b < sizeof(budget) / sizeof(budget[0]); b ++)
+      {
+        network->step(network, budget[b] - ((0 < b) ? budget[b - 1] : 0));
+        time[b] += SbsBenchmark_now() - start;
+        correct[b] += (network->getInferredOutput(network) == network->getInputLabel(network));
+      }
+    }
+
+    for (b = 0; b < sizeof(budget) / sizeof(budget[0]); b ++)
+      printf(" %6d  %12d  %10.3f  %3d/%d\n", chains, budget[b],
+             1e3 * time[b] / SBS_BENCHMARK_PATTERNS, correct[b], SBS_BENCHMARK_PATTERNS);
+  }
+
+  network->setEnsemble(network, 1);
+}
+
+/* Layer updates through the CPU reference device: with 0 workers submit()
+ * computes in place, which leaves the descriptor and queue overhead */
+static void SbsBenchmark_accelerator(void)
+{
+  SbsNetwork *             network = SbsBenchmark_model.network;
+  SbsBenchmarkResult       result;
+  SbsAcceleratorStatistics statistics;
+  SbsAccelerator *         device;
+  char                     name[40];
+  int                      workers;
+
+  printf("\n==========  Accelerator  ======================\n");
+
+  for (workers = 0; workers <= SBS_BENCHMARK_WORKERS; workers = (workers == 0) ? 1 : workers * 2)
+  {
+    device = SbsCpuAccelerator_new(workers, SBS_BENCHMARK_QUEUE_DEPTH);
+
+    if (device == NULL)
+      continue;
+
+    network->setAccelerator(network, device);
+    SbsBenchmark_runPatterns(&result);
+    network->setAccelerator(network, NULL);
+
+    device->getStatistics(device, &statistics);
+    device->delete(&device);
+
+    sprintf(name, "cpu device, %d worker%s", workers, (workers == 1) ? "" : "s");
+    SbsBenchmark_printResult(name, &result);
+    printf(" %-24s %9llu descriptors  %llu refused  %.1f%% busy\n", "",
+           (unsigned long long) statistics.submitted, (unsigned long long) statistics.queue_full,
+           100.0 * statistics.busy_time / (result.time * ((0 < workers) ? workers : 1)));
+  }
+}
+
+/* Every input pattern and weight file read through each backend. Block size 1
+ * sends every read to the backend, as the loaders did before. FatFs runs on
+ * the POSIX stand-in with SD card timing */
+static void SbsBenchmark_fileIO(void)
+{
+  static const char * backend_name[] = { "", "stdio", "pread", "mmap", "FatFs (SD)" };
+  static const size_t block_size[] = { 1, 4096, 64 * 1024, 1024 * 1024 };
+  static char * weight_file[] = { SBS_P_IN_H1_WEIGHTS_FILE, SBS_P_H1_H2_WEIGHTS_FILE,
+                                  SBS_P_H2_H3_WEIGHTS_FILE, SBS_P_H3_H4_WEIGHTS_FILE,
+                                  SBS_P_H4_H5_WEIGHTS_FILE, SBS_P_H5_HY_WEIGHTS_FILE };
+  SbsNetwork *           network = SbsBenchmark_model.network;
+  BufferedFileStatistics statistics;
+  BufferedFile *         file;
+  char                   file_name[80];
+  double                 input_time;
+  double                 weight_time;
+  double                 start;
+  void *                 data;
+  int                    backend;
+  int                    block;
+  int                    i;
+
+  printf("\n==========  File I/O  =========================\n");
+  printf("\n backend      block B  ms/input  reads/input  transfers/input  weights ms\n");
+
+  ff_posix_setTiming(SBS_BENCHMARK_SD_LATENCY, SBS_BENCHMARK_SD_BANDWIDTH);
+
+  for (backend = BUFFERED_FILE_STDIO; backend <= BUFFERED_FILE_FATFS; backend ++)
+    for (block = 0; block < (int) (sizeof(block_size) / sizeof(block_size[0])); block ++)
+    {
+      BufferedFile_setDefault(backend, block_size[block]);
+      BufferedFile_resetStatistics();
+
+      start = SbsBenchmark_now();
+      for (i = 0; i < SBS_BENCHMARK_PATTERNS; i ++)
+      {
+        sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, i + 1);
+        network->loadInput(network, file_name);
+      }
+      input_time = SbsBenchmark_now() - start;
+
+      BufferedFile_getStatistics(&statistics);
+
+      /* One read per matrix, as SbsWeightMatrix_load */
+      start = SbsBenchmark_now();
+      for (i = 0; i < SBS_BENCHMARK_LAYERS - 1; i ++)
+      {
+        file = BufferedFile_new(weight_file[i], BUFFERED_FILE_DEFAULT, 0);
+        if (file == NULL) continue;
+        data = malloc(SbsBenchmark_model.weight_size[i + 1]);
+        if (data != NULL)
+          BufferedFile_read(file, data, SbsBenchmark_model.weight_size[i + 1]);
+        free(data);
+        BufferedFile_delete(&file);
+      }
+      weight_time = SbsBenchmark_now() - start;
+
+      printf(" %-11s %8lu %9.3f %12.0f %16.1f %11.3f\n", backend_name[backend],
+             (unsigned long) block_size[block], 1000.0 * input_time / SBS_BENCHMARK_PATTERNS,
+             (double) statistics.reads / SBS_BENCHMARK_PATTERNS,
+             (double) statistics.transfers / SBS_BENCHMARK_PATTERNS, 1000.0 * weight_time);
+    }
+
+  ff_posix_setTiming(0.0, 0.0);
+  BufferedFile_setDefault(BUFFERED_FILE_PREAD, 0);
+}
+
+/* Every layer and cycle recorded, flushed in the background */
+static void SbsBenchmark_spikeTrace(void)
+{
+  static const char * encoding_name[] = { "raw", "delta", "packed" };
+  SbsNetwork *            network = SbsBenchmark_model.network;
+  SbsBenchmarkResult      result;
+  SbsSpikeTraceStatistics statistics;
+  SbsSpikeTrace *         trace;
+  char                    name[40];
+  int                     encoding;
+
+  printf("\n==========  Spike trace  ======================\n");
+
+  for (encoding = TRACE_RAW; encoding <= TRACE_PACKED; encoding ++)
+  {
+    trace = SbsSpikeTrace_new(SBS_BENCHMARK_TRACE_FILE, SBS_BENCHMARK_TRACE_BUFFER, encoding);
+    if (trace == NULL) continue;
+
+    network->setSpikeTrace(network, trace);
+    SbsBenchmark_runPatterns(&result);
+    network->setSpikeTrace(network, NULL);
+
+    SbsSpikeTrace_flush(trace);
+    SbsSpikeTrace_getStatistics(trace, &statistics);
+    SbsSpikeTrace_delete(&trace);
+
+    sprintf(name, "trace %s", encoding_name[encoding]);
+    SbsBenchmark_printResult(name, &result);
+    printf(" %-24s %9llu bytes (raw %llu bytes, %.1f%%), %llu stalls\n", "",
+           (unsigned long long) statistics.written_size,
+           (unsigned long long) statistics.raw_size,
+           100.0 * statistics.written_size / statistics.raw_size,
+           (unsigned long long) statistics.stalls);
+  }
+
+  remove(SBS_BENCHMARK_TRACE_FILE);
+}
+
+static void SbsBenchmark_telemetry(void)
+{
+  SbsNetwork *       network = SbsBenchmark_model.network;
+  SbsBenchmarkResult result;
+  SbsLayerTelemetry  telemetry;
+  char *             json;
+  size_t             json_size;
+  FILE *             file;
+  int                i;
+
+  printf("\n==========  Telemetry  ========================\n");
+
+  network->setTelemetry(network, TELEMETRY_UPDATES | TELEMETRY_WEIGHT_BYTES | TELEMETRY_TIME);
+  SbsBenchmark_runPatterns(&result);
+  SbsBenchmark_printResult("counters and time", &result);
+
+  network->setTelemetry(network, TELEMETRY_ALL);
+  SbsBenchmark_runPatterns(&result);
+  SbsBenchmark_printResult("all fields", &result);
+
+  printf("\n layer     updates  skipped   weight MB  entropy  state change   time ms\n");
+  for (i = 0; i < SBS_BENCHMARK_LAYERS; i ++)
+  {
+    network->getTelemetry(network, i, &telemetry);
+    printf(" %5d  %10llu  %7llu  %10.2f  %7.3f  %12.3e  %8.1f\n", i,
+           (unsigned long long) telemetry.updates,
+           (unsigned long long) telemetry.skipped_updates,
+           telemetry.weight_bytes / 1e6, telemetry.spike_entropy,
+           telemetry.state_change, 1e3 * telemetry.time);
+  }
+
+  json_size = network->getTelemetryJSON(network, NULL, 0) + 1;
+  json = malloc(json_size);
+  file = fopen(SBS_BENCHMARK_TELEMETRY_FILE, "w");
+
+  if ((json != NULL) && (file != NULL))
+  {
+    network->getTelemetryJSON(network, json, json_size);
+    fputs(json, file);
+    printf("\n Snapshot: %s\n", SBS_BENCHMARK_TELEMETRY_FILE);
+  }
+
+  if (file != NULL) fclose(file);
+  free(json);
+
+  network->setTelemetry(network, 0);
+}
+
+static void SbsBenchmark_profile(void)
+{
+  SbsNetwork *       network = SbsBenchmark_model.network;
+  SbsBenchmarkResult result;
+  SbsProfiler *      profiler;
+
+  printf("\n==========  Profile  ==========================\n");
+
+  profiler = SbsProfiler_new(SBS_BENCHMARK_LAYERS, SBS_BENCHMARK_PROFILE_RANGE,
+                             (SBS_BENCHMARK_CYCLES + SBS_BENCHMARK_PROFILE_RANGE - 1)
+                             / SBS_BENCHMARK_PROFILE_RANGE);
+  if (profiler == NULL) return;
+
+  SbsProfiler_attach(profiler, network);
+  SbsBenchmark_runPatterns(&result);
+  SbsProfiler_attach(NULL, network);
+
+  SbsBenchmark_printResult("profiled", &result);
+  SbsProfiler_print(profiler);
+
+  SbsProfiler_delete(&profiler);
+}
+
+typedef struct
+{
+  SbsContext * context;
+  SbsNetwork * network;
+  uint16_t     layers;
+  int          weight_files;
+  size_t       weight_size;
+  int          loaded;       /* 0 once a weight file could not be loaded */
+} SbsBenchmarkScaleModel;
+
+/* Positive random weights, scaled down by the rows */
+static int SbsBenchmark_writeWeights(char * file_name, uint32_t rows, uint32_t columns)
+{
+  FILE *   file = fopen(file_name, "wb");
+  float *  row = malloc(columns * sizeof(float));
+  uint32_t seed = 666;
+  uint32_t i;
+  uint32_t j;
+  int      written = (file != NULL) && (row != NULL);
+
+  for (i = 0; written && (i < rows); i ++)
+  {
+    for (j = 0; j < columns; j ++)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      row[j] = (float) ((seed >> 8) + 1) / (float) (1 << 24) / (float) rows;
+    }
+    written = (fwrite(row, sizeof(float), columns, file) == columns);
+  }
+
+  if (file != NULL) fclose(file);
+  free(row);
+
+  return written;
+}
+
+/* Note: 'shared' layers load the weight file of the previous layer again */
+static void SbsBenchmark_scaleLayer(SbsBenchmarkScaleModel * model, SbsLayer * layer, float epsilon,
+                                    uint32_t weight_rows, uint32_t weight_columns, int shared)
+{
+  char file_name[80];
+
+  if (0 < weight_rows)
+  {
+    SbsWeightMatrix weights;
+
+    if (!shared)
+    {
+      sprintf(file_name, SBS_BENCHMARK_SCALE_WEIGHTS_FORMAT, model->weight_files ++);
+      SbsBenchmark_writeWeights(file_name, weight_rows, weight_columns);
+      model->weight_size += (size_t) weight_rows * weight_columns * sizeof(float);
+    }
+    else
+      sprintf(file_name, SBS_BENCHMARK_SCALE_WEIGHTS_FORMAT, model->weight_files - 1);
+
+    weights = sbs_new.WeightMatrix(weight_rows, weight_columns, file_name);
+
+    model->loaded &= (weights != NULL);
+    layer->setEpsilon(layer, epsilon);
+
+    if (weights != NULL)
+      layer->giveWeights(layer, weights);
+  }
+
+  model->network->giveLayer(model->network, layer);
+  model->layers ++;
+}
+
+/* Topologies past the limits of the MNIST one: a CIFAR-sized input, a fully
+ * connected layer of more than 65535 weight rows (mapped from the file) and
+ * more than 255 layers sharing one weight matrix */
+static void SbsBenchmark_newScaleModel(SbsBenchmarkScaleModel * model, int topology,
+                                       uint32_t * rows, uint32_t * columns, uint16_t * neurons)
+{
+  int i;
+
+  memset(model, 0x00, sizeof(SbsBenchmarkScaleModel));
+  model->loaded = 1;
+
+  model->context = sbs_new.Context(SBS_BENCHMARK_SCALE_MEMORY_SIZE, 666);
+  model->context->setOption(model->context, PROGRESS_INTERVAL, 0);
+  model->network = sbs_new.Network(model->context);
+
+  switch (topology)
+  {
+    case 0:
+      *rows = 32; *columns = 32; *neurons = 3;
+      SbsBenchmark_scaleLayer(model, sbs_new.InputLayer(32, 32, 3), 0.0f, 0, 0, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.ConvolutionLayer(32, 32, 64, 1, ROW_SHIFT, 3),
+                              0.1, 3, 64, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.PoolingLayer(16, 16, 64, 2, COLUMN_SHIFT, 64),
+                              0.1 / 4.0, 64 * 2 * 2, 64, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.ConvolutionLayer(12, 12, 128, 5, COLUMN_SHIFT, 64),
+                              0.1 / 25.0, 64 * 5 * 5, 128, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.PoolingLayer(6, 6, 128, 2, COLUMN_SHIFT, 128),
+                              0.1 / 4.0, 128 * 2 * 2, 128, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.FullyConnectedLayer(1024, 6, ROW_SHIFT, 128),
+                              0.1 / 36.0, 128 * 6 * 6, 1024, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.OutputLayer(10, ROW_SHIFT, 0),
+                              0.1, 1024, 10, 0);
+      break;
+
+    case 1:
+      *rows = 16; *columns = 16; *neurons = 300;
+      SbsBenchmark_scaleLayer(model, sbs_new.InputLayer(16, 16, 300), 0.0f, 0, 0, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.FullyConnectedLayer(SBS_BENCHMARK_SCALE_FC_NEURONS, 16,
+                                                                 ROW_SHIFT, 300),
+                              0.1 / 256.0, 300 * 16 * 16, SBS_BENCHMARK_SCALE_FC_NEURONS, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.OutputLayer(10, ROW_SHIFT, 0),
+                              0.1, SBS_BENCHMARK_SCALE_FC_NEURONS, 10, 0);
+      break;
+
+    default:
+      *rows = 4; *columns = 4; *neurons = 16;
+      SbsBenchmark_scaleLayer(model, sbs_new.InputLayer(4, 4, 16), 0.0f, 0, 0, 0);
+      for (i = 0; i < SBS_BENCHMARK_SCALE_DEPTH; i ++)
+        SbsBenchmark_scaleLayer(model, sbs_new.ConvolutionLayer(4, 4, 16, 1, ROW_SHIFT, 16),
+                                0.1, 16, 16, 0 < i);
+      SbsBenchmark_scaleLayer(model, sbs_new.FullyConnectedLayer(16, 4, ROW_SHIFT, 16),
+                              0.1 / 16.0, 16 * 4 * 4, 16, 0);
+      SbsBenchmark_scaleLayer(model, sbs_new.OutputLayer(10, ROW_SHIFT, 0),
+                              0.1, 16, 10, 0);
+      break;
+  }
+}
+
+/* Load time includes writing the synthetic weights. Layer buffers past the
+ * arena come from the heap, large weight matrices from file mappings */
+static void SbsBenchmark_scale(void)
+{
+  static const char * topology_name[] = { "CIFAR 32x32x3", "wide FC", "deep" };
+  SbsBenchmarkScaleModel model;
+  NeuronState *          input;
+  uint32_t               rows;
+  uint32_t               columns;
+  uint16_t               neurons;
+  size_t                 input_size;
+  size_t                 n;
+  double                 load_time;
+  double                 time;
+  double                 start;
+  int                    topology;
+  int                    i;
+
+  printf("\n==========  Scale  ============================\n");
+  printf("\n topology       layers  weights KB  memory KB  load s  ms/cycle  output\n");
+
+  for (topology = 0; topology < 3; topology ++)
+  {
+    start = SbsBenchmark_now();
+    SbsBenchmark_newScaleModel(&model, topology, &rows, &columns, &neurons);
+    load_time = SbsBenchmark_now() - start;
+
+    /* Uniform populations, label 1 */
+    input_size = (size_t) rows * columns * neurons * sizeof(NeuronState) + 1;
+    input = model.loaded ? malloc(input_size) : NULL;
+
+    if (!model.loaded)
+      printf(" %-14s unable to load the weights\n", topology_name[topology]);
+    else if (input != NULL)
+    {
+      for (n = 0; n < (size_t) rows * columns * neurons; n ++)
+        input[n] = 1.0f / neurons;
+      ((uint8_t *) input)[input_size - 1] = 1;
+
+      model.network->loadInputBuffer(model.network, input, input_size);
+
+      start = SbsBenchmark_now();
+      model.network->updateCycle(model.network, SBS_BENCHMARK_SCALE_CYCLES);
+      time = SbsBenchmark_now() - start;
+
+      printf(" %-14s %6u %11lu %10lu %7.2f %9.3f %7u\n", topology_name[topology], model.layers,
+             (unsigned long) (model.weight_size / 1024),
+             (unsigned long) (model.context->getMemorySize(model.context) / 1024),
+             load_time, 1000.0 * time / SBS_BENCHMARK_SCALE_CYCLES,
+             model.network->getInferredOutput(model.network));
+    }
+
+    free(input);
+
+    model.network->delete(&model.network);
+    model.context->delete(&model.context);
+
+    for (i = 0; i < model.weight_files; i ++)
+    {
+      char file_name[80];
+      sprintf(file_name, SBS_BENCHMARK_SCALE_WEIGHTS_FORMAT, i);
+      remove(file_name);
+    }
+  }
+
+  printf("\n Context arena: %lu KB\n", (unsigned long) (SBS_BENCHMARK_SCALE_MEMORY_SIZE / 1024));
+}
+
+Result SbsBenchmark_initialize(void)
+{
+  SbsBenchmarkModel * model = &SbsBenchmark_model;
+
+  model->context = sbs_new.Context(SBS_BENCHMARK_MEMORY_SIZE, 666);
+  model->network = SbsBenchmark_newNetwork(model->context, model->layer, model->weight_size);
+
+  return (model->network != NULL) ? OK : ERROR;
+}
+
+Result SbsBenchmark_run(void)
+{
+  printf("\n==========  SbS Neural Network  ===============\n");
+  printf("\n==========  MNIST benchmark  ==================\n");
+  printf("\n Patterns: %d, cycles: %d\n", SBS_BENCHMARK_PATTERNS, SBS_BENCHMARK_CYCLES);
+
+  SbsBenchmark_model.context->setOption(SbsBenchmark_model.context, PROGRESS_INTERVAL, 0);
+
+  SbsBenchmark_runPatterns(&SbsBenchmark_reference);
+
+  printf("\n==========  Dense reference  ==================\n");
+  SbsBenchmark_printResult("dense", &SbsBenchmark_reference);
+
+  SbsBenchmark_sparseWeights();
+
+  SbsBenchmark_updateOrder();
+
+  SbsBenchmark_layout();
+
+  SbsBenchmark_sparseState();
+
+  SbsBenchmark_warmStart();
+
+  SbsBenchmark_sampling();
+
+  SbsBenchmark_sharedWeights();
+
+  SbsBenchmark_ensemble();
+
+  SbsBenchmark_accelerator();
+
+  SbsBenchmark_asynchronous();
+
+  SbsBenchmark_fileIO();
+
+  SbsBenchmark_spikeTrace();
+
+  SbsBenchmark_telemetry();
+
+  SbsBenchmark_profile();
+
+  SbsBenchmark_scale();
+
+  printf("\n===============================================\n");
+
+  return OK;
+}
+
+void SbsBenchmark_dispose(void)
+{
+  if (SbsBenchmark_model.network != NULL)
+    SbsBenchmark_model.network->delete(&SbsBenchmark_model.network);
+
+  if (SbsBenchmark_model.context != NULL)
+    SbsBenchmark_model.context->delete(&SbsBenchmark_model.context);
+}
+
+static SbsBenchmark SbsBenchmark_obj = { SbsBenchmark_initialize,
+                                         SbsBenchmark_run,
+                                         SbsBenchmark_dispose };
+
+SbsBenchmark * SbsBenchmark_instance(void)
+{
+  return & SbsBenchmark_obj;
+}
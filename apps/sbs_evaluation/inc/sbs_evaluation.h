@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_evaluation.h
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network dataset evaluation (host only)
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ */
+//------------------------------------------------------------------------------
+
+// IFNDEF ----------------------------------------------------------------------
+#ifndef SBS_EVALUATION_H_
+#define SBS_EVALUATION_H_
+
+// INCLUDES --------------------------------------------------------------------
+#include "stdint.h"
+#include "stddef.h"
+
+#include "sbs_evaluation_config.h"
+
+#include "result.h"
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// DECLARATIONS ----------------------------------------------------------------
+
+typedef struct
+{
+  Result  (* initialize)(void);
+  Result  (* run)(void);
+  void    (* dispose)(void);
+} SbsEvaluation;
+
+SbsEvaluation * SbsEvaluation_instance(void);
+#endif /* SBS_EVALUATION_H_ */
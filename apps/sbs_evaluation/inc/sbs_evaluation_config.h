@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_evaluation_config.h
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network dataset evaluation
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ */
+//------------------------------------------------------------------------------
+// IFNDEF ----------------------------------------------------------------------
+#ifndef SBS_EVALUATION_CONFIG_H_
+#define SBS_EVALUATION_CONFIG_H_
+
+// INCLUDES --------------------------------------------------------------------
+
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_INPUT_PATTERN_FORMAT   "MNIST/Pattern/Input_%d.bin"
+
+#define SBS_P_IN_H1_WEIGHTS_FILE   "MNIST/W_X_H1.bin"
+#define SBS_P_H1_H2_WEIGHTS_FILE   "MNIST/W_H1_H2.bin"
+#define SBS_P_H2_H3_WEIGHTS_FILE   "MNIST/W_H2_H3.bin"
+#define SBS_P_H3_H4_WEIGHTS_FILE   "MNIST/W_H3_H4.bin"
+#define SBS_P_H4_H5_WEIGHTS_FILE   "MNIST/W_H4_H5.bin"
+#define SBS_P_H5_HY_WEIGHTS_FILE   "MNIST/W_H5_HY.bin"
+
+#define SBS_EVALUATION_MEMORY_SIZE   (1 << 20)
+#define SBS_EVALUATION_PATTERNS      100     /* Input_1.bin .. Input_<PATTERNS>.bin */
+#define SBS_EVALUATION_WORKERS       4
+#define SBS_EVALUATION_CYCLES        1000    /* Cycle budget per pattern */
+#define SBS_EVALUATION_CHECK_CYCLES  50      /* Cycles between early exit checks */
+
+/* Accuracy-vs-cycles curve sampled at every check, written to
+ * <name>.csv, <name>_patterns.csv and <name>.json. Comment out to disable */
+#define SBS_EVALUATION_CURVE_FILE    "sbs_evaluation_curve"
+
+/* Unchanged checks to exit early, 0 = never. The curve needs every pattern
+ * run over the whole budget: an early exit would carry its output forward */
+#ifdef SBS_EVALUATION_CURVE_FILE
+#define SBS_EVALUATION_STABLE_CHECKS 0
+#else
+#define SBS_EVALUATION_STABLE_CHECKS 4
+#endif
+
+#if defined(SBS_EVALUATION_CURVE_FILE) && (SBS_EVALUATION_STABLE_CHECKS != 0)
+#error "SBS_EVALUATION_CURVE_FILE requires SBS_EVALUATION_STABLE_CHECKS 0"
+#endif
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// DECLARATIONS ----------------------------------------------------------------
+
+#endif /* SBS_EVALUATION_CONFIG_H_ */
@@ -0,0 +1,24 @@
+#include "sbs_evaluation.h"
+
+int main(void)
+{
+  Result rc;
+
+  SbsEvaluation * evaluation = SbsEvaluation_instance();
+
+  rc = (evaluation != NULL)? OK: ERROR;
+
+  if (rc == OK)
+  {
+    rc = evaluation->initialize();
+
+    if (rc == OK)
+    {
+      rc = evaluation->run();
+    }
+
+    evaluation->dispose();
+  }
+
+  return rc;
+}
@@ -0,0 +1,514 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_evaluation.c
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network dataset evaluation (host only).
+ *          Patterns are tasks on a work-stealing pool: every worker owns a
+ *          network and a deque of patterns, pops its own tasks from the
+ *          bottom and steals from the top of the others when it runs dry.
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ *
+ */
+//------------------------------------------------------------------------------
+// INCLUDES --------------------------------------------------------------------
+#include "sbs_neural_network.h"
+#include "sbs_evaluation.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "pthread.h"
+
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_EVALUATION_CLASSES 10
+#define SBS_EVALUATION_CHECKS  ((SBS_EVALUATION_CYCLES + SBS_EVALUATION_CHECK_CYCLES - 1) \
+                                / SBS_EVALUATION_CHECK_CYCLES)
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// STRUCTS AND NAMESPACES ------------------------------------------------------
+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  uint32_t *      task;
+  uint32_t        top;     /* Thieves take from here */
+  uint32_t        bottom;  /* The owner pushes and pops here */
+} SbsEvaluationDeque;
+
+typedef struct
+{
+  uint16_t           id;
+  SbsContext *       context;
+  SbsNetwork *       network;
+  SbsEvaluationDeque deque;
+  pthread_t          thread;
+  int                started;   /* The worker runs on 'thread', not inline */
+
+  uint32_t           patterns;
+  uint32_t           stolen;
+  uint64_t           cycles;
+  double             busy_time;
+} SbsEvaluationWorker;
+
+typedef struct
+{
+  uint8_t  output;
+  uint8_t  label;
+  uint16_t cycles;
+  uint8_t  failed;   /* The pattern file could not be read, counts as wrong */
+#ifdef SBS_EVALUATION_CURVE_FILE
+  uint8_t  check_output[SBS_EVALUATION_CHECKS];
+  float    check_margin[SBS_EVALUATION_CHECKS];  /* Best minus second best output */
+#endif
+} SbsEvaluationResult;
+
+typedef struct
+{
+  SbsEvaluationWorker worker[SBS_EVALUATION_WORKERS];
+  SbsEvaluationResult result[SBS_EVALUATION_PATTERNS];
+} SbsEvaluationModel;
+
+// DEFINITIONs -----------------------------------------------------------------
+
+static SbsEvaluationModel SbsEvaluation_model;
+
+static double SbsEvaluation_now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+/* Returns 0 when the weight file could not be loaded */
+static int SbsEvaluation_giveWeights(SbsLayer * layer, uint32_t rows, uint32_t columns, char * file_name)
+{
+  SbsWeightMatrix weights = sbs_new.WeightMatrix(rows, columns, file_name);
+
+  if (weights == NULL)
+    printf("\n Unable to load %s\n", file_name);
+  else
+    layer->giveWeights(layer, weights);
+
+  return (weights != NULL);
+}
+
+/* MNIST topology, see sbs_app.c. NULL when a weight file could not be loaded */
+static SbsNetwork * SbsEvaluation_newNetwork(SbsContext * context)
+{
+  SbsNetwork * network = sbs_new.Network(context);
+  SbsLayer * layer;
+  int loaded = 1;
+
+  network->giveLayer(network, sbs_new.InputLayer(24, 24, 50));
+
+  layer = sbs_new.ConvolutionLayer(24, 24, 32, 1, ROW_SHIFT, 50);
+  layer->setEpsilon(layer, 0.1);
+  loaded &= SbsEvaluation_giveWeights(layer, 2 * 5 * 5, 32, SBS_P_IN_H1_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.PoolingLayer(12, 12, 32, 2, COLUMN_SHIFT, 32);
+  layer->setEpsilon(layer, 0.1 / 4.0);
+  loaded &= SbsEvaluation_giveWeights(layer, 32 * 2 * 2, 32, SBS_P_H1_H2_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.ConvolutionLayer(8, 8, 64, 5, COLUMN_SHIFT, 32);
+  layer->setEpsilon(layer, 0.1 / 25.0);
+  loaded &= SbsEvaluation_giveWeights(layer, 32 * 5 * 5, 64, SBS_P_H2_H3_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.PoolingLayer(4, 4, 64, 2, COLUMN_SHIFT, 64);
+  layer->setEpsilon(layer, 0.1 / 4.0);
+  loaded &= SbsEvaluation_giveWeights(layer, 64 * 2 * 2, 64, SBS_P_H3_H4_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.FullyConnectedLayer(1024, 4, ROW_SHIFT, 64);
+  layer->setEpsilon(layer, 0.1 / 16.0);
+  loaded &= SbsEvaluation_giveWeights(layer, 64 * 4 * 4, 1024, SBS_P_H4_H5_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.OutputLayer(SBS_EVALUATION_CLASSES, ROW_SHIFT, 0);
+  layer->setEpsilon(layer, 0.1);
+  loaded &= SbsEvaluation_giveWeights(layer, 1024, SBS_EVALUATION_CLASSES, SBS_P_H5_HY_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  if (!loaded)
+    network->delete(&network);
+
+  return network;
+}
+
+static int SbsEvaluation_pop(SbsEvaluationDeque * deque, uint32_t * task)
+{
+  int found;
+
+  pthread_mutex_lock(&deque->mutex);
+  found = (deque->top < deque->bottom);
+  if (found)
+    *task = deque->task[-- deque->bottom];
+  pthread_mutex_unlock(&deque->mutex);
+
+  return found;
+}
+
+static int SbsEvaluation_steal(SbsEvaluationDeque * deque, uint32_t * task)
+{
+  int found;
+
+  pthread_mutex_lock(&deque->mutex);
+  found = (deque->top < deque->bottom);
+  if (found)
+    *task = deque->task[deque->top ++];
+  pthread_mutex_unlock(&deque->mutex);
+
+  return found;
+}
+
+#ifdef SBS_EVALUATION_CURVE_FILE
+static float SbsEvaluation_margin(SbsNetwork * network)
+{
+  NeuronState * output_vector;
+  uint16_t      output_vector_size;
+  float         first = 0.0f;
+  float         second = 0.0f;
+
+  network->getOutputVector(network, &output_vector, &output_vector_size);
+
+  while (output_vector_size --)
+  {
+    NeuronState h = output_vector[output_vector_size]; /* Ensure data alignment */
+    if (first < h)
+    {
+      second = first;
+      first = h;
+    }
+    else if (second < h)
+      second = h;
+  }
+
+  return first - second;
+}
+#endif
+
+/* Runs one pattern within the cycle budget. It exits early once the inferred
+ * output did not change over SBS_EVALUATION_STABLE_CHECKS checks */
+static void SbsEvaluation_runPattern(SbsEvaluationWorker * worker, uint32_t pattern)
+{
+  SbsNetwork *          network = worker->network;
+  SbsEvaluationResult * result = &SbsEvaluation_model.result[pattern];
+  char                  file_name[80];
+  uint16_t              stable = 0;
+  uint16_t              check = 0;
+  uint16_t              step;
+  uint8_t               output;
+
+  sprintf(file_name, SBS_INPUT_PATTERN_FORMAT, pattern + 1);
+
+  result->failed = !network->loadInput(network, file_name);
+
+  if (result->failed)
+  {
+    printf("\n Unable to load %s\n", file_name);
+    result->output = (uint8_t) -1;
+    return;
+  }
+
+  /* Seeded by pattern, so results do not depend on which worker runs it */
+  worker->context->seed(worker->context, 666 + pattern);
+  network->reset(network);
+
+  result->output = (uint8_t) -1;
+  result->cycles = 0;
+
+  while (result->cycles < SBS_EVALUATION_CYCLES)
+  {
+    step = SBS_EVALUATION_CYCLES - result->cycles;
+    if (SBS_EVALUATION_CHECK_CYCLES < step)
+      step = SBS_EVALUATION_CHECK_CYCLES;
+
+    network->step(network, step);
+    result->cycles += step;
+
+    output = network->getInferredOutput(network);
+    stable = (output == result->output) ? stable + 1 : 0;
+    result->output = output;
+
+#ifdef SBS_EVALUATION_CURVE_FILE
+    result->check_output[check] = output;
+    result->check_margin[check] = SbsEvaluation_margin(network);
+#endif
+    check ++;
+
+#if SBS_EVALUATION_STABLE_CHECKS
+    if (SBS_EVALUATION_STABLE_CHECKS <= stable)
+      break;
+#endif
+  }
+
+  result->label = network->getInputLabel(network);
+
+  worker->cycles += result->cycles;
+}
+
+static void * SbsEvaluation_workerThread(void * argument)
+{
+  SbsEvaluationWorker * worker = argument;
+  uint32_t              pattern;
+  uint16_t              victim;
+  int                   found;
+  double                start;
+
+  for (;;)
+  {
+    found = SbsEvaluation_pop(&worker->deque, &pattern);
+
+    for (victim = 1; !found && (victim < SBS_EVALUATION_WORKERS); victim ++)
+    {
+      found = SbsEvaluation_steal(&SbsEvaluation_model.worker[(worker->id + victim)
+                                                               % SBS_EVALUATION_WORKERS].deque,
+                                  &pattern);
+      worker->stolen += found;
+    }
+
+    /* Tasks never spawn tasks: with every deque empty the evaluation is done */
+    if (!found) break;
+
+    start = SbsEvaluation_now();
+    SbsEvaluation_runPattern(worker, pattern);
+    worker->busy_time += SbsEvaluation_now() - start;
+    worker->patterns ++;
+  }
+
+  return NULL;
+}
+
+#ifdef SBS_EVALUATION_CURVE_FILE
+static uint16_t SbsEvaluation_checkCycles(uint16_t check)
+{
+  uint32_t cycles = (check + 1) * SBS_EVALUATION_CHECK_CYCLES;
+  return (cycles < SBS_EVALUATION_CYCLES) ? cycles : SBS_EVALUATION_CYCLES;
+}
+
+/* Cycles from which on the inferred output no longer changes */
+static uint16_t SbsEvaluation_convergenceCycles(SbsEvaluationResult * result)
+{
+  uint16_t check;
+
+  for (check = SBS_EVALUATION_CHECKS - 1;
+       (0 < check) && (result->check_output[check - 1] == result->check_output[check]);
+       check --);
+
+  return SbsEvaluation_checkCycles(check);
+}
+
+static Result SbsEvaluation_saveCurve(char * name)
+{
+  SbsEvaluationResult * result = SbsEvaluation_model.result;
+  uint32_t              correct[SBS_EVALUATION_CHECKS] = { 0 };
+  double                margin[SBS_EVALUATION_CHECKS] = { 0 };
+  char                  file_name[80];
+  FILE *                csv_file;
+  FILE *                pattern_file;
+  FILE *                json_file;
+  uint32_t              pattern;
+  uint16_t              check;
+
+  for (pattern = 0; pattern < SBS_EVALUATION_PATTERNS; pattern ++)
+    for (check = 0; check < SBS_EVALUATION_CHECKS; check ++)
+    {
+      correct[check] += !result[pattern].failed
+                        && (result[pattern].check_output[check] == result[pattern].label);
+      margin[check] += result[pattern].check_margin[check];
+    }
+
+  sprintf(file_name, "%s.csv", name);
+  csv_file = fopen(file_name, "w");
+  sprintf(file_name, "%s_patterns.csv", name);
+  pattern_file = fopen(file_name, "w");
+  sprintf(file_name, "%s.json", name);
+  json_file = fopen(file_name, "w");
+
+  if ((csv_file != NULL) && (pattern_file != NULL) && (json_file != NULL))
+  {
+    fprintf(csv_file, "cycles,accuracy,mean_margin\n");
+    fprintf(json_file, "{\n  \"patterns\": %d,\n  \"curve\": [", SBS_EVALUATION_PATTERNS);
+
+    for (check = 0; check < SBS_EVALUATION_CHECKS; check ++)
+    {
+      fprintf(csv_file, "%u,%f,%f\n", SbsEvaluation_checkCycles(check),
+              (double) correct[check] / SBS_EVALUATION_PATTERNS,
+              margin[check] / SBS_EVALUATION_PATTERNS);
+      fprintf(json_file, "%s\n    {\"cycles\": %u, \"accuracy\": %f, \"mean_margin\": %f}",
+              check ? "," : "", SbsEvaluation_checkCycles(check),
+              (double) correct[check] / SBS_EVALUATION_PATTERNS,
+              margin[check] / SBS_EVALUATION_PATTERNS);
+    }
+
+    fprintf(pattern_file, "pattern,label,output,convergence_cycles,cycles\n");
+    fprintf(json_file, "\n  ],\n  \"pattern_list\": [");
+
+    for (pattern = 0; pattern < SBS_EVALUATION_PATTERNS; pattern ++)
+    {
+      fprintf(pattern_file, "%u,%d,%d,%u,%u\n", pattern + 1,
+              result[pattern].label, result[pattern].output,
+              SbsEvaluation_convergenceCycles(&result[pattern]), result[pattern].cycles);
+      fprintf(json_file, "%s\n    {\"pattern\": %u, \"label\": %d, \"output\": %d, "
+              "\"convergence_cycles\": %u, \"cycles\": %u}",
+              pattern ? "," : "", pattern + 1,
+              result[pattern].label, result[pattern].output,
+              SbsEvaluation_convergenceCycles(&result[pattern]), result[pattern].cycles);
+    }
+
+    fprintf(json_file, "\n  ]\n}\n");
+  }
+
+  if (csv_file != NULL) fclose(csv_file);
+  if (pattern_file != NULL) fclose(pattern_file);
+  if (json_file != NULL) fclose(json_file);
+
+  return ((csv_file != NULL) && (pattern_file != NULL) && (json_file != NULL)) ? OK : ERROR;
+}
+#endif
+
+static Result SbsEvaluation_initialize(void)
+{
+  Result   rc = OK;
+  uint16_t i;
+
+  for (i = 0; (rc == OK) && (i < SBS_EVALUATION_WORKERS); i ++)
+  {
+    SbsEvaluationWorker * worker = &SbsEvaluation_model.worker[i];
+
+    worker->id = i;
+    pthread_mutex_init(&worker->deque.mutex, NULL);
+    worker->deque.task = malloc(SBS_EVALUATION_PATTERNS * sizeof(uint32_t));
+
+    /* Weights are shared through the registry, states are per worker */
+    worker->context = sbs_new.Context(SBS_EVALUATION_MEMORY_SIZE, 666);
+    worker->network = (worker->context != NULL) ? SbsEvaluation_newNetwork(worker->context) : NULL;
+
+    rc = ((worker->deque.task != NULL) && (worker->network != NULL)) ? OK : ERROR;
+
+    if (rc == OK)
+      worker->context->setOption(worker->context, PROGRESS_INTERVAL, 0);
+  }
+
+  return rc;
+}
+
+static Result SbsEvaluation_run(void)
+{
+  SbsEvaluationModel * model = &SbsEvaluation_model;
+  uint32_t             correct = 0;
+  uint32_t             failed = 0;
+  uint64_t             cycles = 0;
+  uint32_t             pattern;
+  double               start;
+  double               time;
+  uint16_t             i;
+
+  printf("\n==========  SbS Neural Network  ===============\n");
+  printf("\n==========  MNIST evaluation  =================\n");
+  printf("\n Patterns: %d, workers: %d, cycle budget: %d\n",
+         SBS_EVALUATION_PATTERNS, SBS_EVALUATION_WORKERS, SBS_EVALUATION_CYCLES);
+
+  /* Contiguous blocks, so stealing only starts when a worker runs dry */
+  for (pattern = 0; pattern < SBS_EVALUATION_PATTERNS; pattern ++)
+  {
+    SbsEvaluationDeque * deque = &model->worker[(uint64_t) pattern * SBS_EVALUATION_WORKERS
+                                                / SBS_EVALUATION_PATTERNS].deque;
+    deque->task[deque->bottom ++] = SBS_EVALUATION_PATTERNS - 1 - pattern;
+  }
+
+  start = SbsEvaluation_now();
+
+  for (i = 0; i < SBS_EVALUATION_WORKERS; i ++)
+  {
+    model->worker[i].started = (pthread_create(&model->worker[i].thread, NULL,
+                                               SbsEvaluation_workerThread, &model->worker[i]) == 0);
+    if (!model->worker[i].started)
+      SbsEvaluation_workerThread(&model->worker[i]);
+  }
+
+  for (i = 0; i < SBS_EVALUATION_WORKERS; i ++)
+    if (model->worker[i].started)
+      pthread_join(model->worker[i].thread, NULL);
+
+  time = SbsEvaluation_now() - start;
+
+  for (pattern = 0; pattern < SBS_EVALUATION_PATTERNS; pattern ++)
+  {
+    correct += !model->result[pattern].failed
+               && (model->result[pattern].output == model->result[pattern].label);
+    cycles += model->result[pattern].cycles;
+    failed += model->result[pattern].failed;
+  }
+
+  printf("\n Accuracy:   %u/%d (%.2f%%)", correct, SBS_EVALUATION_PATTERNS,
+         100.0 * correct / SBS_EVALUATION_PATTERNS);
+  if (failed)
+    printf("\n Failed:     %u patterns could not be loaded", failed);
+  printf("\n Cycles:     %.1f per pattern", (double) cycles / SBS_EVALUATION_PATTERNS);
+  printf("\n Throughput: %.2f patterns/s (%.3f s)\n", SBS_EVALUATION_PATTERNS / time, time);
+
+  printf("\n worker  patterns  stolen      cycles  utilization\n");
+  for (i = 0; i < SBS_EVALUATION_WORKERS; i ++)
+    printf(" %6d  %8u  %6u  %10llu  %10.1f%%\n", i,
+           model->worker[i].patterns, model->worker[i].stolen,
+           (unsigned long long) model->worker[i].cycles,
+           100.0 * model->worker[i].busy_time / time);
+
+#ifdef SBS_EVALUATION_CURVE_FILE
+  if (SbsEvaluation_saveCurve(SBS_EVALUATION_CURVE_FILE) == OK)
+    printf("\n Accuracy-vs-cycles curve: %s.csv, %s_patterns.csv, %s.json\n",
+           SBS_EVALUATION_CURVE_FILE, SBS_EVALUATION_CURVE_FILE, SBS_EVALUATION_CURVE_FILE);
+  else
+    printf("\n Unable to write %s\n", SBS_EVALUATION_CURVE_FILE);
+#endif
+
+  printf("\n===============================================\n");
+
+  return OK;
+}
+
+static void SbsEvaluation_dispose(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < SBS_EVALUATION_WORKERS; i ++)
+  {
+    SbsEvaluationWorker * worker = &SbsEvaluation_model.worker[i];
+
+    if (worker->network != NULL)
+      worker->network->delete(&worker->network);
+
+    if (worker->context != NULL)
+      worker->context->delete(&worker->context);
+
+    free(worker->deque.task);
+    worker->deque.task = NULL;
+  }
+}
+
+static SbsEvaluation SbsEvaluation_obj = { SbsEvaluation_initialize,
+                                           SbsEvaluation_run,
+                                           SbsEvaluation_dispose };
+
+SbsEvaluation * SbsEvaluation_instance(void)
+{
+  return & SbsEvaluation_obj;
+}
@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_server.h
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network inference server (Linux only).
+ *          Keeps the MNIST model resident and serves requests over a Unix
+ *          domain socket. A client sends an SbsServerRequest followed by
+ *          'size' bytes laid out as an input pattern file, and receives an
+ *          SbsServerResponse followed by 'output_size' NeuronState values.
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ */
+//------------------------------------------------------------------------------
+
+// IFNDEF ----------------------------------------------------------------------
+#ifndef SBS_SERVER_H_
+#define SBS_SERVER_H_
+
+// INCLUDES --------------------------------------------------------------------
+#include "stdint.h"
+#include "stddef.h"
+
+#include "sbs_server_config.h"
+
+#include "result.h"
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_SERVER_REQUEST_MAGIC  0x51534253 /* "SBSQ" */
+#define SBS_SERVER_RESPONSE_MAGIC 0x52534253 /* "SBSR" */
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// DECLARATIONS ----------------------------------------------------------------
+
+#pragma pack(push)
+#pragma pack(1)
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t cycles;          /* 0 = SBS_SERVER_CYCLES, at most SBS_SERVER_MAX_CYCLES */
+  uint32_t size;            /* Pattern bytes that follow */
+} SbsServerRequest;
+
+typedef struct
+{
+  uint32_t magic;
+  int32_t  status;          /* Result code */
+  uint8_t  inferred_output;
+  uint8_t  input_label;     /* 0xFF when the pattern carries no label */
+  uint16_t output_size;     /* NeuronState values that follow */
+} SbsServerResponse;
+
+#pragma pack(pop)
+
+typedef struct
+{
+  Result  (* initialize)(void);
+  Result  (* run)(void);
+  void    (* dispose)(void);
+} SbsServer;
+
+SbsServer * SbsServer_instance(void);
+#endif /* SBS_SERVER_H_ */
@@ -0,0 +1,53 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_server_config.h
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network inference server
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ */
+//------------------------------------------------------------------------------
+// IFNDEF ----------------------------------------------------------------------
+#ifndef SBS_SERVER_CONFIG_H_
+#define SBS_SERVER_CONFIG_H_
+
+// INCLUDES --------------------------------------------------------------------
+
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_SERVER_SOCKET_PATH     "/tmp/sbs_server.sock"
+
+#define SBS_P_IN_H1_WEIGHTS_FILE   "MNIST/W_X_H1.bin"
+#define SBS_P_H1_H2_WEIGHTS_FILE   "MNIST/W_H1_H2.bin"
+#define SBS_P_H2_H3_WEIGHTS_FILE   "MNIST/W_H2_H3.bin"
+#define SBS_P_H3_H4_WEIGHTS_FILE   "MNIST/W_H3_H4.bin"
+#define SBS_P_H4_H5_WEIGHTS_FILE   "MNIST/W_H4_H5.bin"
+#define SBS_P_H5_HY_WEIGHTS_FILE   "MNIST/W_H5_HY.bin"
+
+#define SBS_SERVER_WORKERS         4       /* Resident networks, run on the library inference pool */
+#define SBS_SERVER_BATCH_SIZE      8       /* Largest batch handed to the workers */
+#define SBS_SERVER_BATCH_DEADLINE  2000    /* Microseconds a batch waits to fill up */
+#define SBS_SERVER_CYCLES          1000    /* Used when a request asks for 0 cycles */
+#define SBS_SERVER_MAX_CYCLES      4000    /* Larger requests are refused, a batch waits for its longest job */
+#define SBS_SERVER_MEMORY_SIZE     (1 << 20)
+#define SBS_SERVER_MAX_PATTERN     (1 << 20)
+#define SBS_SERVER_LATENCY_SAMPLES 4096    /* Latest requests kept for percentiles */
+#define SBS_SERVER_REPORT_INTERVAL 1000    /* Requests between statistics reports */
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// DECLARATIONS ----------------------------------------------------------------
+
+#endif /* SBS_SERVER_CONFIG_H_ */
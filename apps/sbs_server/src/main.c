@@ -0,0 +1,24 @@
+#include "sbs_server.h"
+
+int main(void)
+{
+  Result rc;
+
+  SbsServer * server = SbsServer_instance();
+
+  rc = (server != NULL)? OK: ERROR;
+
+  if (rc == OK)
+  {
+    rc = server->initialize();
+
+    if (rc == OK)
+    {
+      rc = server->run();
+    }
+
+    server->dispose();
+  }
+
+  return rc;
+}
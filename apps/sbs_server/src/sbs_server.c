@@ -0,0 +1,677 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: sbs_server.c
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike by Spike Neural Network inference server (Linux only)
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ *
+ */
+//------------------------------------------------------------------------------
+// INCLUDES --------------------------------------------------------------------
+#include "sbs_neural_network.h"
+#include "sbs_server.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "signal.h"
+#include "time.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+
+// FORWARD DECLARATIONS --------------------------------------------------------
+
+// TYPEDEFS AND DEFINES --------------------------------------------------------
+
+#define SBS_SERVER_INPUT_ROWS     24
+#define SBS_SERVER_INPUT_COLUMNS  24
+#define SBS_SERVER_INPUT_NEURONS  50
+#define SBS_SERVER_OUTPUT_NEURONS 10
+
+#define SBS_SERVER_PATTERN_SIZE   (sizeof(NeuronState) * SBS_SERVER_INPUT_ROWS \
+                                   * SBS_SERVER_INPUT_COLUMNS * SBS_SERVER_INPUT_NEURONS)
+
+// EUNUMERATIONS ---------------------------------------------------------------
+
+// STRUCTS AND NAMESPACES ------------------------------------------------------
+
+typedef struct SbsServerJob
+{
+  struct SbsServerJob * next;
+  uint8_t *             pattern;
+  size_t                size;
+  uint16_t              cycles;
+  double                arrival;
+  uint8_t               done;
+  uint8_t               abandoned; /* Its connection is gone, the server deletes it */
+  SbsServerResponse     response;
+  NeuronState           output[SBS_SERVER_OUTPUT_NEURONS];
+} SbsServerJob;
+
+typedef struct
+{
+  SbsContext *   context;
+  SbsNetwork *   network;
+  SbsServerJob * job;     /* In flight on the network, NULL when idle */
+} SbsServerWorker;
+
+typedef struct
+{
+  int                   socket;
+  volatile sig_atomic_t stop;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t  pending_cond;  /* Batcher waits for requests */
+  pthread_cond_t  finish_cond;   /* Batcher waits for the networks */
+  pthread_cond_t  done_cond;     /* Connections wait for their response */
+
+  SbsServerJob *  pending_head;
+  SbsServerJob *  pending_tail;
+  uint32_t        pending_count;
+
+  SbsServerJob *  batch[SBS_SERVER_BATCH_SIZE];
+  uint16_t        batch_size;
+  uint16_t        batch_next;
+  uint16_t        batch_done;
+
+  pthread_t       batcher;
+  SbsServerWorker worker[SBS_SERVER_WORKERS];
+
+  double          latency[SBS_SERVER_LATENCY_SAMPLES];
+  uint64_t        completed;
+  uint64_t        batches;
+  double          first_arrival;
+} SbsServerState;
+
+// DEFINITIONs -----------------------------------------------------------------
+
+static SbsServerState SbsServer_state =
+{
+  .socket       = -1,
+  .mutex        = PTHREAD_MUTEX_INITIALIZER,
+  .pending_cond = PTHREAD_COND_INITIALIZER,
+  .finish_cond  = PTHREAD_COND_INITIALIZER,
+  .done_cond    = PTHREAD_COND_INITIALIZER
+};
+
+static double SbsServer_now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+/* Returns 0 when the weight file could not be loaded */
+static int SbsServer_giveWeights(SbsLayer * layer, uint32_t rows, uint32_t columns, char * file_name)
+{
+  SbsWeightMatrix weights = sbs_new.WeightMatrix(rows, columns, file_name);
+
+  if (weights == NULL)
+    printf("\n Unable to load %s\n", file_name);
+  else
+    layer->giveWeights(layer, weights);
+
+  return (weights != NULL);
+}
+
+/* MNIST topology, see sbs_app.c. NULL when a weight file could not be loaded */
+static SbsNetwork * SbsServer_newNetwork(SbsContext * context)
+{
+  SbsNetwork * network = sbs_new.Network(context);
+  SbsLayer * layer;
+  int loaded = 1;
+
+  network->giveLayer(network, sbs_new.InputLayer(SBS_SERVER_INPUT_ROWS,
+                                                 SBS_SERVER_INPUT_COLUMNS,
+                                                 SBS_SERVER_INPUT_NEURONS));
+
+  layer = sbs_new.ConvolutionLayer(24, 24, 32, 1, ROW_SHIFT, 50);
+  layer->setEpsilon(layer, 0.1);
+  loaded &= SbsServer_giveWeights(layer, 2 * 5 * 5, 32, SBS_P_IN_H1_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.PoolingLayer(12, 12, 32, 2, COLUMN_SHIFT, 32);
+  layer->setEpsilon(layer, 0.1 / 4.0);
+  loaded &= SbsServer_giveWeights(layer, 32 * 2 * 2, 32, SBS_P_H1_H2_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.ConvolutionLayer(8, 8, 64, 5, COLUMN_SHIFT, 32);
+  layer->setEpsilon(layer, 0.1 / 25.0);
+  loaded &= SbsServer_giveWeights(layer, 32 * 5 * 5, 64, SBS_P_H2_H3_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.PoolingLayer(4, 4, 64, 2, COLUMN_SHIFT, 64);
+  layer->setEpsilon(layer, 0.1 / 4.0);
+  loaded &= SbsServer_giveWeights(layer, 64 * 2 * 2, 64, SBS_P_H3_H4_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.FullyConnectedLayer(1024, 4, ROW_SHIFT, 64);
+  layer->setEpsilon(layer, 0.1 / 16.0);
+  loaded &= SbsServer_giveWeights(layer, 64 * 4 * 4, 1024, SBS_P_H4_H5_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  layer = sbs_new.OutputLayer(SBS_SERVER_OUTPUT_NEURONS, ROW_SHIFT, 0);
+  layer->setEpsilon(layer, 0.1);
+  loaded &= SbsServer_giveWeights(layer, 1024, SBS_SERVER_OUTPUT_NEURONS, SBS_P_H5_HY_WEIGHTS_FILE);
+  network->giveLayer(network, layer);
+
+  if (!loaded)
+    network->delete(&network);
+
+  return network;
+}
+
+static int SbsServer_compare(const void * a, const void * b)
+{
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+/* Called with the mutex held */
+static void SbsServer_printStatistics(void)
+{
+  static double sorted[SBS_SERVER_LATENCY_SAMPLES];
+  SbsServerState * state = &SbsServer_state;
+  uint32_t samples = (state->completed < SBS_SERVER_LATENCY_SAMPLES) ?
+                      (uint32_t) state->completed : SBS_SERVER_LATENCY_SAMPLES;
+  double elapsed = SbsServer_now() - state->first_arrival;
+
+  if (samples == 0)
+  {
+    printf("\n No requests served\n");
+    return;
+  }
+
+  memcpy(sorted, state->latency, samples * sizeof(double));
+  qsort(sorted, samples, sizeof(double), SbsServer_compare);
+
+  printf("\n Requests: %llu, batches: %llu (%.2f per batch)",
+         (unsigned long long) state->completed,
+         (unsigned long long) state->batches,
+         (double) state->completed / (double) state->batches);
+  printf("\n Latency p50: %.3f ms, p99: %.3f ms (last %u requests)",
+         sorted[samples / 2] * 1e3,
+         sorted[(samples * 99) / 100] * 1e3,
+         samples);
+  printf("\n Throughput: %.2f requests/s\n",
+         (0.0 < elapsed) ? (double) state->completed / elapsed : 0.0);
+  fflush(stdout);
+}
+
+static void SbsServer_deleteJob(SbsServerJob * job)
+{
+  free(job->pattern);
+  free(job);
+}
+
+/* Inference callback, on a library pool thread */
+static void SbsServer_complete(void * data, SbsNetwork * network)
+{
+  SbsServerWorker * worker = data;
+  SbsServerState *  state = &SbsServer_state;
+  SbsServerJob *    job = worker->job;
+  NeuronState *     output_vector;
+  uint16_t          output_vector_size;
+
+  network->getOutputVector(network, &output_vector, &output_vector_size);
+
+  if (SBS_SERVER_OUTPUT_NEURONS < output_vector_size)
+    output_vector_size = SBS_SERVER_OUTPUT_NEURONS;
+
+  memcpy(job->output, output_vector, output_vector_size * sizeof(NeuronState));
+
+  job->response.status = OK;
+  job->response.inferred_output = network->getInferredOutput(network);
+  job->response.input_label = network->getInputLabel(network);
+  job->response.output_size = output_vector_size;
+
+  pthread_mutex_lock(&state->mutex);
+  worker->job = NULL;
+  state->batch_done ++;
+  pthread_cond_signal(&state->finish_cond);
+  pthread_mutex_unlock(&state->mutex);
+}
+
+/* Starts the next jobs of the batch on the idle networks. Called with the
+ * mutex held, which is released while loading and submitting */
+static void SbsServer_dispatch(void)
+{
+  SbsServerState *  state = &SbsServer_state;
+  SbsServerWorker * worker;
+  SbsServerJob *    job;
+  int               submitted;
+  int               i;
+
+  while (state->batch_next < state->batch_size)
+  {
+    for (i = 0; (i < SBS_SERVER_WORKERS) && (state->worker[i].job != NULL); i ++);
+
+    if (i == SBS_SERVER_WORKERS)
+      break;
+
+    worker = &state->worker[i];
+    job = state->batch[state->batch_next ++];
+    job->response.magic = SBS_SERVER_RESPONSE_MAGIC;
+
+    if (job->size < SBS_SERVER_PATTERN_SIZE)
+    {
+      job->response.status = ERROR;
+      state->batch_done ++;
+      continue;
+    }
+
+    worker->job = job;
+    pthread_mutex_unlock(&state->mutex);
+
+    /* The callback of the previous job may still be returning */
+    worker->network->wait(worker->network);
+    worker->network->loadInputBuffer(worker->network, job->pattern, job->size);
+    submitted = worker->network->submit(worker->network,
+                                        job->cycles ? job->cycles : SBS_SERVER_CYCLES,
+                                        SbsServer_complete, worker);
+
+    pthread_mutex_lock(&state->mutex);
+
+    if (!submitted)
+    {
+      job->response.status = ERROR;
+      worker->job = NULL;
+      state->batch_done ++;
+    }
+  }
+}
+
+/* Collects pending requests into batches: a batch is released once it is full
+ * or the oldest request has waited SBS_SERVER_BATCH_DEADLINE microseconds */
+static void * SbsServer_batcherThread(void * argument)
+{
+  SbsServerState * state = &SbsServer_state;
+  struct timespec  deadline;
+  double           now;
+  uint16_t         i;
+
+  (void) argument;
+
+  pthread_mutex_lock(&state->mutex);
+  while (!state->stop)
+  {
+    if (state->pending_count == 0)
+    {
+      pthread_cond_wait(&state->pending_cond, &state->mutex);
+      continue;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += SBS_SERVER_BATCH_DEADLINE * 1000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    while (!state->stop && (state->pending_count < SBS_SERVER_BATCH_SIZE))
+      if (pthread_cond_timedwait(&state->pending_cond, &state->mutex, &deadline) == ETIMEDOUT)
+        break;
+
+    if (state->stop) break;
+
+    for (state->batch_size = 0;
+         (state->batch_size < SBS_SERVER_BATCH_SIZE) && (state->pending_head != NULL);
+         state->batch_size ++)
+    {
+      state->batch[state->batch_size] = state->pending_head;
+      state->pending_head = state->pending_head->next;
+      state->pending_count --;
+    }
+    if (state->pending_head == NULL) state->pending_tail = NULL;
+
+    state->batch_next = 0;
+    state->batch_done = 0;
+    SbsServer_dispatch();
+
+    while (!state->stop && (state->batch_done < state->batch_size))
+    {
+      pthread_cond_wait(&state->finish_cond, &state->mutex);
+      SbsServer_dispatch();
+    }
+
+    /* Stopped with inferences in flight: dispose() waits for them */
+    if (state->batch_done < state->batch_size) break;
+
+    now = SbsServer_now();
+    for (i = 0; i < state->batch_size; i ++)
+    {
+      state->latency[state->completed % SBS_SERVER_LATENCY_SAMPLES] = now - state->batch[i]->arrival;
+      state->batch[i]->done = 1;
+      state->completed ++;
+
+      if (state->completed % SBS_SERVER_REPORT_INTERVAL == 0)
+        SbsServer_printStatistics();
+
+      if (state->batch[i]->abandoned)
+        SbsServer_deleteJob(state->batch[i]);
+    }
+    state->batches ++;
+    state->batch_size = 0;
+    pthread_cond_broadcast(&state->done_cond);
+  }
+  pthread_mutex_unlock(&state->mutex);
+
+  return NULL;
+}
+
+static Result SbsServer_receive(int connection, void * buffer, size_t size)
+{
+  uint8_t * data = buffer;
+  ssize_t   received;
+
+  while (0 < size)
+  {
+    received = recv(connection, data, size, 0);
+    if (received <= 0)
+    {
+      if ((received < 0) && (errno == EINTR)) continue;
+      return ERROR;
+    }
+    data += received;
+    size -= received;
+  }
+
+  return OK;
+}
+
+static Result SbsServer_send(int connection, const void * buffer, size_t size)
+{
+  const uint8_t * data = buffer;
+  ssize_t         sent;
+
+  while (0 < size)
+  {
+    sent = send(connection, data, size, MSG_NOSIGNAL);
+    if (sent <= 0)
+    {
+      if ((sent < 0) && (errno == EINTR)) continue;
+      return ERROR;
+    }
+    data += sent;
+    size -= sent;
+  }
+
+  return OK;
+}
+
+/* Takes 'job' back from the pending list after a stop. Returns 0 when it is
+ * already in a batch: the server then owns it. Called with the mutex held */
+static int SbsServer_withdraw(SbsServerJob * job)
+{
+  SbsServerState * state = &SbsServer_state;
+  SbsServerJob *   previous = NULL;
+  SbsServerJob *   pending = state->pending_head;
+
+  while ((pending != NULL) && (pending != job))
+  {
+    previous = pending;
+    pending = pending->next;
+  }
+
+  if (pending == NULL)
+  {
+    job->abandoned = 1;
+    return 0;
+  }
+
+  if (previous != NULL)
+    previous->next = job->next;
+  else
+    state->pending_head = job->next;
+
+  if (state->pending_tail == job)
+    state->pending_tail = previous;
+
+  state->pending_count --;
+
+  return 1;
+}
+
+/* Serves the requests of one client until it disconnects. Jobs are on the
+ * heap: one the server still holds when it stops outlives the connection */
+static void * SbsServer_connectionThread(void * argument)
+{
+  SbsServerState * state = &SbsServer_state;
+  int              connection = (int) (intptr_t) argument;
+  SbsServerRequest request;
+  SbsServerJob *   job = NULL;
+  Result           rc = OK;
+
+  while ((rc == OK) && !state->stop)
+  {
+    rc = SbsServer_receive(connection, &request, sizeof(request));
+
+    if ((rc == OK) && ((request.magic != SBS_SERVER_REQUEST_MAGIC)
+                       || (SBS_SERVER_MAX_PATTERN < request.size)
+                       || (SBS_SERVER_MAX_CYCLES < request.cycles)))
+      rc = ERROR;
+
+    if (rc == OK)
+    {
+      job = calloc(1, sizeof(SbsServerJob));
+      rc = (job != NULL) ? OK : ERROR;
+    }
+
+    if (rc == OK)
+    {
+      job->size = request.size;
+      job->cycles = request.cycles;
+      job->pattern = malloc(request.size ? request.size : 1);
+      rc = (job->pattern != NULL) ? SbsServer_receive(connection, job->pattern, job->size) : ERROR;
+    }
+
+    if (rc == OK)
+    {
+      pthread_mutex_lock(&state->mutex);
+      job->arrival = SbsServer_now();
+      if (state->completed == 0 && state->pending_count == 0 && state->batch_size == 0)
+        state->first_arrival = job->arrival;
+
+      if (state->pending_tail != NULL)
+        state->pending_tail->next = job;
+      else
+        state->pending_head = job;
+      state->pending_tail = job;
+      state->pending_count ++;
+      pthread_cond_signal(&state->pending_cond);
+
+      while (!job->done && !state->stop)
+        pthread_cond_wait(&state->done_cond, &state->mutex);
+
+      if (!job->done)
+      {
+        if (!SbsServer_withdraw(job))
+          job = NULL;
+        rc = ERROR;
+      }
+      pthread_mutex_unlock(&state->mutex);
+
+      if (rc == OK)
+        rc = SbsServer_send(connection, &job->response, sizeof(job->response));
+
+      if ((rc == OK) && (job->response.output_size != 0))
+        rc = SbsServer_send(connection, job->output,
+                            job->response.output_size * sizeof(NeuronState));
+    }
+
+    if (job != NULL)
+    {
+      SbsServer_deleteJob(job);
+      job = NULL;
+    }
+  }
+
+  close(connection);
+
+  return NULL;
+}
+
+static void SbsServer_signal(int signal_number)
+{
+  (void) signal_number;
+
+  SbsServer_state.stop = 1;
+
+  if (SbsServer_state.socket != -1)
+    shutdown(SbsServer_state.socket, SHUT_RDWR);
+}
+
+static Result SbsServer_initialize(void)
+{
+  SbsServerState *   state = &SbsServer_state;
+  struct sockaddr_un address;
+  struct sigaction   action;
+  Result             rc = OK;
+  int                i;
+
+  setbuf(stdout, NULL);
+
+  for (i = 0; (rc == OK) && (i < SBS_SERVER_WORKERS); i ++)
+  {
+    /* Independent spike generators; the weights are shared through the registry */
+    state->worker[i].context = sbs_new.Context(SBS_SERVER_MEMORY_SIZE, 666 + i);
+    rc = (state->worker[i].context != NULL) ? OK : ERROR;
+
+    if (rc == OK)
+    {
+      state->worker[i].context->setOption(state->worker[i].context, PROGRESS_INTERVAL, 0);
+      state->worker[i].network = SbsServer_newNetwork(state->worker[i].context);
+      rc = (state->worker[i].network != NULL) ? OK : ERROR;
+    }
+  }
+
+  if (rc == OK)
+  {
+    state->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    rc = (state->socket != -1) ? OK : ERROR;
+  }
+
+  if (rc == OK)
+  {
+    memset(&address, 0x00, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, SBS_SERVER_SOCKET_PATH, sizeof(address.sun_path) - 1);
+    unlink(SBS_SERVER_SOCKET_PATH);
+
+    rc = ((bind(state->socket, (struct sockaddr *) &address, sizeof(address)) == 0)
+          && (listen(state->socket, SOMAXCONN) == 0)) ? OK : ERROR;
+
+    if (rc != OK)
+      printf("\n Unable to listen on %s: %s\n", SBS_SERVER_SOCKET_PATH, strerror(errno));
+  }
+
+  if (rc == OK)
+  {
+    memset(&action, 0x00, sizeof(action));
+    action.sa_handler = SbsServer_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    rc = (pthread_create(&state->batcher, NULL, SbsServer_batcherThread, NULL) == 0) ? OK : ERROR;
+  }
+
+  return rc;
+}
+
+static Result SbsServer_run(void)
+{
+  SbsServerState * state = &SbsServer_state;
+  pthread_attr_t   attributes;
+  pthread_t        thread;
+  int              connection;
+
+  printf("\n Spike by Spike Neural Network inference server");
+  printf("\n Listening on %s (%d networks, batch %d, deadline %d us)\n",
+         SBS_SERVER_SOCKET_PATH, SBS_SERVER_WORKERS,
+         SBS_SERVER_BATCH_SIZE, SBS_SERVER_BATCH_DEADLINE);
+
+  pthread_attr_init(&attributes);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+  while (!state->stop)
+  {
+    connection = accept(state->socket, NULL, NULL);
+
+    if (connection == -1)
+    {
+      if ((errno == EINTR) || (errno == ECONNABORTED)) continue;
+      break;
+    }
+
+    if (pthread_create(&thread, &attributes, SbsServer_connectionThread,
+                       (void *) (intptr_t) connection) != 0)
+      close(connection);
+  }
+
+  pthread_attr_destroy(&attributes);
+
+  pthread_mutex_lock(&state->mutex);
+  state->stop = 1;
+  SbsServer_printStatistics();
+  pthread_cond_broadcast(&state->pending_cond);
+  pthread_cond_broadcast(&state->finish_cond);
+  pthread_cond_broadcast(&state->done_cond);
+  pthread_mutex_unlock(&state->mutex);
+
+  return OK;
+}
+
+static void SbsServer_dispose(void)
+{
+  SbsServerState * state = &SbsServer_state;
+  int i;
+
+  if (state->batcher)
+    pthread_join(state->batcher, NULL);
+
+  /* delete() waits for an inference still in flight */
+  for (i = 0; i < SBS_SERVER_WORKERS; i ++)
+  {
+    if (state->worker[i].network != NULL)
+      state->worker[i].network->delete(&state->worker[i].network);
+
+    if (state->worker[i].context != NULL)
+      state->worker[i].context->delete(&state->worker[i].context);
+  }
+
+  /* Jobs of the unfinished batch whose connections gave them up */
+  pthread_mutex_lock(&state->mutex);
+  for (i = 0; i < state->batch_size; i ++)
+    if (state->batch[i]->abandoned)
+      SbsServer_deleteJob(state->batch[i]);
+  state->batch_size = 0;
+  pthread_mutex_unlock(&state->mutex);
+
+  if (state->socket != -1)
+  {
+    close(state->socket);
+    state->socket = -1;
+    unlink(SBS_SERVER_SOCKET_PATH);
+  }
+}
+
+static SbsServer SbsServer_obj = { SbsServer_initialize,
+                                   SbsServer_run,
+                                   SbsServer_dispose };
+
+SbsServer * SbsServer_instance(void)
+{
+  return &SbsServer_obj;
+}
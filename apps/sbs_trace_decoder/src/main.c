@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+/**
+ *
+ * @file: main.c
+ *
+ * @Created on: October 19th, 2026
+ * @Author: Yarib Nevarez
+ *
+ *
+ * @brief - Spike trace decoder (host only). Converts a binary spike trace
+ *          to CSV, one line per recorded row: layer,cycle,row,spikes...
+ *
+ *          Usage: sbs_trace_decoder <trace file> <csv file> [layer]
+ * <Requirement Doc Reference>
+ * <Design Doc Reference>
+ *
+ * @copyright Copyright [2019] Institute for Theoretical Electrical Engineering
+ *                             and Microelectronics (ITEM)
+ * All Rights Reserved.
+ *
+ *
+ */
+//------------------------------------------------------------------------------
+// INCLUDES --------------------------------------------------------------------
+#include "sbs_spike_trace.h"
+#include "result.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+// DEFINITIONs -----------------------------------------------------------------
+
+int main(int argc, char ** argv)
+{
+  SbsSpikeTraceReader * reader;
+  SbsSpikeTraceRecord   record;
+  const uint16_t *      spike;
+  FILE *                file;
+  uint64_t              records = 0;
+  int                   layer = -1;
+  uint32_t              row;
+  uint32_t              column;
+  int                   decoded;
+
+  if ((argc < 3) || (4 < argc))
+  {
+    printf("Usage: %s <trace file> <csv file> [layer]\n", argv[0]);
+    return ERROR;
+  }
+
+  if (argc == 4)
+    layer = atoi(argv[3]);
+
+  reader = SbsSpikeTraceReader_new(argv[1]);
+  if (reader == NULL)
+  {
+    printf("Unable to read trace %s\n", argv[1]);
+    return ERROR;
+  }
+
+  file = fopen(argv[2], "w");
+  if (file == NULL)
+  {
+    printf("Unable to write %s\n", argv[2]);
+    SbsSpikeTraceReader_delete(&reader);
+    return ERROR;
+  }
+
+  while ((decoded = SbsSpikeTraceReader_next(reader, &record, &spike)) != 0)
+  {
+    if ((layer < 0) || (record.layer == layer))
+    {
+      for (row = 0; row < record.rows; row ++)
+      {
+        fprintf(file, "%u,%u,%u", record.layer, record.cycle, row);
+        for (column = 0; column < record.columns; column ++)
+          fprintf(file, ",%d", spike[(size_t) row * record.columns + column]);
+        fprintf(file, "\n");
+      }
+    }
+    records ++;
+  }
+
+  fclose(file);
+  SbsSpikeTraceReader_delete(&reader);
+
+  printf("%llu records decoded\n", (unsigned long long) records);
+
+  return OK;
+}
@@ -1,3 +1,18 @@
+#ifndef MT19937INT_H_
+#define MT19937INT_H_
+
+#define MT19937_N 624
+
+typedef struct
+{
+  unsigned long mt[MT19937_N]; /* the array for the state vector  */
+  int           mti;           /* mti==N+1 means mt[N] is not initialized */
+} MT19937;
+
+void MT19937_sgenrand(MT19937 * generator, unsigned long seed);
+unsigned long MT19937_genrand(MT19937 * generator);
 
 void sgenrand(unsigned long seed);
 unsigned long genrand();
+
+#endif /* MT19937INT_H_ */
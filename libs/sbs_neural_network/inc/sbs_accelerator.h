@@ -0,0 +1,62 @@
+/*
+ * sbs_accelerator.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+
+#ifndef SBS_ACCELERATOR_H_
+#define SBS_ACCELERATOR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Layer update offload. A device takes SbsUpdateDescriptors through a queue of
+ * fixed depth and reports completion per ticket, the way a scatter-gather DMA
+ * engine writes back descriptor status. The buffers of a descriptor belong to
+ * the device from submit() until poll() or wait() reports it complete */
+
+typedef struct
+{
+  float *          state;          /* [rows][columns][neurons], updated in place */
+  const uint16_t * spike;          /* [spike_rows][spike_columns] SpikeIDs of the previous layer */
+  const float *    weight;         /* [weight_rows][neurons] */
+  uint32_t         rows;
+  uint32_t         columns;
+  uint16_t         neurons;
+  uint32_t         spike_rows;
+  uint32_t         spike_columns;
+  uint32_t         weight_rows;
+  uint16_t         kernel_size;
+  uint16_t         kernel_stride;
+  uint8_t          weight_shift;   /* WeightShift */
+  uint16_t         neurons_previous_layer;
+  float            epsilon;
+} SbsUpdateDescriptor;
+
+typedef struct
+{
+  uint64_t submitted;
+  uint64_t completed;
+  uint64_t queue_full;  /* submit() calls refused */
+  double   busy_time;   /* Seconds spent updating, summed over the workers */
+} SbsAcceleratorStatistics;
+
+typedef struct SbsAccelerator_VTable SbsAccelerator;
+struct SbsAccelerator_VTable
+{
+  void     (*delete)       (SbsAccelerator ** device);
+  /* Note: returns the ticket of the queued descriptor, 0 when the queue is full */
+  uint32_t (*submit)       (SbsAccelerator * device, const SbsUpdateDescriptor * descriptor);
+  /* Note: returns 1 once 'ticket' is complete, which releases its queue slot */
+  int      (*poll)         (SbsAccelerator * device, uint32_t ticket);
+  void     (*wait)         (SbsAccelerator * device, uint32_t ticket);
+  void     (*getStatistics)(SbsAccelerator * device, SbsAcceleratorStatistics * statistics);
+};
+
+/* Reference device: 'workers' threads share every descriptor in bands of output rows.
+ * With 0 workers, and always on the board, submit() computes the update itself.
+ * Results match the network's own update (RASTER_ORDER) bit for bit */
+SbsAccelerator * SbsCpuAccelerator_new(uint8_t workers, uint16_t queue_depth);
+
+#endif /* SBS_ACCELERATOR_H_ */
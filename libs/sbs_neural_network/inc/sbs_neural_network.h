@@ -11,23 +11,119 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "sbs_spike_trace.h"
+#include "sbs_accelerator.h"
+
 #pragma pack(push)
 #pragma pack(1)
 
+#define SBS_MEMORY_ALIGNMENT 64 /* Of the layer buffers in a context arena, a cache line */
+#define SBS_UPDATE_MIN_SUM   1e-20 /* Updates with a smaller sum of state-weight products are skipped */
+
 typedef enum
 {
   ROW_SHIFT,
   COLUMN_SHIFT
 } WeightShift;
 
+typedef enum
+{
+  RASTER_ORDER,     /* Kernel updates applied position by position */
+  WEIGHT_ROW_ORDER, /* Updates sharing a weight row applied back to back */
+  WINDOW_ORDER      /* Kernel updates of a position fused in one pass per update (dense path) */
+} UpdateOrder;
+
+typedef enum
+{
+  POSITION_MAJOR,   /* [rows][columns][neurons]: the neuron vector of a position is contiguous */
+  NEURON_MAJOR      /* [neurons][rows][columns]: vectors are gathered for the kernels */
+} StateLayout;
+
+typedef enum
+{
+  PROGRESS_INTERVAL,     /* Cycles between progress messages, 0 = silent (100) */
+  SPARSE_STATE_INTERVAL, /* Layer updates between sparse-state checks (10) */
+  SPARSE_STATE_SWITCH,   /* Largest kept fraction for a position to go sparse (0.5) */
+  SAMPLING,              /* SbsSampling of the spike generation uniforms (SAMPLING_RANDOM) */
+  UPDATE_TILE            /* Side of the position tiles a layer is updated in, 0 = whole layer (0) */
+} SbsOption;
+
+/* Note: each position draws one uniform per cycle. The variance-reduced modes
+ * correlate the draws of a position across cycles; their per-position offsets
+ * come from the context RNG at cycle 0 and are not part of checkpoints */
+typedef enum
+{
+  SAMPLING_RANDOM,     /* Independent MT19937 draws */
+  SAMPLING_R1,         /* Golden ratio additive recurrence, the 1-D R-sequence */
+  SAMPLING_SOBOL,      /* Scrambled van der Corput, the 1-D Sobol sequence */
+  SAMPLING_STRATIFIED, /* Every stratum of [0, 1] once per SBS_SAMPLING_STRATA cycles */
+  SAMPLING_ANTITHETIC  /* Odd cycles draw 1 - u of the cycle before */
+} SbsSampling;
+
+typedef enum
+{
+  TELEMETRY_UPDATES      = 0x01, /* updateIP calls, and those skipped on sum < SBS_UPDATE_MIN_SUM */
+  TELEMETRY_WEIGHT_BYTES = 0x02, /* Weight bytes read (values and sparse indices) */
+  TELEMETRY_SPIKES       = 0x04, /* Spike histogram and entropy */
+  TELEMETRY_STATE_CHANGE = 0x08, /* Mean absolute state change */
+  TELEMETRY_TIME         = 0x10, /* Wall time generating spikes and updating */
+  TELEMETRY_ALL          = 0x1F
+} SbsTelemetryField;
+
+typedef enum
+{
+  PHASE_GENERATE, /* Spike generation of a layer */
+  PHASE_UPDATE    /* State update of a layer from the spikes of the previous one */
+} SbsPhase;
+
 typedef float  NeuronState;
 typedef void * SbsWeightMatrix;
 
+/* Note: a context owns the memory arena, random generator and options of the networks created
+ * with it. Networks on different contexts share no mutable state and may run on different threads */
+typedef struct
+{
+  uint32_t         fields;          /* SbsTelemetryField mask in effect */
+  uint32_t         cycles;          /* Update cycles since setTelemetry() */
+  uint64_t         updates;
+  uint64_t         skipped_updates;
+  uint64_t         weight_bytes;
+  const uint32_t * spike_histogram; /* Spikes per neuron, 'neurons' entries, NULL when not collected */
+  uint16_t         neurons;
+  float            spike_entropy;   /* Of the spike histogram, in bits */
+  double           state_change;    /* Per neuron and cycle */
+  double           time;            /* Seconds */
+} SbsLayerTelemetry;
+
+/* Note: bytes of one layer. A weight matrix shared by several layers counts in each of them */
+typedef struct
+{
+  size_t state_bytes;
+  size_t spike_bytes;
+  size_t weight_bytes; /* Dense weights, loaded outside the arena */
+  size_t arena_bytes;  /* State and spikes in the arena, alignment included */
+  size_t heap_bytes;   /* State and spikes past the arena */
+} SbsLayerMemory;
+
+/* Note: called by step() before ('end' = 0) and after ('end' = 1) every layer phase */
+typedef void (*SbsPhaseHook)(void * data, uint16_t layer, SbsPhase phase, uint8_t end, uint32_t cycle);
+
+typedef struct SbsContext_VTable SbsContext;
+struct SbsContext_VTable
+{
+  SbsContext * (*new)          (size_t memory_size, uint32_t seed);
+  void         (*delete)       (SbsContext ** context);
+  void         (*seed)         (SbsContext * context, uint32_t seed);
+  void         (*setOption)    (SbsContext * context, SbsOption option, float value);
+  size_t       (*getMemorySize)(SbsContext * context);
+};
+extern const struct SbsContext_VTable _SbsContext;
+
 typedef struct SbsLayer_VTable SbsLayer;
 struct SbsLayer_VTable
 {
-  SbsLayer * (*new)        (uint16_t rows,
-                            uint16_t columns,
+  SbsLayer * (*new)        (uint32_t rows,
+                            uint32_t columns,
                             uint16_t neurons,
                             uint16_t kernel_size,
                             uint16_t kernel_stride,
@@ -36,51 +132,136 @@ struct SbsLayer_VTable
   void       (*delete)     (SbsLayer ** layer);
   void       (*setEpsilon) (SbsLayer * layer, float epsilon);
   void       (*giveWeights)(SbsLayer * layer, SbsWeightMatrix weight_matrix);
+  /* Note: builds a sparse (CSR) copy of the weights keeping entries above 'threshold',
+   * a negative 'threshold' restores the dense path. Returns the sparse copy size in bytes */
+  size_t     (*pruneWeights)(SbsLayer * layer, float threshold);
+  void       (*setUpdateOrder)(SbsLayer * layer, UpdateOrder update_order);
+  /* Note: positions track only their significant neurons: with 'top_k' the k largest once the
+   * remaining mass is below 'threshold', otherwise the ones above 'threshold'. Negative disables */
+  void       (*setSparseState)(SbsLayer * layer, float threshold, uint16_t top_k);
+  /* Note: the states are rearranged in place. NEURON_MAJOR layers are updated on the host,
+   * snapshots are restored only into layers of the same layout */
+  void       (*setStateLayout)(SbsLayer * layer, StateLayout layout);
 };
-extern struct SbsLayer_VTable _SbsLayer;
+extern const struct SbsLayer_VTable _SbsLayer;
 
 
 typedef struct SbsNetwork_VTable SbsNetwork;
+
+/* Note: called on a library worker thread when an inference started with submit() is done,
+ * the results are readable through getInferredOutput() and getOutputVector() */
+typedef void (*SbsInferenceCallback)(void * data, SbsNetwork * network);
+
 struct SbsNetwork_VTable
 {
-  SbsNetwork * (*new)               (void);
+  SbsNetwork * (*new)               (SbsContext * context);
   void         (*delete)            (SbsNetwork ** network);
   void         (*giveLayer)         (SbsNetwork * network, SbsLayer * layer);
-  void         (*loadInput)         (SbsNetwork * network, char * file_name);
+  /* Note: returns 0 when the file could not be opened or is too short, the input is then
+   * incomplete */
+  int          (*loadInput)         (SbsNetwork * network, char * file_name);
   void         (*updateCycle)       (SbsNetwork * network, uint16_t cycles);
   uint8_t      (*getInferredOutput) (SbsNetwork * network);
   uint8_t      (*getInputLabel)     (SbsNetwork * network);
   /* Note: 'NeuronState ** output_vector' must use intermediate variables to support unaligned accesses in ARM architectures */
   void         (*getOutputVector)   (SbsNetwork * network, NeuronState ** output_vector, uint16_t * output_vector_size);
-  size_t       (*getMemorySize)     (SbsNetwork * network);
+  /* Note: fills up to 'size' entries of 'report', one per layer, and returns the arena and heap
+   * bytes of the layer buffers (NULL 'report' and 'size' 0: the total only) */
+  size_t       (*getMemoryReport)   (SbsNetwork * network, SbsLayerMemory * report, uint16_t size);
+  /* Note: updateCycle() is reset() followed by step(). Calling step() again continues from the
+   * current states and RNG; getInferredOutput() and getOutputVector() read out after each step */
+  void         (*reset)             (SbsNetwork * network);
+  void         (*step)              (SbsNetwork * network, uint16_t cycles);
+  uint32_t     (*getCycle)          (SbsNetwork * network);
+  /* Note: with 'blend' > 0, reset() (and so updateCycle()) keeps 'blend' of the previous hidden
+   * states and mixes in (1 - 'blend') of the uniform start. Useful for similar consecutive inputs */
+  void         (*setWarmStart)      (SbsNetwork * network, float blend);
+  /* Note: 'buffer' holds the input file content: the pattern and optionally the label byte */
+  void         (*loadInputBuffer)   (SbsNetwork * network, void * buffer, size_t size);
+  /* Note: step() records the spikes of the sampled layers and cycles into 'trace', NULL stops.
+   * The network does not own the trace */
+  void         (*setSpikeTrace)     (SbsNetwork * network, SbsSpikeTrace * trace);
+  /* Note: collects the SbsTelemetryField counters in 'fields' for the layers given so far and
+   * clears them; 0 disables collection. Fields not collected cost only a branch per update */
+  void         (*setTelemetry)      (SbsNetwork * network, uint32_t fields);
+  void         (*getTelemetry)      (SbsNetwork * network, uint16_t layer, SbsLayerTelemetry * telemetry);
+  /* Note: writes a JSON snapshot of every layer into 'buffer' like snprintf(), returns its length */
+  size_t       (*getTelemetryJSON)  (SbsNetwork * network, char * buffer, size_t size);
+  /* Note: a NULL 'hook' removes it, see sbs_profiler.h */
+  void         (*setPhaseHook)      (SbsNetwork * network, SbsPhaseHook hook, void * data);
+  /* Note: writes a snapshot of the layer states and spikes, sparse-state lists, sampling offsets,
+   * cycle counter and context RNG into 'buffer' when it fits, and returns its size (query with
+   * a NULL 'buffer' and 'size' 0). With the same layer and context settings, step() on the
+   * restored network continues bit for bit, in every SbsSampling mode */
+  size_t       (*checkpoint)        (SbsNetwork * network, void * buffer, size_t size);
+  /* Note: 'buffer' may be a memory-mapped snapshot file. Returns 0, leaving the network
+   * untouched, when the snapshot does not match the topology, or lacks the sampling offsets
+   * a network past cycle 0 needs in a SbsSampling mode other than SAMPLING_RANDOM */
+  size_t       (*restore)           (SbsNetwork * network, const void * buffer, size_t size);
+  /* Note: times the kernel variants on every layer shape and keeps the fastest per layer, now
+   * and for the layers given later. All variants compute the same result, bit for bit when the
+   * compiler does not contract into fused multiply-adds (-ffp-contract=off). Decisions are read
+   * from and appended to 'cache_file' (NULL: none), keyed by CPU model and layer shape */
+  void         (*autotune)          (SbsNetwork * network, const char * cache_file);
+  /* Note: with 'chains' > 1, step() runs that many independent chains in parallel, each with its
+   * own states and RNG stream and the weights shared, and reads out the mean of their output
+   * vectors. Chain 0 is this network: traces, telemetry, hooks and checkpoints cover it only.
+   * The other chains are built by the first step() after this call and copy the layer settings,
+   * the context options and the warm start blend at that point. Changes made later apply to
+   * chain 0 only (the accelerator and seed() excepted), call setEnsemble() again to rebuild */
+  void         (*setEnsemble)       (SbsNetwork * network, uint8_t chains);
+  /* Note: step() submits the dense layer updates (RASTER_ORDER or WINDOW_ORDER, no sparse modes,
+   * no update or weight byte telemetry) to 'device', all updates of a cycle in flight together,
+   * and waits for them before the next cycle. NULL detaches. The network does not own the device,
+   * ensemble chains share it */
+  void         (*setAccelerator)    (SbsNetwork * network, SbsAccelerator * device);
+  /* Note: runs updateCycle() on the library worker pool (one thread per CPU, started on first
+   * use) on the input loaded beforehand, and returns without waiting; 'callback' may be NULL.
+   * Returns 0 while an inference of this network is still in flight. Networks in flight at the
+   * same time need contexts of their own. On the board the inference runs inside submit() */
+  int          (*submit)            (SbsNetwork * network, uint16_t cycles,
+                                     SbsInferenceCallback callback, void * data);
+  /* Note: 1 when no inference is in flight, its callback included */
+  int          (*poll)              (SbsNetwork * network);
+  void         (*wait)              (SbsNetwork * network);
 };
-extern struct SbsNetwork_VTable _SbsNetwork;
+extern const struct SbsNetwork_VTable _SbsNetwork;
 
 typedef struct
 {
-  SbsNetwork *    (*Network)(void);
+  /* Note: layer buffers that no longer fit in the 'memory_size' arena come from the heap.
+   * MemoryPlan() gives the exact size for a network */
+  SbsContext *    (*Context)(size_t memory_size, uint32_t seed);
 
-  SbsLayer *      (*Layer)  (uint16_t rows,
-                             uint16_t columns,
+  /* Note: a NULL 'context' selects the default context (static arena, seed 666), for single-threaded use */
+  SbsNetwork *    (*Network)(SbsContext * context);
+
+  /* Note: rows, columns and weight rows are 32-bit. Neurons stay below 65536, the range of the
+   * 16-bit SpikeIDs. A network takes up to 65535 layers */
+  SbsLayer *      (*Layer)  (uint32_t rows,
+                             uint32_t columns,
                              uint16_t neurons,
                              uint16_t kernel_size,
                              uint16_t kernel_stride,
                              WeightShift weight_shift,
                              uint16_t    neurons_previous_Layer);
 
-  SbsWeightMatrix (*WeightMatrix)(uint16_t rows, uint16_t columns, char * file_name);
+  /* Note: weight matrices are shared and reference counted: loading the same file (or content)
+   * again returns the same read-only matrix. giveWeights() hands one reference to the layer.
+   * NULL when the file is missing or shorter than the matrix */
+  SbsWeightMatrix (*WeightMatrix)(uint32_t rows, uint32_t columns, char * file_name);
 
-  SbsLayer *      (*InputLayer)  (uint16_t rows, uint16_t columns, uint16_t neurons);
+  SbsLayer *      (*InputLayer)  (uint32_t rows, uint32_t columns, uint16_t neurons);
 
-  SbsLayer *      (*ConvolutionLayer)(uint16_t rows,
-                                      uint16_t columns,
+  SbsLayer *      (*ConvolutionLayer)(uint32_t rows,
+                                      uint32_t columns,
                                       uint16_t neurons,
                                       uint16_t kernel_size,
                                       WeightShift weight_shift,
                                       uint16_t neurons_prev_Layer);
 
-  SbsLayer *      (*PoolingLayer)(uint16_t rows,
-                                  uint16_t columns,
+  SbsLayer *      (*PoolingLayer)(uint32_t rows,
+                                  uint32_t columns,
                                   uint16_t neurons,
                                   uint16_t kernel_size,
                                   WeightShift weight_shift,
@@ -94,6 +275,11 @@ typedef struct
   SbsLayer *      (*OutputLayer)(uint16_t neurons,
                                  WeightShift weight_shift,
                                  uint16_t neurons_prev_Layer);
+
+  /* Note: takes the layers of a network in network order before they are given and returns the
+   * arena bytes their buffers take, alignment included, for Context(). Fills 'report' (NULL:
+   * none) with one entry per layer. Sparse-mode and update-order buffers come from the heap */
+  size_t          (*MemoryPlan)(SbsLayer ** layers, uint16_t count, SbsLayerMemory * report);
 } SbsNew;
 
 
@@ -0,0 +1,58 @@
+/*
+ * sbs_profiler.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+
+#ifndef SBS_PROFILER_H_
+#define SBS_PROFILER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sbs_neural_network.h"
+
+/* Hardware performance counters per layer and phase (Linux perf_event_open).
+ * Counters the CPU, kernel or permissions do not provide are left out; without
+ * any of them only calls and wall time are reported. Counters follow the thread
+ * that creates the profiler, which has to be the one running the network */
+
+typedef enum
+{
+  PROFILER_CYCLES,
+  PROFILER_INSTRUCTIONS,
+  PROFILER_CACHE_REFERENCES,  /* Last level cache */
+  PROFILER_CACHE_MISSES,
+  PROFILER_L1D_MISSES,
+  PROFILER_BRANCH_MISSES,
+  PROFILER_FP_SCALAR,         /* Single precision FP operations retired, Intel only */
+  PROFILER_FP_128,
+  PROFILER_FP_256,
+  PROFILER_FP_512,
+  PROFILER_EVENTS
+} SbsProfilerEvent;
+
+typedef struct SbsProfiler SbsProfiler;
+
+/* Note: cycles are aggregated in 'ranges' buckets of 'range_cycles' update cycles each,
+ * counted from the last network reset; later cycles fall in the last bucket */
+SbsProfiler * SbsProfiler_new(uint16_t layers, uint32_t range_cycles, uint16_t ranges);
+void SbsProfiler_delete(SbsProfiler ** profiler);
+
+/* Note: installs the profiler as phase hook of 'network', NULL detaches it */
+void SbsProfiler_attach(SbsProfiler * profiler, SbsNetwork * network);
+void SbsProfiler_reset(SbsProfiler * profiler);
+
+/* Returns a mask of 1 << SbsProfilerEvent with the counters that could be opened */
+uint32_t SbsProfiler_getEvents(SbsProfiler * profiler);
+
+/* Scaled event count of a layer phase, summed over the cycle ranges */
+uint64_t SbsProfiler_getCount(SbsProfiler * profiler, uint16_t layer, SbsPhase phase,
+                              SbsProfilerEvent event);
+
+/* Note: per layer and phase: IPC, miss rates, FLOP rate, vector share and the roofline
+ * coordinates (FLOP per DRAM byte estimated from last level misses), then IPC per range */
+void SbsProfiler_print(SbsProfiler * profiler);
+
+#endif /* SBS_PROFILER_H_ */
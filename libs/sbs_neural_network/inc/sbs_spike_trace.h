@@ -0,0 +1,100 @@
+/*
+ * sbs_spike_trace.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+
+#ifndef SBS_SPIKE_TRACE_H_
+#define SBS_SPIKE_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Trace file: SbsSpikeTraceHeader, then one SbsSpikeTraceRecord per recorded
+ * layer and cycle, each followed by 'size' bytes of encoded SpikeIDs in raster order */
+
+#define SBS_SPIKE_TRACE_MAGIC   0x54534253 /* "SBST" */
+#define SBS_SPIKE_TRACE_VERSION 2 /* 2: 16-bit layer, 32-bit rows and columns */
+
+typedef enum
+{
+  TRACE_RAW,    /* 16-bit SpikeIDs */
+  TRACE_DELTA,  /* Zigzag varint of the change to the previous record of the layer */
+  TRACE_PACKED  /* A bit-width byte, then every SpikeID in that many bits */
+} SbsSpikeTraceEncoding;
+
+#pragma pack(push)
+#pragma pack(1)
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+} SbsSpikeTraceHeader;
+
+typedef struct
+{
+  uint16_t layer;
+  uint8_t  encoding;
+  uint8_t  reserved;
+  uint32_t rows;
+  uint32_t columns;
+  uint32_t cycle;
+  uint32_t size;
+} SbsSpikeTraceRecord;
+
+#pragma pack(pop)
+
+typedef struct
+{
+  uint64_t records;
+  uint64_t raw_size;      /* Bytes the records take as TRACE_RAW */
+  uint64_t written_size;  /* Bytes written to the file */
+  uint64_t stalls;        /* Records that waited for the ring buffer to drain */
+} SbsSpikeTraceStatistics;
+
+typedef struct SbsSpikeTrace SbsSpikeTrace;
+
+/* Note: records go through a preallocated ring buffer of 'buffer_size' bytes, drained
+ * by a background thread on Linux and synchronously when full on the board */
+SbsSpikeTrace * SbsSpikeTrace_new(const char * file_name,
+                                  size_t buffer_size,
+                                  SbsSpikeTraceEncoding encoding);
+void SbsSpikeTrace_delete(SbsSpikeTrace ** trace);
+
+/* Note: records layer i when bit i of 'layer_mask' is set, and cycles
+ * first_cycle, first_cycle + stride, ... up to last_cycle. Default: everything.
+ * Only the first 32 layers can be traced */
+void SbsSpikeTrace_setFilter(SbsSpikeTrace * trace,
+                             uint32_t layer_mask,
+                             uint32_t first_cycle,
+                             uint32_t last_cycle,
+                             uint32_t stride);
+
+int  SbsSpikeTrace_isSampled(SbsSpikeTrace * trace, uint16_t layer, uint32_t cycle);
+void SbsSpikeTrace_record(SbsSpikeTrace * trace,
+                          uint16_t layer,
+                          uint32_t cycle,
+                          const uint16_t * spike,
+                          uint32_t rows,
+                          uint32_t columns);
+void SbsSpikeTrace_flush(SbsSpikeTrace * trace);
+void SbsSpikeTrace_getStatistics(SbsSpikeTrace * trace, SbsSpikeTraceStatistics * statistics);
+
+#ifndef USE_XILINX
+/* Offline decoding */
+typedef struct SbsSpikeTraceReader SbsSpikeTraceReader;
+
+SbsSpikeTraceReader * SbsSpikeTraceReader_new(const char * file_name);
+void SbsSpikeTraceReader_delete(SbsSpikeTraceReader ** reader);
+
+/* Note: decodes the next record into 'spike', which stays valid until the next call.
+ * Returns 0 at the end of the trace or on a malformed record */
+int  SbsSpikeTraceReader_next(SbsSpikeTraceReader * reader,
+                              SbsSpikeTraceRecord * record,
+                              const uint16_t ** spike);
+#endif
+
+#endif /* SBS_SPIKE_TRACE_H_ */
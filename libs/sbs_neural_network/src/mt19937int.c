@@ -36,7 +36,7 @@
 #include "mt19937int.h"
 
 /* Period parameters */  
-#define N 624
+#define N MT19937_N
 #define M 397
 #define MATRIX_A 0x9908b0df   /* constant vector a */
 #define UPPER_MASK 0x80000000 /* most significant w-r bits */
@@ -50,14 +50,13 @@
 #define TEMPERING_SHIFT_T(y)  (y << 15)
 #define TEMPERING_SHIFT_L(y)  (y >> 18)
 
-static unsigned long mt[N]; /* the array for the state vector  */
-static int mti=N+1; /* mti==N+1 means mt[N] is not initialized */
+static MT19937 MT19937_instance = { {0}, N+1 }; /* mti==N+1 means mt[N] is not initialized */
 
 /* initializing the array with a NONZERO seed */
-void
-sgenrand(seed)
-    unsigned long seed;	
+void MT19937_sgenrand(MT19937 * generator, unsigned long seed)
 {
+    unsigned long * mt = generator->mt;
+    int mti;
     /* setting initial seeds to mt[N] using         */
     /* the generator Line 25 of Table 1 in          */
     /* [KNUTH 1981, The Art of Computer Programming */
@@ -65,20 +64,21 @@ sgenrand(seed)
     mt[0]= seed & 0xffffffff;
     for (mti=1; mti<N; mti++)
         mt[mti] = (69069 * mt[mti-1]) & 0xffffffff;
+    generator->mti = mti;
 }
 
-unsigned long 
-genrand()
+unsigned long MT19937_genrand(MT19937 * generator)
 {
+    unsigned long * mt = generator->mt;
     unsigned long y;
-    static unsigned long mag01[2]={0x0, MATRIX_A};
+    static const unsigned long mag01[2]={0x0, MATRIX_A};
     /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
-    if (mti >= N) { /* generate N words at one time */
+    if (generator->mti >= N) { /* generate N words at one time */
         int kk;
 
-        if (mti == N+1)   /* if sgenrand() has not been called, */
-            sgenrand(4357); /* a default initial seed is used   */
+        if (generator->mti == N+1)   /* if sgenrand() has not been called, */
+            MT19937_sgenrand(generator, 4357); /* a default initial seed is used   */
 
         for (kk=0;kk<N-M;kk++) {
             y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
@@ -91,10 +91,10 @@ genrand()
         y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
         mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1];
 
-        mti = 0;
+        generator->mti = 0;
     }
   
-    y = mt[mti++];
+    y = mt[generator->mti++];
     y ^= TEMPERING_SHIFT_U(y);
     y ^= TEMPERING_SHIFT_S(y) & TEMPERING_MASK_B;
     y ^= TEMPERING_SHIFT_T(y) & TEMPERING_MASK_C;
@@ -103,6 +103,20 @@ genrand()
     return y; 
 }
 
+/* Process-wide generator, kept for single-threaded callers */
+void
+sgenrand(seed)
+    unsigned long seed;	
+{
+    MT19937_sgenrand(&MT19937_instance, seed);
+}
+
+unsigned long 
+genrand()
+{
+    return MT19937_genrand(&MT19937_instance);
+}
+
 /* this main() outputs first 1000 generated numbers  */
 /*
 main()
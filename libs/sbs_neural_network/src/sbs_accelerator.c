@@ -0,0 +1,466 @@
+/*
+ * sbs_accelerator.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+
+#include "sbs_accelerator.h"
+#include "sbs_neural_network.h"
+
+#ifdef USE_XILINX
+#include "xtime_l.h"
+#else
+#include "pthread.h"
+#include "time.h"
+#endif
+
+#define ASSERT(expr)  assert(expr)
+
+#define SBS_ACCELERATOR_BANDS_PER_WORKER 2 /* Position bands per descriptor and worker */
+
+/*****************************************************************************/
+
+typedef enum
+{
+  SLOT_FREE,
+  SLOT_QUEUED,  /* Bands left to hand out */
+  SLOT_RUNNING, /* All bands handed out, some still running */
+  SLOT_DONE
+} SbsSlotStatus;
+
+typedef struct
+{
+  SbsUpdateDescriptor descriptor;
+  uint32_t            ticket;
+  uint8_t             status;
+  uint32_t            positions;
+  uint32_t            bands;
+  uint32_t            next_band;
+  uint32_t            finished_bands;
+} SbsAcceleratorSlot;
+
+typedef struct
+{
+  SbsAccelerator       vtbl;
+  SbsAcceleratorSlot * slot;      /* Ring of 'depth' slots */
+  uint16_t             depth;
+  uint32_t             head;      /* Next slot to fill */
+  uint32_t             tail;      /* Oldest slot with bands to hand out */
+  uint32_t             ticket;    /* Last ticket issued */
+  uint8_t              workers;
+#ifndef USE_XILINX
+  pthread_t *          thread;
+  pthread_mutex_t      mutex;
+  pthread_cond_t       work_cond; /* Workers wait for descriptors */
+  pthread_cond_t       done_cond; /* wait() waits for completions */
+  uint8_t              stop;
+#endif
+  SbsAcceleratorStatistics statistics;
+} SbsCpuAccelerator;
+
+/*****************************************************************************/
+
+static double SbsCpuAccelerator_now(void)
+{
+#ifdef USE_XILINX
+  XTime time;
+  XTime_GetTime(&time);
+  return (double) time / (double) COUNTS_PER_SECOND;
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+/* One kernel update, the arithmetic of SbsBaseLayer_updateIP in the same order */
+static void SbsCpuAccelerator_updateIP(float * state_vector, const float * weight_vector,
+                                       uint16_t neurons, float epsilon, float reverse_epsilon)
+{
+  float    sum = 0.0f;
+  float    epsion_over_sum;
+  float    h;
+  uint16_t neuron;
+
+  for (neuron = 0; neuron < neurons; neuron ++)
+    sum += state_vector[neuron] * weight_vector[neuron];
+
+  if (sum < SBS_UPDATE_MIN_SUM)
+    return;
+
+  epsion_over_sum = epsilon / sum;
+
+  for (neuron = 0; neuron < neurons; neuron ++)
+  {
+    h = state_vector[neuron];
+    state_vector[neuron] = reverse_epsilon * (h + (h * weight_vector[neuron]) * epsion_over_sum);
+  }
+}
+
+/* Kernel updates of the positions [first, last) of a descriptor */
+static void SbsCpuAccelerator_updatePositions(const SbsUpdateDescriptor * descriptor,
+                                              uint32_t first, uint32_t last)
+{
+  uint16_t  neurons      = descriptor->neurons;
+  uint16_t  kernel_size  = descriptor->kernel_size;
+  uint16_t  row_shift    = kernel_size;
+  uint16_t  column_shift = 1;
+  float     reverse_epsilon = 1.0f / (1.0f + descriptor->epsilon);
+  float *   state_vector;
+  const float * weight_vector;
+  uint32_t  position;
+  uint32_t  weight_row;
+  uint32_t  kernel_row_pos;
+  uint32_t  kernel_column_pos;
+  uint16_t  kernel_row;
+  uint16_t  kernel_column;
+
+  if (descriptor->weight_shift == 0) /* ROW_SHIFT */
+  {
+    row_shift = 1;
+    column_shift = kernel_size;
+  }
+
+  for (position = first; position < last; position ++)
+  {
+    state_vector      = &descriptor->state[(size_t) position * neurons];
+    kernel_row_pos    = (position / descriptor->columns) * descriptor->kernel_stride;
+    kernel_column_pos = (position % descriptor->columns) * descriptor->kernel_stride;
+
+    for (kernel_row = 0; kernel_row < kernel_size; kernel_row ++)
+    {
+      for (kernel_column = 0; kernel_column < kernel_size; kernel_column ++)
+      {
+        weight_row = descriptor->spike[(size_t) (kernel_row_pos + kernel_row) * descriptor->spike_columns
+                                       + kernel_column_pos + kernel_column]
+                   + (uint32_t) (kernel_row * row_shift + kernel_column * column_shift)
+                     * descriptor->neurons_previous_layer;
+
+        ASSERT(weight_row < descriptor->weight_rows);
+
+        if (descriptor->weight_rows <= weight_row)
+          continue;
+
+        weight_vector = &descriptor->weight[(size_t) weight_row * neurons];
+
+        SbsCpuAccelerator_updateIP(state_vector, weight_vector, neurons,
+                                   descriptor->epsilon, reverse_epsilon);
+      }
+    }
+  }
+}
+
+static void SbsCpuAccelerator_runBand(SbsAcceleratorSlot * slot, uint32_t band)
+{
+  SbsCpuAccelerator_updatePositions(&slot->descriptor,
+                                    (uint32_t) ((uint64_t) slot->positions * band / slot->bands),
+                                    (uint32_t) ((uint64_t) slot->positions * (band + 1) / slot->bands));
+}
+
+#ifndef USE_XILINX
+static void * SbsCpuAccelerator_workerThread(void * argument)
+{
+  SbsCpuAccelerator *  device = argument;
+  SbsAcceleratorSlot * slot;
+  uint32_t             band;
+  double               start;
+
+  pthread_mutex_lock(&device->mutex);
+  while (!device->stop)
+  {
+    slot = &device->slot[device->tail % device->depth];
+
+    if ((device->tail == device->head) || (slot->status != SLOT_QUEUED))
+    {
+      pthread_cond_wait(&device->work_cond, &device->mutex);
+      continue;
+    }
+
+    band = slot->next_band ++;
+    if (slot->next_band == slot->bands)
+    {
+      slot->status = SLOT_RUNNING;
+      device->tail ++;
+    }
+
+    pthread_mutex_unlock(&device->mutex);
+
+    start = SbsCpuAccelerator_now();
+    SbsCpuAccelerator_runBand(slot, band);
+    start = SbsCpuAccelerator_now() - start;
+
+    pthread_mutex_lock(&device->mutex);
+
+    device->statistics.busy_time += start;
+
+    if (++ slot->finished_bands == slot->bands)
+    {
+      slot->status = SLOT_DONE;
+      device->statistics.completed ++;
+      pthread_cond_broadcast(&device->done_cond);
+    }
+  }
+  pthread_mutex_unlock(&device->mutex);
+
+  return NULL;
+}
+#endif
+
+/*****************************************************************************/
+
+static void SbsCpuAccelerator_delete(SbsAccelerator ** device_ptr)
+{
+  SbsCpuAccelerator * device;
+
+  ASSERT(device_ptr != NULL);
+
+  if ((device_ptr == NULL) || (*device_ptr == NULL))
+    return;
+
+  device = (SbsCpuAccelerator *) *device_ptr;
+
+#ifndef USE_XILINX
+  if (device->thread != NULL)
+  {
+    uint8_t i;
+
+    pthread_mutex_lock(&device->mutex);
+    device->stop = 1;
+    pthread_cond_broadcast(&device->work_cond);
+    pthread_mutex_unlock(&device->mutex);
+
+    for (i = 0; i < device->workers; i ++)
+      pthread_join(device->thread[i], NULL);
+
+    free(device->thread);
+  }
+
+  pthread_cond_destroy(&device->done_cond);
+  pthread_cond_destroy(&device->work_cond);
+  pthread_mutex_destroy(&device->mutex);
+#endif
+
+  free(device->slot);
+  free(device);
+  *device_ptr = NULL;
+}
+
+static uint32_t SbsCpuAccelerator_submit(SbsAccelerator * device_ptr,
+                                         const SbsUpdateDescriptor * descriptor)
+{
+  SbsCpuAccelerator *  device = (SbsCpuAccelerator *) device_ptr;
+  SbsAcceleratorSlot * slot;
+  uint32_t             ticket = 0;
+
+  ASSERT(device != NULL);
+  ASSERT(descriptor != NULL);
+  ASSERT(descriptor->state != NULL);
+  ASSERT(descriptor->spike != NULL);
+  ASSERT(descriptor->weight != NULL);
+
+  if ((device == NULL) || (descriptor == NULL) || (descriptor->state == NULL)
+      || (descriptor->spike == NULL) || (descriptor->weight == NULL))
+    return 0;
+
+#ifndef USE_XILINX
+  pthread_mutex_lock(&device->mutex);
+#endif
+
+  slot = &device->slot[device->head % device->depth];
+
+  if (slot->status != SLOT_FREE)
+    device->statistics.queue_full ++;
+  else
+  {
+    /* Ticket 0 means refused, skip it on wrap around */
+    if (++ device->ticket == 0)
+      device->ticket = 1;
+
+    ticket = device->ticket;
+
+    slot->descriptor     = *descriptor;
+    slot->ticket         = ticket;
+    slot->positions      = (uint32_t) descriptor->rows * descriptor->columns;
+    slot->bands          = device->workers * SBS_ACCELERATOR_BANDS_PER_WORKER;
+    slot->next_band      = 0;
+    slot->finished_bands = 0;
+
+    if (slot->positions < slot->bands)
+      slot->bands = slot->positions;
+
+    if (slot->bands == 0)
+      slot->bands = 1;
+
+    device->head ++;
+    device->statistics.submitted ++;
+
+    if (device->workers == 0)
+    {
+      double start = SbsCpuAccelerator_now();
+
+      SbsCpuAccelerator_runBand(slot, 0);
+      slot->status = SLOT_DONE;
+      device->tail = device->head;
+      device->statistics.busy_time += SbsCpuAccelerator_now() - start;
+      device->statistics.completed ++;
+    }
+    else
+    {
+      slot->status = SLOT_QUEUED;
+#ifndef USE_XILINX
+      pthread_cond_broadcast(&device->work_cond);
+#endif
+    }
+  }
+
+#ifndef USE_XILINX
+  pthread_mutex_unlock(&device->mutex);
+#endif
+
+  return ticket;
+}
+
+/* Checks, with the mutex held on Linux */
+static int SbsCpuAccelerator_retire(SbsCpuAccelerator * device, uint32_t ticket)
+{
+  SbsAcceleratorSlot * slot = &device->slot[(ticket - 1) % device->depth];
+
+  if ((slot->ticket == ticket) && (slot->status == SLOT_DONE))
+  {
+    slot->status = SLOT_FREE;
+    return 1;
+  }
+
+  return 0;
+}
+
+static int SbsCpuAccelerator_poll(SbsAccelerator * device_ptr, uint32_t ticket)
+{
+  SbsCpuAccelerator * device = (SbsCpuAccelerator *) device_ptr;
+  int                 done;
+
+  ASSERT(device != NULL);
+  ASSERT(ticket != 0);
+
+  if ((device == NULL) || (ticket == 0))
+    return 0;
+
+#ifndef USE_XILINX
+  pthread_mutex_lock(&device->mutex);
+#endif
+
+  done = SbsCpuAccelerator_retire(device, ticket);
+
+#ifndef USE_XILINX
+  pthread_mutex_unlock(&device->mutex);
+#endif
+
+  return done;
+}
+
+static void SbsCpuAccelerator_wait(SbsAccelerator * device_ptr, uint32_t ticket)
+{
+  SbsCpuAccelerator * device = (SbsCpuAccelerator *) device_ptr;
+
+  ASSERT(device != NULL);
+  ASSERT(ticket != 0);
+
+  if ((device == NULL) || (ticket == 0))
+    return;
+
+#ifdef USE_XILINX
+  SbsCpuAccelerator_retire(device, ticket);
+#else
+  SbsAcceleratorSlot * slot = &device->slot[(ticket - 1) % device->depth];
+
+  pthread_mutex_lock(&device->mutex);
+
+  /* A ticket already retired or reused is complete */
+  while ((slot->ticket == ticket) && (slot->status != SLOT_FREE)
+         && !SbsCpuAccelerator_retire(device, ticket))
+    pthread_cond_wait(&device->done_cond, &device->mutex);
+
+  pthread_mutex_unlock(&device->mutex);
+#endif
+}
+
+static void SbsCpuAccelerator_getStatistics(SbsAccelerator * device_ptr,
+                                            SbsAcceleratorStatistics * statistics)
+{
+  SbsCpuAccelerator * device = (SbsCpuAccelerator *) device_ptr;
+
+  ASSERT(device != NULL);
+  ASSERT(statistics != NULL);
+
+  if ((device == NULL) || (statistics == NULL))
+    return;
+
+#ifndef USE_XILINX
+  pthread_mutex_lock(&device->mutex);
+#endif
+
+  *statistics = device->statistics;
+
+#ifndef USE_XILINX
+  pthread_mutex_unlock(&device->mutex);
+#endif
+}
+
+static const SbsAccelerator _SbsCpuAccelerator = {SbsCpuAccelerator_delete,
+                                                  SbsCpuAccelerator_submit,
+                                                  SbsCpuAccelerator_poll,
+                                                  SbsCpuAccelerator_wait,
+                                                  SbsCpuAccelerator_getStatistics};
+
+SbsAccelerator * SbsCpuAccelerator_new(uint8_t workers, uint16_t queue_depth)
+{
+  SbsCpuAccelerator * device = calloc(1, sizeof(SbsCpuAccelerator));
+
+  ASSERT(device != NULL);
+  ASSERT(0 < queue_depth);
+
+  if (device == NULL)
+    return NULL;
+
+  device->vtbl  = _SbsCpuAccelerator;
+  device->depth = (0 < queue_depth) ? queue_depth : 1;
+  device->slot  = calloc(device->depth, sizeof(SbsAcceleratorSlot));
+
+  ASSERT(device->slot != NULL);
+
+  if (device->slot == NULL)
+  {
+    free(device);
+    return NULL;
+  }
+
+#ifndef USE_XILINX
+  pthread_mutex_init(&device->mutex, NULL);
+  pthread_cond_init(&device->work_cond, NULL);
+  pthread_cond_init(&device->done_cond, NULL);
+
+  if (0 < workers)
+  {
+    device->thread = malloc(workers * sizeof(pthread_t));
+
+    ASSERT(device->thread != NULL);
+
+    /* Workers that fail to start leave fewer workers */
+    for (device->workers = 0;
+         (device->thread != NULL) && (device->workers < workers)
+         && (pthread_create(&device->thread[device->workers], NULL,
+                            SbsCpuAccelerator_workerThread, device) == 0);
+         device->workers ++);
+  }
+#else
+  (void) workers;
+#endif
+
+  return (SbsAccelerator *) device;
+}
@@ -12,16 +12,45 @@
 #include "assert.h"
 #include "stddef.h"
 #include "stdarg.h"
+#include "float.h"
+#include "math.h"
 
 #include "sbs_neural_network.h"
 #include "mt19937int.h"
+#include "buffered_file.h"
 
 #ifdef USE_XILINX
-#include "ff.h"
+#include "xtime_l.h"
+#else
+#include "pthread.h"
+#include "time.h"
+#include "unistd.h"
 #endif
 
 #define ASSERT(expr)  assert(expr)
 
+#define SBS_PROGRESS_INTERVAL      100  /* Default SbsOption values */
+#define SBS_SPARSE_STATE_INTERVAL  10
+#define SBS_SPARSE_STATE_SWITCH    0.5f
+#define SBS_DEFAULT_SEED           666
+
+#define SBS_AUTOTUNE_ROUNDS        5     /* Best time of, per variant */
+#define SBS_AUTOTUNE_CALLS         2000  /* Kernel calls per round */
+
+#define SBS_ENSEMBLE_SEED_STRIDE   0x9E3779B9u /* Seed distance between ensemble chains */
+
+#define SBS_ASYNC_WORKERS          64    /* Most inference pool threads */
+
+#define SBS_WEIGHT_MAP_SIZE        (64 << 20) /* Weight matrices used in place from a file mapping */
+
+/* Weight matrices past the weight arena come from the heap, opt-in on the board */
+#ifndef USE_XILINX
+#define SBS_WEIGHT_HEAP
+#endif
+
+#define SBS_SAMPLING_STRATA        16
+#define SBS_SAMPLING_R1_ALPHA      0.6180339887498949 /* 1 / golden ratio */
+
 /*****************************************************************************/
 #pragma pack(push)  /* push current alignment to stack */
 #pragma pack(1)     /* set alignment to 1 byte boundary */
@@ -35,17 +64,90 @@ typedef struct
   void *   data;
   size_t   data_type_size;
   uint8_t  dimensionality;
-  uint16_t dimension_size[1]; /*[0] = rows, [1] = columns, [2] = neurons... [n] = N*/
+  uint8_t  heap_data;         /* 'data' was allocated past the arena, freed with the multivector */
+  uint32_t dimension_size[1]; /*[0] = rows, [1] = columns, [2] = neurons... [n] = N*/
 } Multivector;
 
+/* Strided view of a [rows][columns][neurons] tensor, matrices have one
+ * neuron. The strides (in elements) are computed once when the view is made;
+ * slices and tiles are views of the same data, nothing is copied */
+typedef struct
+{
+  void *   data;
+  uint32_t size[3];    /* [0] = rows, [1] = columns, [2] = neurons */
+  size_t   stride[3];
+  uint8_t  element_size;
+} TensorView;
+
+typedef struct
+{
+  uint32_t * row_index;    /* [rows + 1] offsets into column_index and value */
+  uint16_t * column_index;
+  Weight *   value;
+  uint32_t   rows;
+  uint16_t   columns;
+} SparseMatrix;
+
+typedef struct
+{
+  uint8_t * block;
+  size_t    size;
+  size_t    index;
+  size_t    heap_size;  /* Requests that did not fit, allocated on the heap */
+} MemoryBlock;
+
+typedef struct
+{
+  SbsContext  vtbl;
+  MemoryBlock memory;
+  MT19937     random;
+  uint32_t    seed;
+  uint32_t    seed_count;  /* seed() calls, ensemble chains follow them */
+  uint16_t    progress_interval;
+  uint16_t    sparse_state_interval;
+  float       sparse_state_switch;
+  uint8_t     sampling;
+  uint16_t    update_tile;
+} SbsBaseContext;
+
+typedef struct
+{
+  SbsLayerTelemetry counters;
+  double            state_change; /* Sum over neurons and cycles */
+  uint32_t *        spike_histogram;
+  NeuronState *     previous_state;
+} SbsTelemetry;
+
 typedef struct
 {
   SbsLayer      vtbl;
 
+  SbsBaseContext * context;    /* Assigned by SbsNetwork::giveLayer */
   Multivector * state_matrix;
   Multivector * weight_matrix;
   Multivector * spike_matrix;
+  TensorView    state;         /* Views of the matrices above, bound once their data is placed */
+  TensorView    weights;
+  TensorView    spikes;
+  uint8_t       state_layout;  /* StateLayout */
+  NeuronState * vector_buffer; /* Gathered neuron vector, NEURON_MAJOR only */
   NeuronState * update_buffer;
+  SparseMatrix* sparse_weight_matrix;
+  float         prune_threshold;
+  NeuronState * scale_vector;  /* Pending normalization factor per position (sparse update) */
+  UpdateOrder   update_order;
+  uint32_t *    order_row;     /* Weight row of every kernel update (WEIGHT_ROW_ORDER), of the window (WINDOW_ORDER) */
+  uint32_t *    order_position;
+  uint32_t *    order_offset;
+  float         sparse_state_threshold;
+  uint16_t      sparse_state_top_k;
+  uint16_t      sparse_state_counter;
+  uint16_t *    active_count;  /* Tracked entries per position, 'neurons' while dense */
+  uint16_t *    active_index;  /* [positions * neurons] tracked neuron indices */
+  SbsTelemetry* telemetry;     /* NULL while not collected */
+  uint32_t *    sample_offset; /* Per position: sequence offset, scramble or last draw (SbsSampling) */
+  uint8_t       update_variant;/* Dispatch slots, SbsUpdateVariant and SbsSpikeVariant */
+  uint8_t       spike_variant;
   uint16_t      kernel_size;
   uint16_t      kernel_stride;
   uint16_t      neurons_previous_Layer;
@@ -53,47 +155,279 @@ typedef struct
   float         epsilon;
 } SbsBaseLayer;
 
+/* Chains 1 .. ensemble_size - 1 of an ensemble run on threads that live as
+ * long as the ensemble, step() hands them the cycles and waits for them */
+#ifndef USE_XILINX
+typedef struct
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t  start_cond;  /* Chains wait for a step */
+  pthread_cond_t  done_cond;   /* step() waits for the chains */
+  uint32_t        generation;  /* Steps started */
+  uint8_t         pending;     /* Chains still running the current step */
+  uint8_t         stop;
+  uint16_t        cycles;
+} SbsEnsembleSync;
+#endif
+
+typedef struct
+{
+  SbsNetwork *      network;
+#ifndef USE_XILINX
+  SbsEnsembleSync * sync;
+  pthread_t         thread;
+  uint8_t           started;     /* Else step() runs the chain itself */
+  uint32_t          generation;  /* Last step run */
+#endif
+} SbsEnsembleJob;
+
 typedef struct
 {
   SbsNetwork        vtbl;
-  uint8_t           size;
+  SbsBaseContext *  context;
+  uint16_t          size;
   SbsBaseLayer **   layer_array;
   uint8_t           input_label;
   uint8_t           inferred_output;
+  uint32_t          cycle;  /* Update cycles since the last reset */
+  uint8_t           ready;  /* Hidden layers initialized */
+  float             warm_start_blend;
+  SbsSpikeTrace *   spike_trace;
+  SbsPhaseHook      phase_hook;
+  void *            phase_hook_data;
+  uint8_t *         memory_begin;      /* Arena span of the layer buffers */
+  size_t            memory_size;
+  uint8_t           memory_contiguous; /* No other allocation inside the span */
+  uint8_t           autotune;          /* Tune the layers given from now on */
+  char *            autotune_cache;
+  uint8_t           ensemble_size;     /* Chains, this network is chain 0 */
+  SbsNetwork **     ensemble;          /* The other ensemble_size - 1 chains, built by step() */
+  NeuronState *     ensemble_output;   /* Mean output vector of the chains */
+  uint32_t          ensemble_seed_count; /* Context seed() calls the chains were seeded at */
+  SbsEnsembleJob *  ensemble_job;      /* [ensemble_size], job 0 is this network */
+#ifndef USE_XILINX
+  SbsEnsembleSync * ensemble_sync;     /* NULL while the chains run in step() */
+#endif
+  SbsAccelerator *  accelerator;
+  uint32_t *        ticket;            /* [size] layer updates in flight on the accelerator */
+  uint8_t           async_state;       /* SbsAsyncState, guarded by the pool mutex */
+  uint16_t          async_cycles;
+  SbsInferenceCallback async_callback;
+  void *            async_data;
+  SbsNetwork *      async_next;        /* Pool queue */
 } SbsBaseNetwork;
 
+#define SBS_SNAPSHOT_MAGIC   0x43534253 /* "SBSC" */
+#define SBS_SNAPSHOT_VERSION 4  /* 2: 16-bit layer count, 32-bit rows and columns
+                                  * 3: buffers at their arena alignment in the data part
+                                  * 4: sampling offsets */
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t layers;
+  uint8_t  ready;
+  uint8_t  input_label;
+  uint8_t  inferred_output;
+  uint8_t  reserved;
+  uint32_t cycle;
+  int32_t  random_index;
+  uint32_t random_state[MT19937_N];
+  uint64_t data_size;    /* Layer states and spikes, in layer order */
+  uint64_t sparse_size;  /* Sparse-state tracking of the layers that have it */
+  uint64_t sampling_size;  /* Sampling offsets of the layers that have them */
+} SbsSnapshotHeader;
+
+typedef struct
+{
+  uint32_t rows;
+  uint32_t columns;
+  uint16_t neurons;
+  uint16_t sparse_state_counter;
+  uint8_t  sparse_state;  /* active_count and active_index follow in the sparse part */
+  uint8_t  state_layout;  /* Of the layer data in the data part */
+  uint8_t  sampling;      /* sample_offset follows in the sampling part */
+  uint8_t  reserved;
+} SbsSnapshotLayer;
+
 
 #pragma pack(pop)   /* restore original alignment from stack */
 
 /*****************************************************************************/
 /************************ Memory manager *************************************/
-#define        MEMORY_SIZE    4763116
+#define        MEMORY_SIZE    234944  /* Layer buffers of the MNIST example, see SbsMemory_plan() */
+
+/* Arena of the default context, with room to align its first buffer */
+static uint8_t Memory_block[MEMORY_SIZE + SBS_MEMORY_ALIGNMENT - 1];
 
-static size_t  Memory_blockIndex = 0;
+static size_t Memory_align(size_t size)
+{
+  return (size + SBS_MEMORY_ALIGNMENT - 1) & ~(size_t) (SBS_MEMORY_ALIGNMENT - 1);
+}
 
-static void * Memory_requestBlock(size_t size)
+/* Every buffer starts on an SBS_MEMORY_ALIGNMENT boundary */
+static void * MemoryBlock_request(MemoryBlock * memory, size_t size)
 {
-  static uint8_t Memory_block[MEMORY_SIZE];
   void * ptr = NULL;
+  size_t padding = (size_t) -(uintptr_t) &memory->block[memory->index] & (SBS_MEMORY_ALIGNMENT - 1);
 
-  if (Memory_blockIndex + size <= sizeof(Memory_block))
+  if ((padding <= memory->size - memory->index) && (size <= memory->size - memory->index - padding))
   {
-    ptr = (void *) &Memory_block[Memory_blockIndex];
-    Memory_blockIndex += size;
+    ptr = (void *) &memory->block[memory->index + padding];
+    memory->index += padding + size;
   }
 
   return ptr;
 }
 
-static size_t Memory_getBlockSize(void)
+static size_t MemoryBlock_getSize(MemoryBlock * memory)
+{
+  return memory->index + memory->heap_size;
+}
+
+/* Product of two sizes, 0 when it does not fit in a size_t */
+static size_t Size_multiply(size_t a, size_t b)
+{
+  return ((b != 0) && (SIZE_MAX / b < a)) ? 0 : a * b;
+}
+
+/*****************************************************************************/
+
+static SbsContext * SbsBaseContext_new(size_t memory_size, uint32_t seed)
+{
+  SbsBaseContext * context = malloc(sizeof(SbsBaseContext));
+
+  ASSERT(context != NULL);
+  ASSERT(0 < memory_size);
+
+  if (context != NULL)
+  {
+    memset(context, 0x00, sizeof(SbsBaseContext));
+
+    context->vtbl         = _SbsContext;
+    /* Zeroed: the padding between buffers goes into checkpoints as it is */
+    context->memory.block = calloc(1, memory_size + SBS_MEMORY_ALIGNMENT - 1);
+    context->memory.size  = memory_size + SBS_MEMORY_ALIGNMENT - 1;
+
+    context->progress_interval     = SBS_PROGRESS_INTERVAL;
+    context->sparse_state_interval = SBS_SPARSE_STATE_INTERVAL;
+    context->sparse_state_switch   = SBS_SPARSE_STATE_SWITCH;
+
+    context->seed = seed;
+    MT19937_sgenrand(&context->random, seed);
+
+    ASSERT(context->memory.block != NULL);
+
+    if (context->memory.block == NULL)
+    {
+      free(context);
+      context = NULL;
+    }
+  }
+
+  return (SbsContext *) context;
+}
+
+static SbsBaseContext SbsBaseContext_default;
+
+static void SbsBaseContext_delete(SbsContext ** context_ptr)
+{
+  ASSERT(context_ptr != NULL);
+  ASSERT(*context_ptr != NULL);
+  ASSERT(*context_ptr != (SbsContext *) &SbsBaseContext_default);
+
+  if ((context_ptr != NULL) && (*context_ptr != NULL)
+      && (*context_ptr != (SbsContext *) &SbsBaseContext_default))
+  {
+    SbsBaseContext ** context = (SbsBaseContext **) context_ptr;
+    free((*context)->memory.block);
+    free(*context);
+    *context = NULL;
+  }
+}
+
+static void SbsBaseContext_seed(SbsContext * context_ptr, uint32_t seed)
+{
+  SbsBaseContext * context = (SbsBaseContext *) context_ptr;
+
+  ASSERT(context != NULL);
+
+  if (context != NULL)
+  {
+    context->seed = seed;
+    context->seed_count ++;
+    MT19937_sgenrand(&context->random, seed);
+  }
+}
+
+static void SbsBaseContext_setOption(SbsContext * context_ptr, SbsOption option, float value)
+{
+  SbsBaseContext * context = (SbsBaseContext *) context_ptr;
+
+  ASSERT(context != NULL);
+  ASSERT(0.0f <= value);
+
+  if ((context != NULL) && (0.0f <= value))
+  {
+    switch (option)
+    {
+      case PROGRESS_INTERVAL:
+        context->progress_interval = (uint16_t) value;
+        break;
+      case SPARSE_STATE_INTERVAL:
+        context->sparse_state_interval = (1.0f <= value) ? (uint16_t) value : 1;
+        break;
+      case SPARSE_STATE_SWITCH:
+        context->sparse_state_switch = value;
+        break;
+      case SAMPLING:
+        ASSERT(value <= SAMPLING_ANTITHETIC);
+        if (value <= SAMPLING_ANTITHETIC)
+          context->sampling = (uint8_t) value;
+        break;
+      case UPDATE_TILE:
+        context->update_tile = (value < 0xFFFF) ? (uint16_t) value : 0xFFFF;
+        break;
+      default:
+        ASSERT(0);
+    }
+  }
+}
+
+static size_t SbsBaseContext_getMemorySize(SbsContext * context)
 {
-  return Memory_blockIndex;
+  size_t size = 0;
+
+  ASSERT(context != NULL);
+
+  if (context != NULL)
+    size = MemoryBlock_getSize(&((SbsBaseContext *) context)->memory);
+
+  return size;
 }
 
+static SbsBaseContext SbsBaseContext_default = {
+    { SbsBaseContext_new,
+      SbsBaseContext_delete,
+      SbsBaseContext_seed,
+      SbsBaseContext_setOption,
+      SbsBaseContext_getMemorySize },
+    { Memory_block, sizeof(Memory_block), 0, 0 },
+    { {0}, MT19937_N + 1 },
+    SBS_DEFAULT_SEED,
+    0,
+    SBS_PROGRESS_INTERVAL,
+    SBS_SPARSE_STATE_INTERVAL,
+    SBS_SPARSE_STATE_SWITCH,
+    SAMPLING_RANDOM,
+    0 };
+
 /*****************************************************************************/
 /*****************************************************************************/
 
-static Multivector * Multivector_new(uint8_t data_type_size, uint8_t dimensionality, ...)
+/* A NULL 'memory' leaves 'data' unassigned until Multivector_allocate */
+static Multivector * Multivector_new(MemoryBlock * memory, uint8_t data_type_size, uint8_t dimensionality, ...)
 {
   Multivector * multivector = NULL;
 
@@ -101,7 +435,7 @@ static Multivector * Multivector_new(uint8_t data_type_size, uint8_t dimensional
 
   if (0 <= dimensionality)
   {
-    size_t memory_size = sizeof(Multivector) + (dimensionality - 1) * sizeof(uint16_t);
+    size_t memory_size = sizeof(Multivector) + (dimensionality - 1) * sizeof(uint32_t);
     multivector = malloc(memory_size);
 
     ASSERT(multivector != NULL);
@@ -116,715 +450,3712 @@ static Multivector * Multivector_new(uint8_t data_type_size, uint8_t dimensional
 
       va_start(argument_list, dimensionality);
 
-      for (data_size = 1, arg = 0; arg < dimensionality; arg ++)
-        data_size *= (multivector->dimension_size[arg] = (uint16_t) va_arg(argument_list, int));
+      for (data_size = data_type_size, arg = 0; arg < dimensionality; arg ++)
+        data_size = Size_multiply(data_size, multivector->dimension_size[arg] = va_arg(argument_list, uint32_t));
 
       va_end(argument_list);
 
-      multivector->data = Memory_requestBlock(data_size * data_type_size);
+      multivector->dimensionality = dimensionality;
+      multivector->data_type_size = data_type_size;
+
+      /* Every index into the data is below data_size, so size_t arithmetic cannot overflow */
+      ASSERT(0 < data_size);
 
-      ASSERT(multivector->data != NULL);
+      if (data_size == 0)
+      {
+        free(multivector);
+        return NULL;
+      }
 
-      if (multivector->data != NULL)
-        memset(multivector->data, 0x00, data_size * data_type_size);
+      if (memory != NULL)
+      {
+        multivector->data = MemoryBlock_request(memory, data_size);
 
-      multivector->dimensionality = dimensionality;
-      multivector->data_type_size = data_type_size;
+        ASSERT(multivector->data != NULL);
+
+        if (multivector->data != NULL)
+          memset(multivector->data, 0x00, data_size);
+      }
     }
   }
 
   return multivector;
 }
 
-static void Multivector_delete(Multivector ** multivector)
+static size_t Multivector_dataSize(Multivector * multivector)
 {
-  ASSERT(multivector != NULL);
-  ASSERT(*multivector != NULL);
+  size_t  data_size = multivector->data_type_size;
+  uint8_t dimension;
 
-  if ((multivector != NULL) && (*multivector != NULL))
-  {
-    free(*multivector);
-    *multivector = NULL;
-  }
+  for (dimension = 0; dimension < multivector->dimensionality; dimension ++)
+    data_size *= multivector->dimension_size[dimension];
+
+  return data_size;
 }
 
-void * Multivector_2DAccess(Multivector * multivector, uint16_t row, uint16_t column)
+static void * Multivector_allocate(Multivector * multivector, MemoryBlock * memory)
 {
-  void * data = NULL;
-  ASSERT (multivector != NULL);
-  ASSERT (multivector->data != NULL);
-  ASSERT (2 <= multivector->dimensionality);
-  ASSERT (row <= multivector->dimension_size[0]);
-  ASSERT (column <= multivector->dimension_size[1]);
+  ASSERT(multivector != NULL);
+  ASSERT(memory != NULL);
 
-  if ((multivector != NULL)
-      && (multivector->data != NULL)
-      && (2 <= multivector->dimensionality)
-      && (row <= multivector->dimension_size[0])
-      && (column <= multivector->dimension_size[1]))
+  if ((multivector != NULL) && (memory != NULL) && (multivector->data == NULL))
   {
-    uint16_t dimensionality = multivector->dimensionality;
-    size_t data_size = multivector->data_type_size;
+    size_t data_size = Multivector_dataSize(multivector);
+
+    multivector->data = MemoryBlock_request(memory, data_size);
 
-    while (dimensionality-- > 2)
+    /* Past the arena the buffer comes from the heap */
+    if (multivector->data == NULL)
     {
-      data_size *= multivector->dimension_size[dimensionality];
+      multivector->data = malloc(data_size);
+      multivector->heap_data = (multivector->data != NULL);
+
+      if (multivector->data != NULL)
+        memory->heap_size += data_size;
     }
 
-    data = multivector->data
-        + (row * multivector->dimension_size[1] + column) * data_size;
+    ASSERT(multivector->data != NULL);
+
+    if (multivector->data != NULL)
+      memset(multivector->data, 0x00, data_size);
   }
 
-  return data;
+  return (multivector != NULL) ? multivector->data : NULL;
 }
 
-static void Multivector_saveToCSV(Multivector * multivector, char * file_name)
+static void Multivector_delete(Multivector ** multivector)
 {
   ASSERT(multivector != NULL);
-  ASSERT(file_name != NULL);
-  if ((multivector != NULL) && (file_name != NULL))
-  {
-    FILE * file = fopen (file_name, "w");
-    ASSERT(file != NULL);
-
-    if (file != NULL)
-    {
-      int row;
-      int column;
-      char * cell_ending;
+  ASSERT(*multivector != NULL);
 
-      for (row = 0; row < multivector->dimension_size[0]; row++)
-      {
-        for (column = 0; column < multivector->dimension_size[1]; column++)
-        {
-          cell_ending =
-              (column == multivector->dimension_size[1] - 1) ? "\n" : ",";
+  if ((multivector != NULL) && (*multivector != NULL))
+  {
+    if ((*multivector)->heap_data)
+      free((*multivector)->data);
 
-          fprintf (file, "%d%s",
-              *(SpikeID *) Multivector_2DAccess (multivector, row, column),
-              cell_ending);
-        }
-      }
-      fclose(file);
-    }
+    free(*multivector);
+    *multivector = NULL;
   }
 }
-/*****************************************************************************/
-/*****************************************************************************/
 
-static SbsLayer * SbsBaseLayer_new(uint16_t rows,
-                                   uint16_t columns,
-                                   uint16_t neurons,
-                                   uint16_t kernel_size,
-                                   uint16_t kernel_stride,
-                                   WeightShift weight_shift,
-                                   uint16_t    neurons_previous_Layer)
+/************************ Tensor view ****************************************/
+
+/* View of a whole [rows][columns][neurons] tensor stored as 'layout' */
+static TensorView TensorView_new(void * data, uint8_t element_size, uint32_t rows,
+                                 uint32_t columns, uint32_t neurons, StateLayout layout)
 {
-  SbsBaseLayer * layer = malloc(sizeof(SbsBaseLayer));
+  TensorView view;
 
-  ASSERT(layer != NULL);
+  view.data         = data;
+  view.element_size = element_size;
+  view.size[0]      = rows;
+  view.size[1]      = columns;
+  view.size[2]      = neurons;
 
-  if (layer != NULL)
+  if (layout == NEURON_MAJOR)
   {
-    Multivector * state_matrix = NULL;
-    Multivector * spike_matrix = NULL;
+    view.stride[0] = columns;
+    view.stride[1] = 1;
+    view.stride[2] = (size_t) rows * columns;
+  }
+  else
+  {
+    view.stride[0] = (size_t) columns * neurons;
+    view.stride[1] = neurons;
+    view.stride[2] = 1;
+  }
 
-    memset(layer, 0x00, sizeof(SbsBaseLayer));
+  return view;
+}
 
-    layer->vtbl = _SbsLayer;
+static TensorView Multivector_view(Multivector * multivector, StateLayout layout)
+{
+  ASSERT(multivector != NULL);
+  ASSERT((1 <= multivector->dimensionality) && (multivector->dimensionality <= 3));
 
-    /* Instantiate state_matrix */
-    state_matrix = Multivector_new(sizeof(NeuronState), 3, rows, columns, neurons);
+  return TensorView_new(multivector->data, multivector->data_type_size,
+                        multivector->dimension_size[0],
+                        (1 < multivector->dimensionality) ? multivector->dimension_size[1] : 1,
+                        (2 < multivector->dimensionality) ? multivector->dimension_size[2] : 1,
+                        layout);
+}
 
-    ASSERT(state_matrix != NULL);
-    ASSERT(state_matrix->dimensionality == 3);
-    ASSERT(state_matrix->data != NULL);
-    ASSERT(state_matrix->dimension_size[0] == rows);
-    ASSERT(state_matrix->dimension_size[1] == columns);
-    ASSERT(state_matrix->dimension_size[2] == neurons);
+/* Entries [first, first + count) of 'dimension': a band of rows or columns,
+ * or a range of neurons */
+static TensorView TensorView_slice(const TensorView * view, uint8_t dimension,
+                                   uint32_t first, uint32_t count)
+{
+  TensorView slice = *view;
 
-    layer->state_matrix = state_matrix;
+  ASSERT(dimension < 3);
+  ASSERT((first <= view->size[dimension]) && (count <= view->size[dimension] - first));
 
-    /* Instantiate spike_matrix */
-    spike_matrix = Multivector_new(sizeof(SpikeID), 2, rows, columns);
+  slice.data = (uint8_t *) view->data + first * view->stride[dimension] * view->element_size;
+  slice.size[dimension] = count;
 
-    ASSERT(spike_matrix != NULL);
-    ASSERT(spike_matrix->dimensionality == 2);
-    ASSERT(spike_matrix->data != NULL);
-    ASSERT(spike_matrix->dimension_size[0] == rows);
-    ASSERT(spike_matrix->dimension_size[1] == columns);
+  return slice;
+}
 
-    layer->spike_matrix = spike_matrix;
+/* 'rows' x 'columns' positions from ('row', 'column') */
+static TensorView TensorView_tile(const TensorView * view, uint32_t row, uint32_t column,
+                                  uint32_t rows, uint32_t columns)
+{
+  TensorView tile = TensorView_slice(view, 0, row, rows);
+  return TensorView_slice(&tile, 1, column, columns);
+}
 
-    /* Allocate update buffer */
+/* Element offset of the first neuron of ('row', 'column') */
+static size_t TensorView_offset(const TensorView * view, uint32_t row, uint32_t column)
+{
+  return (size_t) row * view->stride[0] + (size_t) column * view->stride[1];
+}
 
-    layer->update_buffer = malloc(neurons * sizeof(NeuronState));
+/* Element offset of the first neuron of a position numbered in raster
+ * order, for whole tensors only: their rows follow each other */
+static size_t TensorView_positionOffset(const TensorView * view, size_t position)
+{
+  return position * view->stride[1];
+}
 
-    ASSERT(layer->update_buffer != NULL);
+static void * TensorView_at(const TensorView * view, uint32_t row, uint32_t column)
+{
+  return (uint8_t *) view->data + TensorView_offset(view, row, column) * view->element_size;
+}
 
-    if (layer->update_buffer != NULL)
-    	memset(layer->update_buffer, 0x00, neurons * sizeof(NeuronState));
+/* The neuron vector at 'offset' of a NeuronState view: in place when the
+ * neurons are contiguous, otherwise gathered into 'buffer' */
+static NeuronState * TensorView_getVector(const TensorView * view, size_t offset, NeuronState * buffer)
+{
+  NeuronState * vector = &((NeuronState *) view->data)[offset];
+  size_t        stride = view->stride[2];
+  uint32_t      neuron;
 
-    /* Assign parameters */
-    layer->kernel_size   = kernel_size;
-    layer->kernel_stride = kernel_stride;
-    layer->weight_shift  = weight_shift;
-    layer->neurons_previous_Layer = neurons_previous_Layer;
-  }
+  if (stride == 1)
+    return vector;
 
-  return (SbsLayer *) layer;
+  for (neuron = 0; neuron < view->size[2]; neuron ++)
+    buffer[neuron] = vector[neuron * stride];
+
+  return buffer;
 }
 
-static void SbsBaseLayer_delete(SbsLayer ** layer_ptr)
+/* Where the vector at 'offset' is written before TensorView_putVector() */
+static NeuronState * TensorView_vectorBuffer(const TensorView * view, size_t offset, NeuronState * buffer)
 {
-  ASSERT(layer_ptr!= NULL);
-  ASSERT(*layer_ptr!= NULL);
-  if ((layer_ptr!= NULL) && (*layer_ptr!= NULL))
-  {
-    SbsBaseLayer ** layer = (SbsBaseLayer **)layer_ptr;
-    Multivector_delete(&((*layer)->state_matrix));
-    Multivector_delete(&((*layer)->spike_matrix));
-    if ((*layer)->weight_matrix != NULL) Multivector_delete(&((*layer)->weight_matrix));
-    free((*layer)->update_buffer);
-    free(*layer);
-    *layer = NULL;
-  }
+  return (view->stride[2] == 1) ? &((NeuronState *) view->data)[offset] : buffer;
 }
 
-
-static void SbsBaseLayer_initializeIP(NeuronState * state_vector, uint16_t size)
+/* Stores a vector of TensorView_getVector() or TensorView_vectorBuffer() */
+static void TensorView_putVector(const TensorView * view, size_t offset, const NeuronState * vector)
 {
-  ASSERT(state_vector != NULL);
-  ASSERT(0 < size);
+  NeuronState * destination = &((NeuronState *) view->data)[offset];
+  size_t        stride = view->stride[2];
+  uint32_t      neuron;
 
-  if ((state_vector != NULL) && (0 < size))
-  {
-      float    initial_value_h = 1.0f / size;
-      uint16_t neuron;
-      for (neuron = 0; neuron < size; neuron ++)
-        state_vector[neuron] = initial_value_h;
-  }
+  if (vector != destination)
+    for (neuron = 0; neuron < view->size[2]; neuron ++)
+      destination[neuron * stride] = vector[neuron];
 }
 
-static void SbsBaseLayer_updateIP(SbsBaseLayer * layer, NeuronState * state_vector, Weight * weight_vector, uint16_t size, float epsilon)
+/*****************************************************************************/
+
+static SparseMatrix * SparseMatrix_new(Multivector * matrix, float threshold)
 {
-  ASSERT(state_vector != NULL);
-  ASSERT(weight_vector != NULL);
-  ASSERT(layer->update_buffer != NULL);
-  ASSERT(0 < size);
+  SparseMatrix * sparse_matrix = NULL;
 
-  if ((state_vector != NULL) && (weight_vector != NULL)
-      && (layer->update_buffer != NULL) && (0 < size))
-  {
-    NeuronState * temp_data     = layer->update_buffer;
+  ASSERT(matrix != NULL);
+  ASSERT(matrix->data != NULL);
+  ASSERT(matrix->dimensionality == 2);
 
-    NeuronState sum             = 0.0f;
-    NeuronState reverse_epsilon = 1.0f / (1.0f + epsilon);
-    NeuronState epsion_over_sum = 0.0f;
-    uint16_t    neuron;
+  if ((matrix != NULL) && (matrix->data != NULL) && (matrix->dimensionality == 2))
+  {
+    uint32_t rows    = matrix->dimension_size[0];
+    uint32_t columns = matrix->dimension_size[1];
+    Weight * data    = matrix->data;
+    size_t   size    = 0;
+    size_t   i;
 
-#if defined (__x86_64__) || defined(__amd64__)
-    for (neuron = 0; neuron < size; neuron ++)
-    {
-      temp_data[neuron] = state_vector[neuron] * weight_vector[neuron];
-      sum += temp_data[neuron];
-    }
+    for (i = 0; i < (size_t) rows * columns; i++)
+      size += (threshold < data[i]);
 
-    if (sum < 1e-20) // TODO: DEFINE constant
-      return;
+    /* 16-bit column indices, 32-bit row offsets */
+    ASSERT(columns <= 0xFFFF);
+    ASSERT(size <= 0xFFFFFFFF);
 
-    epsion_over_sum = epsilon / sum;
+    if ((0xFFFF < columns) || (0xFFFFFFFF < size))
+      return NULL;
 
-    for (neuron = 0; neuron < size; neuron ++)
-      state_vector[neuron] = reverse_epsilon * (state_vector[neuron] + temp_data[neuron] * epsion_over_sum);
+    sparse_matrix = malloc(sizeof(SparseMatrix));
 
-#elif defined(__arm__)
-    /* Support for unaligned accesses in ARM architecture */
-    NeuronState h;
-    NeuronState p;
-    NeuronState h_p;
-    NeuronState h_new;
+    ASSERT(sparse_matrix != NULL);
 
-    for (neuron = 0; neuron < size; neuron ++)
+    if (sparse_matrix != NULL)
     {
-      h = state_vector[neuron];
-      p = weight_vector[neuron];
-      h_p = h * p;
+      sparse_matrix->rows         = rows;
+      sparse_matrix->columns      = columns;
+      sparse_matrix->row_index    = malloc(((size_t) rows + 1) * sizeof(uint32_t));
+      sparse_matrix->column_index = malloc(size * sizeof(uint16_t) + 1);
+      sparse_matrix->value        = malloc(size * sizeof(Weight) + 1);
+
+      ASSERT(sparse_matrix->row_index != NULL);
+      ASSERT(sparse_matrix->column_index != NULL);
+      ASSERT(sparse_matrix->value != NULL);
+
+      if ((sparse_matrix->row_index != NULL)
+          && (sparse_matrix->column_index != NULL)
+          && (sparse_matrix->value != NULL))
+      {
+        uint32_t row;
+        uint16_t column;
 
-      temp_data[neuron] = h_p;
-      sum += h_p;
-    }
+        for (size = 0, row = 0; row < rows; row++)
+        {
+          sparse_matrix->row_index[row] = size;
+          for (column = 0; column < columns; column++)
+          {
+            Weight weight = data[(size_t) row * columns + column];
+            if (threshold < weight)
+            {
+              sparse_matrix->column_index[size] = column;
+              sparse_matrix->value[size] = weight;
+              size++;
+            }
+          }
+        }
+        sparse_matrix->row_index[rows] = size;
+      }
+      else
+      {
+        free(sparse_matrix->row_index);
+        free(sparse_matrix->column_index);
+        free(sparse_matrix->value);
+        free(sparse_matrix);
+        sparse_matrix = NULL;
+      }
+    }
+  }
+
+  return sparse_matrix;
+}
+
+static void SparseMatrix_delete(SparseMatrix ** sparse_matrix)
+{
+  ASSERT(sparse_matrix != NULL);
+  ASSERT(*sparse_matrix != NULL);
+
+  if ((sparse_matrix != NULL) && (*sparse_matrix != NULL))
+  {
+    free((*sparse_matrix)->row_index);
+    free((*sparse_matrix)->column_index);
+    free((*sparse_matrix)->value);
+    free(*sparse_matrix);
+    *sparse_matrix = NULL;
+  }
+}
+
+static size_t SparseMatrix_getMemorySize(SparseMatrix * sparse_matrix)
+{
+  size_t size = 0;
+
+  ASSERT(sparse_matrix != NULL);
+
+  if (sparse_matrix != NULL)
+    size = ((size_t) sparse_matrix->rows + 1) * sizeof(uint32_t)
+         + sparse_matrix->row_index[sparse_matrix->rows] * (sizeof(uint16_t) + sizeof(Weight));
+
+  return size;
+}
+
+/************************ Weight memory **************************************/
+/* Shared weights outlive the context arenas and come from an arena of their
+ * own, sized for the MNIST example as the layer buffers are. It is only
+ * rewound when its last matrix is freed, or the freed one is on top */
+
+#define WEIGHT_MEMORY_SIZE 4528384  /* 1132096 MNIST weights */
+
+static uint8_t     WeightMemory_block[WEIGHT_MEMORY_SIZE + SBS_MEMORY_ALIGNMENT - 1];
+static MemoryBlock WeightMemory = { WeightMemory_block, sizeof(WeightMemory_block), 0, 0 };
+static uint32_t    WeightMemory_count = 0; /* Matrices in the arena */
+
+#ifdef USE_XILINX
+#define WeightRegistry_lock()
+#define WeightRegistry_unlock()
+#else
+static pthread_mutex_t WeightRegistry_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define WeightRegistry_lock()   pthread_mutex_lock(&WeightRegistry_mutex)
+#define WeightRegistry_unlock() pthread_mutex_unlock(&WeightRegistry_mutex)
+#endif
+
+static void * WeightMemory_allocate(Multivector * matrix)
+{
+  size_t data_size = Multivector_dataSize(matrix);
+
+  WeightRegistry_lock();
+  matrix->data = MemoryBlock_request(&WeightMemory, data_size);
+  WeightMemory_count += (matrix->data != NULL);
+  WeightRegistry_unlock();
+
+#ifdef SBS_WEIGHT_HEAP
+  if (matrix->data == NULL)
+  {
+    matrix->data = malloc(data_size);
+    matrix->heap_data = (matrix->data != NULL);
+  }
+#endif
+
+  return matrix->data;
+}
+
+static void WeightMemory_release(Multivector * matrix)
+{
+  if (!matrix->heap_data && (matrix->data != NULL))
+  {
+    uint8_t * data = matrix->data;
+
+    WeightRegistry_lock();
+    if (-- WeightMemory_count == 0)
+      WeightMemory.index = 0;
+    else if (data + Multivector_dataSize(matrix) == &WeightMemory.block[WeightMemory.index])
+      WeightMemory.index = data - WeightMemory.block;
+    WeightRegistry_unlock();
+
+    matrix->data = NULL;
+  }
+}
+
+/*****************************************************************************/
+
+/* Large matrices are used in place from a read-only mapping of the file,
+ * left open in '*mapping', instead of being copied to the weight arena */
+static Multivector * SbsWeightMatrix_load(uint32_t rows, uint32_t columns, char * file_name,
+                                          BufferedFile ** mapping)
+{
+  Multivector * weight_watrix = NULL;
+
+  ASSERT(file_name != NULL);
+  ASSERT(mapping != NULL);
+
+  if ((file_name != NULL) && (mapping != NULL))
+  {
+    BufferedFile * file;
+    size_t         data_size;
+
+    *mapping = NULL;
+
+    /* Shared weights live outside any context arena, they outlive it */
+    weight_watrix = Multivector_new(NULL, sizeof(Weight), 2, rows, columns);
+
+    ASSERT(weight_watrix != NULL);
+
+    if (weight_watrix == NULL)
+      return NULL;
+
+    data_size = Multivector_dataSize(weight_watrix);
+    file = BufferedFile_new (file_name,
+                             (SBS_WEIGHT_MAP_SIZE <= data_size) ? BUFFERED_FILE_MMAP : BUFFERED_FILE_DEFAULT,
+                             0);
+
+    ASSERT(file != NULL);
+
+    /* A file shorter than the matrix returns NULL, for the caller to report */
+    if ((file != NULL) && (data_size <= BufferedFile_getSize (file)))
+    {
+      if (BufferedFile_getMapping (file) != NULL)
+      {
+        weight_watrix->data = (void *) BufferedFile_getMapping (file);
+        *mapping = file;
+        return weight_watrix;
+      }
+
+      WeightMemory_allocate(weight_watrix);
+
+      ASSERT(weight_watrix->data != NULL);
+
+      if (weight_watrix->data != NULL)
+      {
+        size_t read_result = BufferedFile_read (file, weight_watrix->data, data_size);
+
+        if (read_result == data_size)
+        {
+          BufferedFile_delete (&file);
+          return weight_watrix;
+        }
+
+        WeightMemory_release(weight_watrix);
+      }
+    }
+
+    if (file != NULL)
+      BufferedFile_delete (&file);
+
+    Multivector_delete(&weight_watrix);
+  }
+
+  return weight_watrix;
+}
+
+/************************ Weight registry ************************************/
+/* Weight matrices are shared read-only by every layer (and network) loading
+ * the same file, or the same content from another file, and freed when the
+ * last layer releases them. The registry lock is only taken on load and
+ * release, never during the update cycle. */
+
+typedef struct WeightRegistryEntry
+{
+  struct WeightRegistryEntry * next;
+  char *        file_name;
+  uint32_t      hash;
+  uint32_t      references;
+  Multivector * matrix;
+  BufferedFile* mapping;  /* Open while the matrix is mapped from it */
+} WeightRegistryEntry;
+
+static WeightRegistryEntry * WeightRegistry_list = NULL;
+
+/* FNV-1a over 32-bit words, a pass over matrices of hundreds of MB is a
+ * fraction of their load time */
+static uint32_t WeightRegistry_hash(Multivector * matrix)
+{
+  uint32_t * data = matrix->data;
+  size_t     size = Multivector_dataSize(matrix) / sizeof(uint32_t);
+  uint32_t   hash = 2166136261u;
+
+  while (size --)
+    hash = (hash ^ *data ++) * 16777619u;
+
+  return hash;
+}
+
+static int WeightRegistry_sameShape(Multivector * a, Multivector * b)
+{
+  return (a->dimension_size[0] == b->dimension_size[0])
+      && (a->dimension_size[1] == b->dimension_size[1]);
+}
+
+/* Must be called with the registry locked */
+static WeightRegistryEntry * WeightRegistry_find(char * file_name, uint32_t rows, uint32_t columns)
+{
+  WeightRegistryEntry * entry;
+
+  for (entry = WeightRegistry_list; entry != NULL; entry = entry->next)
+    if ((entry->file_name != NULL) && (strcmp(entry->file_name, file_name) == 0)
+        && (entry->matrix->dimension_size[0] == rows)
+        && (entry->matrix->dimension_size[1] == columns))
+      break;
+
+  return entry;
+}
+
+static void SbsWeightMatrix_free(Multivector * matrix, BufferedFile * mapping)
+{
+  if (mapping != NULL)
+    BufferedFile_delete(&mapping);
+  else
+    WeightMemory_release(matrix);
+
+  Multivector_delete(&matrix);
+}
+
+static SbsWeightMatrix SbsWeightMatrix_new(uint32_t rows, uint32_t columns, char * file_name)
+{
+  WeightRegistryEntry * entry;
+  Multivector *         matrix = NULL;
+  BufferedFile *        mapping = NULL;
+  uint32_t              hash;
+
+  ASSERT(file_name != NULL);
+
+  if (file_name == NULL)
+    return NULL;
+
+  WeightRegistry_lock();
+  entry = WeightRegistry_find(file_name, rows, columns);
+  if (entry != NULL)
+    entry->references ++;
+  WeightRegistry_unlock();
+
+  if (entry != NULL)
+    return entry->matrix;
+
+  /* Load outside the lock, file access is slow */
+  matrix = SbsWeightMatrix_load(rows, columns, file_name, &mapping);
+
+  if (matrix == NULL)
+    return NULL;
+
+  hash = WeightRegistry_hash(matrix);
+
+  WeightRegistry_lock();
+  entry = WeightRegistry_find(file_name, rows, columns);
+
+  if (entry == NULL)
+    for (entry = WeightRegistry_list; entry != NULL; entry = entry->next)
+      if ((entry->hash == hash)
+          && WeightRegistry_sameShape(entry->matrix, matrix)
+          && (memcmp(entry->matrix->data, matrix->data, Multivector_dataSize(matrix)) == 0))
+        break;
+
+  if (entry != NULL)
+  {
+    /* Loaded concurrently or same content under another name */
+    entry->references ++;
+    SbsWeightMatrix_free(matrix, mapping);
+    matrix = entry->matrix;
+  }
+  else
+  {
+    entry = malloc(sizeof(WeightRegistryEntry));
+
+    ASSERT(entry != NULL);
+
+    if (entry == NULL)
+    {
+      SbsWeightMatrix_free(matrix, mapping);
+      matrix = NULL;
+    }
+    else
+    {
+      entry->file_name  = malloc(strlen(file_name) + 1);
+      entry->hash       = hash;
+      entry->references = 1;
+      entry->matrix     = matrix;
+      entry->mapping    = mapping;
+      entry->next       = WeightRegistry_list;
+
+      if (entry->file_name != NULL)
+        strcpy(entry->file_name, file_name);
+
+      WeightRegistry_list = entry;
+    }
+  }
+  WeightRegistry_unlock();
+
+  return matrix;
+}
+
+static void SbsWeightMatrix_release(Multivector ** matrix)
+{
+  WeightRegistryEntry ** link;
+  WeightRegistryEntry *  entry = NULL;
+
+  ASSERT(matrix != NULL);
+  ASSERT(*matrix != NULL);
+
+  if ((matrix != NULL) && (*matrix != NULL))
+  {
+    WeightRegistry_lock();
+    for (link = &WeightRegistry_list; *link != NULL; link = &(*link)->next)
+    {
+      if ((*link)->matrix == *matrix)
+      {
+        entry = *link;
+        if (-- entry->references == 0)
+          *link = entry->next;
+        else
+          entry = NULL;
+        break;
+      }
+    }
+    WeightRegistry_unlock();
+
+    if (entry != NULL)
+    {
+      SbsWeightMatrix_free(entry->matrix, entry->mapping);
+      free(entry->file_name);
+      free(entry);
+    }
+
+    *matrix = NULL;
+  }
+}
+
+/* Another reference to a registered matrix */
+static Multivector * SbsWeightMatrix_acquire(Multivector * matrix)
+{
+  WeightRegistryEntry * entry;
+
+  ASSERT(matrix != NULL);
+
+  WeightRegistry_lock();
+  for (entry = WeightRegistry_list; entry != NULL; entry = entry->next)
+    if (entry->matrix == matrix)
+    {
+      entry->references ++;
+      break;
+    }
+  WeightRegistry_unlock();
+
+  ASSERT(entry != NULL);
+
+  return (entry != NULL) ? matrix : NULL;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+
+/* Views of the layer buffers, made again whenever their data or the state
+ * layout changes */
+static void SbsBaseLayer_bindViews(SbsBaseLayer * layer)
+{
+  layer->state  = Multivector_view(layer->state_matrix, layer->state_layout);
+  layer->spikes = Multivector_view(layer->spike_matrix, POSITION_MAJOR);
+
+  if (layer->weight_matrix != NULL)
+    layer->weights = Multivector_view(layer->weight_matrix, POSITION_MAJOR);
+}
+
+static SbsLayer * SbsBaseLayer_new(uint32_t rows,
+                                   uint32_t columns,
+                                   uint16_t neurons,
+                                   uint16_t kernel_size,
+                                   uint16_t kernel_stride,
+                                   WeightShift weight_shift,
+                                   uint16_t    neurons_previous_Layer)
+{
+  SbsBaseLayer * layer = malloc(sizeof(SbsBaseLayer));
+
+  ASSERT(layer != NULL);
+
+  if (layer != NULL)
+  {
+    Multivector * state_matrix = NULL;
+    Multivector * spike_matrix = NULL;
+
+    memset(layer, 0x00, sizeof(SbsBaseLayer));
+
+    layer->vtbl = _SbsLayer;
+
+    /* Instantiate state_matrix, its data is placed by SbsNetwork::giveLayer */
+    state_matrix = Multivector_new(NULL, sizeof(NeuronState), 3, rows, columns, neurons);
+
+    ASSERT(state_matrix != NULL);
+    ASSERT(state_matrix->dimensionality == 3);
+    ASSERT(state_matrix->dimension_size[0] == rows);
+    ASSERT(state_matrix->dimension_size[1] == columns);
+    ASSERT(state_matrix->dimension_size[2] == neurons);
+
+    layer->state_matrix = state_matrix;
+
+    /* Instantiate spike_matrix */
+    spike_matrix = Multivector_new(NULL, sizeof(SpikeID), 2, rows, columns);
+
+    ASSERT(spike_matrix != NULL);
+    ASSERT(spike_matrix->dimensionality == 2);
+    ASSERT(spike_matrix->dimension_size[0] == rows);
+    ASSERT(spike_matrix->dimension_size[1] == columns);
+
+    layer->spike_matrix = spike_matrix;
+
+    /* Dimensions whose buffers would not be addressable */
+    if ((state_matrix == NULL) || (spike_matrix == NULL))
+    {
+      if (state_matrix != NULL) Multivector_delete(&state_matrix);
+      if (spike_matrix != NULL) Multivector_delete(&spike_matrix);
+      free(layer);
+      return NULL;
+    }
+
+    SbsBaseLayer_bindViews(layer);
+
+    /* Allocate update buffer */
+
+    layer->update_buffer = malloc(neurons * sizeof(NeuronState));
+
+    ASSERT(layer->update_buffer != NULL);
+
+    if (layer->update_buffer != NULL)
+    	memset(layer->update_buffer, 0x00, neurons * sizeof(NeuronState));
+
+    /* Assign parameters */
+    layer->kernel_size   = kernel_size;
+    layer->kernel_stride = kernel_stride;
+    layer->weight_shift  = weight_shift;
+    layer->neurons_previous_Layer = neurons_previous_Layer;
+  }
+
+  return (SbsLayer *) layer;
+}
+
+static int SbsBaseLayer_allocateUpdateOrder(SbsBaseLayer * layer)
+{
+  size_t entries = (size_t) layer->state_matrix->dimension_size[0]
+                 * layer->state_matrix->dimension_size[1]
+                 * layer->kernel_size * layer->kernel_size;
+
+  if (layer->update_order == WINDOW_ORDER)
+  {
+    layer->order_row = malloc(layer->kernel_size * layer->kernel_size * sizeof(uint32_t));
+
+    ASSERT(layer->order_row != NULL);
+
+    return layer->order_row != NULL;
+  }
+
+  layer->order_row      = malloc(entries * sizeof(uint32_t));
+  layer->order_position = malloc(entries * sizeof(uint32_t));
+  layer->order_offset   = malloc(((size_t) layer->weight_matrix->dimension_size[0] + 1) * sizeof(uint32_t));
+
+  ASSERT(layer->order_row != NULL);
+  ASSERT(layer->order_position != NULL);
+  ASSERT(layer->order_offset != NULL);
+
+  return (layer->order_row != NULL)
+      && (layer->order_position != NULL)
+      && (layer->order_offset != NULL);
+}
+
+static void SbsBaseLayer_releaseUpdateOrder(SbsBaseLayer * layer)
+{
+  free(layer->order_row);
+  free(layer->order_position);
+  free(layer->order_offset);
+  layer->order_row      = NULL;
+  layer->order_position = NULL;
+  layer->order_offset   = NULL;
+}
+
+/************************ Telemetry ******************************************/
+
+static double SbsTelemetry_now(void)
+{
+#ifdef USE_XILINX
+  XTime time;
+  XTime_GetTime(&time);
+  return (double) time / (double) COUNTS_PER_SECOND;
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+#endif
+}
+
+static void SbsTelemetry_delete(SbsTelemetry ** telemetry)
+{
+  if (*telemetry != NULL)
+  {
+    free((*telemetry)->spike_histogram);
+    free((*telemetry)->previous_state);
+    free(*telemetry);
+    *telemetry = NULL;
+  }
+}
+
+static SbsTelemetry * SbsTelemetry_new(SbsBaseLayer * layer, uint32_t fields)
+{
+  uint16_t       neurons = layer->state_matrix->dimension_size[2];
+  size_t         size = (size_t) layer->state_matrix->dimension_size[0]
+                      * layer->state_matrix->dimension_size[1] * neurons;
+  SbsTelemetry * telemetry = calloc(1, sizeof(SbsTelemetry));
+
+  ASSERT(telemetry != NULL);
+
+  if (telemetry != NULL)
+  {
+    telemetry->counters.fields = fields;
+    telemetry->counters.neurons = neurons;
+
+    if (fields & TELEMETRY_SPIKES)
+      telemetry->spike_histogram = calloc(neurons, sizeof(uint32_t));
+
+    if (fields & TELEMETRY_STATE_CHANGE)
+      telemetry->previous_state = malloc(size * sizeof(NeuronState));
+
+    ASSERT(!(fields & TELEMETRY_SPIKES) || (telemetry->spike_histogram != NULL));
+    ASSERT(!(fields & TELEMETRY_STATE_CHANGE) || (telemetry->previous_state != NULL));
+
+    /* Fields without their buffers are dropped */
+    if (telemetry->spike_histogram == NULL)
+      telemetry->counters.fields &= ~TELEMETRY_SPIKES;
+    if (telemetry->previous_state == NULL)
+      telemetry->counters.fields &= ~TELEMETRY_STATE_CHANGE;
+  }
+
+  return telemetry;
+}
+
+static void SbsTelemetry_countSpikes(SbsTelemetry * telemetry, Multivector * spike_matrix)
+{
+  SpikeID * spike_data = spike_matrix->data;
+  size_t    size = (size_t) spike_matrix->dimension_size[0] * spike_matrix->dimension_size[1];
+  size_t    i;
+
+  for (i = 0; i < size; i ++)
+    if (spike_data[i] < telemetry->counters.neurons)
+      telemetry->spike_histogram[spike_data[i]] ++;
+}
+
+static double SbsTelemetry_stateChange(SbsTelemetry * telemetry, Multivector * state_matrix)
+{
+  NeuronState * state_data = state_matrix->data;
+  size_t        size = (size_t) state_matrix->dimension_size[0]
+                     * state_matrix->dimension_size[1] * state_matrix->dimension_size[2];
+  double        change = 0.0;
+  size_t        i;
+
+  for (i = 0; i < size; i ++)
+  {
+    NeuronState difference = state_data[i] - telemetry->previous_state[i];
+    change += (difference < 0.0f) ? -difference : difference;
+  }
+
+  return change / size;
+}
+
+static void SbsBaseLayer_delete(SbsLayer ** layer_ptr)
+{
+  ASSERT(layer_ptr!= NULL);
+  ASSERT(*layer_ptr!= NULL);
+  if ((layer_ptr!= NULL) && (*layer_ptr!= NULL))
+  {
+    SbsBaseLayer ** layer = (SbsBaseLayer **)layer_ptr;
+    Multivector_delete(&((*layer)->state_matrix));
+    Multivector_delete(&((*layer)->spike_matrix));
+    if ((*layer)->weight_matrix != NULL) SbsWeightMatrix_release(&((*layer)->weight_matrix));
+    if ((*layer)->sparse_weight_matrix != NULL) SparseMatrix_delete(&((*layer)->sparse_weight_matrix));
+    free((*layer)->update_buffer);
+    free((*layer)->vector_buffer);
+    free((*layer)->scale_vector);
+    SbsBaseLayer_releaseUpdateOrder(*layer);
+    free((*layer)->active_count);
+    free((*layer)->active_index);
+    SbsTelemetry_delete(&(*layer)->telemetry);
+    free((*layer)->sample_offset);
+    free(*layer);
+    *layer = NULL;
+  }
+}
+
+
+static void SbsBaseLayer_initializeIP(NeuronState * state_vector, uint16_t size)
+{
+  ASSERT(state_vector != NULL);
+  ASSERT(0 < size);
+
+  if ((state_vector != NULL) && (0 < size))
+  {
+      float    initial_value_h = 1.0f / size;
+      uint16_t neuron;
+      for (neuron = 0; neuron < size; neuron ++)
+        state_vector[neuron] = initial_value_h;
+  }
+}
+
+static uint8_t SbsBaseLayer_updateIP(SbsBaseLayer * layer, NeuronState * state_vector, Weight * weight_vector, uint16_t size, float epsilon)
+{
+  ASSERT(state_vector != NULL);
+  ASSERT(weight_vector != NULL);
+  ASSERT(layer->update_buffer != NULL);
+  ASSERT(0 < size);
+
+  if ((state_vector != NULL) && (weight_vector != NULL)
+      && (layer->update_buffer != NULL) && (0 < size))
+  {
+    NeuronState * temp_data     = layer->update_buffer;
+
+    NeuronState sum             = 0.0f;
+    NeuronState reverse_epsilon = 1.0f / (1.0f + epsilon);
+    NeuronState epsion_over_sum = 0.0f;
+    uint16_t    neuron;
+
+#if defined (__x86_64__) || defined(__amd64__)
+    for (neuron = 0; neuron < size; neuron ++)
+    {
+      temp_data[neuron] = state_vector[neuron] * weight_vector[neuron];
+      sum += temp_data[neuron];
+    }
+
+    if (sum < SBS_UPDATE_MIN_SUM)
+      return 0;
+
+    epsion_over_sum = epsilon / sum;
+
+    for (neuron = 0; neuron < size; neuron ++)
+      state_vector[neuron] = reverse_epsilon * (state_vector[neuron] + temp_data[neuron] * epsion_over_sum);
+
+#elif defined(__arm__)
+    /* Support for unaligned accesses in ARM architecture */
+    NeuronState h;
+    NeuronState p;
+    NeuronState h_p;
+    NeuronState h_new;
+
+    for (neuron = 0; neuron < size; neuron ++)
+    {
+      h = state_vector[neuron];
+      p = weight_vector[neuron];
+      h_p = h * p;
+
+      temp_data[neuron] = h_p;
+      sum += h_p;
+    }
+
+    if (sum < SBS_UPDATE_MIN_SUM)
+      return 0;
+
+    epsion_over_sum = epsilon / sum;
+
+    for (neuron = 0; neuron < size; neuron ++)
+    {
+      h_p = temp_data[neuron];
+      h = state_vector[neuron];
+
+      h_new = reverse_epsilon * (h + h_p * epsion_over_sum);
+      state_vector[neuron] = h_new;
+    }
+#else
+#error "Unsupported processor architecture"
+#endif
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Variant of SbsBaseLayer_updateIP recomputing the products in the second
+ * pass instead of buffering them, without the update_buffer traffic, which
+ * pays off on short state vectors. The same operations in the same order,
+ * so bit-identical unless the compiler contracts them into fused
+ * multiply-adds, where -ffp-contract=off keeps them apart. */
+static uint8_t SbsBaseLayer_updateRecomputeIP(SbsBaseLayer * layer, NeuronState * state_vector, Weight * weight_vector, uint16_t size, float epsilon)
+{
+  (void) layer;
+
+  ASSERT(state_vector != NULL);
+  ASSERT(weight_vector != NULL);
+  ASSERT(0 < size);
+
+  if ((state_vector != NULL) && (weight_vector != NULL) && (0 < size))
+  {
+    NeuronState sum             = 0.0f;
+    NeuronState reverse_epsilon = 1.0f / (1.0f + epsilon);
+    NeuronState epsion_over_sum = 0.0f;
+    NeuronState h;
+    uint16_t    neuron;
+
+    for (neuron = 0; neuron < size; neuron ++)
+      sum += state_vector[neuron] * weight_vector[neuron];
+
+    if (sum < SBS_UPDATE_MIN_SUM)
+      return 0;
+
+    epsion_over_sum = epsilon / sum;
+
+    for (neuron = 0; neuron < size; neuron ++)
+    {
+      h = state_vector[neuron];
+      state_vector[neuron] = reverse_epsilon * (h + (h * weight_vector[neuron]) * epsion_over_sum);
+    }
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Sparse counterpart of SbsBaseLayer_updateIP. Pruned weights leave their
+ * neurons scaled by 1 / (1 + epsilon) only, so that factor is accumulated in
+ * '*scale' instead of touching the whole state vector; the true state is
+ * (*scale) * state_vector until SbsBaseLayer_applyScale folds it back. */
+static uint8_t SbsBaseLayer_updateSparseIP(NeuronState * state_vector,
+                                           NeuronState * scale,
+                                           uint16_t *    column_index,
+                                           Weight *      value,
+                                           uint32_t      length,
+                                           float         epsilon)
+{
+  ASSERT(state_vector != NULL);
+  ASSERT(scale != NULL);
+
+  if ((state_vector != NULL) && (scale != NULL))
+  {
+    NeuronState sum             = 0.0f;
+    NeuronState epsion_over_sum = 0.0f;
+    uint32_t    i;
+
+    for (i = 0; i < length; i ++)
+      sum += state_vector[column_index[i]] * value[i];
+
+    sum *= *scale;
+
+    if (sum < SBS_UPDATE_MIN_SUM)
+      return 0;
+
+    epsion_over_sum = epsilon / sum;
+
+    for (i = 0; i < length; i ++)
+    {
+      NeuronState h = state_vector[column_index[i]];
+      state_vector[column_index[i]] = h + h * value[i] * epsion_over_sum;
+    }
+
+    *scale *= 1.0f / (1.0f + epsilon);
+    return 1;
+  }
+
+  return 0;
+}
+
+static void SbsBaseLayer_applyScale(SbsBaseLayer * layer)
+{
+  ASSERT(layer != NULL);
+  ASSERT(layer->scale_vector != NULL);
+
+  if ((layer != NULL) && (layer->scale_vector != NULL))
+  {
+    TensorView *  state        = &layer->state;
+    NeuronState * state_data   = state->data;
+    size_t        positions    = (size_t) state->size[0] * state->size[1];
+    size_t        stride       = state->stride[2];
+    uint16_t      neurons      = state->size[2];
+    size_t        position;
+    uint16_t      neuron;
+
+    for (position = 0; position < positions; position ++)
+    {
+      NeuronState scale = layer->scale_vector[position];
+      if (scale != 1.0f)
+      {
+        NeuronState * state_vector = &state_data[TensorView_positionOffset(state, position)];
+        for (neuron = 0; neuron < neurons; neuron ++)
+          state_vector[neuron * stride] *= scale;
+        layer->scale_vector[position] = 1.0f;
+      }
+    }
+  }
+}
+
+/* Sparse-state counterpart of SbsBaseLayer_updateIP. Untracked neurons are
+ * exactly zero and the update is multiplicative, so they stay zero and only
+ * the tracked entries need to be visited. */
+static uint8_t SbsBaseLayer_updateSparseStateIP(SbsBaseLayer * layer,
+                                                NeuronState * state_vector,
+                                                uint16_t *    active_index,
+                                                uint16_t      active_count,
+                                                Weight *      weight_vector,
+                                                float         epsilon)
+{
+  NeuronState * temp_data       = layer->update_buffer;
+  NeuronState   sum             = 0.0f;
+  NeuronState   reverse_epsilon = 1.0f / (1.0f + epsilon);
+  NeuronState   epsion_over_sum = 0.0f;
+  uint16_t      i;
+
+  for (i = 0; i < active_count; i ++)
+  {
+    temp_data[i] = state_vector[active_index[i]] * weight_vector[active_index[i]];
+    sum += temp_data[i];
+  }
+
+  if (sum < SBS_UPDATE_MIN_SUM)
+    return 0;
+
+  epsion_over_sum = epsilon / sum;
+
+  for (i = 0; i < active_count; i ++)
+    state_vector[active_index[i]] = reverse_epsilon * (state_vector[active_index[i]] + temp_data[i] * epsion_over_sum);
+
+  return 1;
+}
+
+static SpikeID SbsBaseLayer_generateSparseSpikeIP(NeuronState * state_vector,
+                                                  uint16_t *    active_index,
+                                                  uint16_t      active_count,
+                                                  NeuronState   random_s)
+{
+  NeuronState sum      = 0.0f;
+  uint16_t    i;
+
+  ASSERT(0 < active_count);
+
+  for (i = 0; i < active_count; i ++)
+  {
+    sum += state_vector[active_index[i]];
+
+    if (random_s <= sum)
+      return active_index[i];
+  }
+
+  return active_index[active_count - 1];
+}
+
+/* Returns the k-th largest of 'data' (k >= 1), reordering 'data' */
+static NeuronState SbsBaseLayer_selectIP(NeuronState * data, uint16_t size, uint16_t k)
+{
+  uint16_t left  = 0;
+  uint16_t right = size - 1;
+
+  ASSERT(0 < k && k <= size);
+
+  while (left < right)
+  {
+    NeuronState pivot = data[(left + right) / 2];
+    uint16_t    i     = left;
+    uint16_t    j     = right;
+
+    while (i <= j)
+    {
+      while (pivot < data[i]) i ++;
+      while (data[j] < pivot) j --;
+      if (i <= j)
+      {
+        NeuronState temp = data[i];
+        data[i] = data[j];
+        data[j] = temp;
+        i ++;
+        if (j == 0) break;
+        j --;
+      }
+    }
+
+    if (k - 1 <= j)     right = j;
+    else if (i <= k - 1) left = i;
+    else break;
+  }
+
+  return data[k - 1];
+}
+
+/* Switch-over policy: with 'top_k' the position keeps its k largest entries
+ * once the mass outside them is at most 'threshold'; otherwise it keeps the
+ * entries of at least 'threshold' once they are at most SPARSE_STATE_SWITCH
+ * of the tracked ones. Dropped mass is redistributed over the kept entries. */
+static void SbsBaseLayer_sparsifyIP(SbsBaseLayer * layer, size_t position)
+{
+  uint16_t      neurons      = layer->state.size[2];
+  size_t        offset       = TensorView_positionOffset(&layer->state, position);
+  NeuronState * state_vector = TensorView_getVector(&layer->state, offset, layer->vector_buffer);
+  uint16_t *    active_index = &layer->active_index[position * neurons];
+  uint16_t      active_count = layer->active_count[position];
+  NeuronState   cutoff       = layer->sparse_state_threshold;
+  NeuronState   kept_mass    = 0.0f;
+  NeuronState   dropped_mass = 0.0f;
+  uint16_t      kept         = 0;
+  uint16_t      i;
+
+  if (0 < layer->sparse_state_top_k)
+  {
+    if (active_count <= layer->sparse_state_top_k)
+      return;
+
+    for (i = 0; i < active_count; i ++)
+      layer->update_buffer[i] = state_vector[active_index[i]];
+
+    cutoff = SbsBaseLayer_selectIP(layer->update_buffer, active_count, layer->sparse_state_top_k);
+  }
+
+  for (i = 0; i < active_count; i ++)
+  {
+    NeuronState h = state_vector[active_index[i]];
+    if (cutoff <= h)
+    {
+      kept_mass += h;
+      kept ++;
+    }
+    else
+      dropped_mass += h;
+  }
+
+  if ((kept == 0) || (kept == active_count) || (kept_mass <= 0.0f))
+    return;
+
+  if ((0 < layer->sparse_state_top_k)
+      ? (layer->sparse_state_threshold < dropped_mass)
+      : (layer->context->sparse_state_switch * active_count < kept))
+    return;
+
+  {
+    NeuronState renormalize = (kept_mass + dropped_mass) / kept_mass;
+
+    for (kept = 0, i = 0; i < active_count; i ++)
+    {
+      uint16_t neuron = active_index[i];
+      if (cutoff <= state_vector[neuron])
+      {
+        state_vector[neuron] *= renormalize;
+        active_index[kept ++] = neuron;
+      }
+      else
+        state_vector[neuron] = 0.0f;
+    }
+
+    TensorView_putVector(&layer->state, offset, state_vector);
+
+    layer->active_count[position] = kept;
+  }
+}
+
+static void SbsBaseLayer_resetSparseState(SbsBaseLayer * layer)
+{
+  size_t   positions = (size_t) layer->state_matrix->dimension_size[0] * layer->state_matrix->dimension_size[1];
+  uint16_t neurons   = layer->state_matrix->dimension_size[2];
+  size_t   position;
+  uint16_t neuron;
+
+  for (position = 0; position < positions; position ++)
+  {
+    layer->active_count[position] = neurons;
+    for (neuron = 0; neuron < neurons; neuron ++)
+      layer->active_index[position * neurons + neuron] = neuron;
+  }
+
+  layer->sparse_state_counter = 0;
+}
+
+static SpikeID SbsBaseLayer_generateSpikeIP(NeuronState * state_vector, uint16_t size, NeuronState random_s)
+{
+  ASSERT(state_vector != NULL);
+  ASSERT(0 < size);
+
+  if ((state_vector != NULL) && (0 < size))
+  {
+    NeuronState sum      = 0.0f;
+    SpikeID     spikeID;
+
+    ASSERT(random_s <= 1.0F);
+
+    for (spikeID = 0; spikeID < size; spikeID ++)
+    {
+        sum += state_vector[spikeID];
+
+        ASSERT(sum <= 1 + 1e-5);
+
+        if (random_s <= sum)
+              return spikeID;
+    }
+  }
+
+  return size - 1;
+}
+
+/* Variant of SbsBaseLayer_generateSpikeIP testing four partial sums per
+ * branch. The sums are accumulated in the same order and never decrease,
+ * so the number of them below 'random_s' is the offset of the spike. */
+static SpikeID SbsBaseLayer_generateSpikeBlockIP(NeuronState * state_vector, uint16_t size, NeuronState random_s)
+{
+  ASSERT(state_vector != NULL);
+  ASSERT(0 < size);
+
+  if ((state_vector != NULL) && (0 < size))
+  {
+    NeuronState sum      = 0.0f;
+    NeuronState s0;
+    NeuronState s1;
+    NeuronState s2;
+    SpikeID     spikeID;
+
+    ASSERT(random_s <= 1.0F);
+
+    for (spikeID = 0; spikeID + 4 <= size; spikeID += 4)
+    {
+      s0  = sum + state_vector[spikeID];
+      s1  = s0 + state_vector[spikeID + 1];
+      s2  = s1 + state_vector[spikeID + 2];
+      sum = s2 + state_vector[spikeID + 3];
+
+      ASSERT(sum <= 1 + 1e-5);
+
+      if (random_s <= sum)
+        return spikeID + (s0 < random_s) + (s1 < random_s) + (s2 < random_s);
+    }
+
+    for (; spikeID < size; spikeID ++)
+    {
+      sum += state_vector[spikeID];
+
+      if (random_s <= sum)
+        return spikeID;
+    }
+  }
+
+  return size - 1;
+}
+
+/* Kernel variants selectable per layer, see SbsBaseNetwork_tuneLayer */
+typedef enum
+{
+  UPDATE_BUFFERED,
+  UPDATE_RECOMPUTE,
+  UPDATE_VARIANTS
+} SbsUpdateVariant;
+
+typedef enum
+{
+  SPIKE_LINEAR,
+  SPIKE_BLOCK,
+  SPIKE_VARIANTS
+} SbsSpikeVariant;
+
+typedef uint8_t (*SbsUpdateKernel)(SbsBaseLayer * layer, NeuronState * state_vector,
+                                   Weight * weight_vector, uint16_t size, float epsilon);
+typedef SpikeID (*SbsSpikeKernel)(NeuronState * state_vector, uint16_t size, NeuronState random_s);
+
+static const SbsUpdateKernel SbsBaseLayer_updateKernel[UPDATE_VARIANTS] =
+    { SbsBaseLayer_updateIP, SbsBaseLayer_updateRecomputeIP };
+static const SbsSpikeKernel SbsBaseLayer_spikeKernel[SPIKE_VARIANTS] =
+    { SbsBaseLayer_generateSpikeIP, SbsBaseLayer_generateSpikeBlockIP };
+
+static const char * SbsBaseLayer_updateVariantName[UPDATE_VARIANTS] = { "buffered", "recompute" };
+static const char * SbsBaseLayer_spikeVariantName[SPIKE_VARIANTS] = { "linear", "block" };
+
+/* Blends the current state towards the uniform distribution: 'blend' = 0
+ * gives the cold start 1/size, 'blend' = 1 keeps the state as it is, small
+ * states included. Below 1 every neuron gets at least (1 - 'blend') / size,
+ * so none stays at zero or carries subnormals into the next run */
+static void SbsBaseLayer_blendIP(NeuronState * state_vector, uint16_t size, float blend)
+{
+  ASSERT(state_vector != NULL);
+  ASSERT(0 < size);
+
+  if ((state_vector != NULL) && (0 < size) && (blend < 1.0f))
+  {
+      float    uniform_h = (1.0f - blend) / size;
+      uint16_t neuron;
+      for (neuron = 0; neuron < size; neuron ++)
+        state_vector[neuron] = blend * state_vector[neuron] + uniform_h;
+  }
+}
+
+static void SbsBaseLayer_initialize(SbsBaseLayer * layer, float blend)
+{
+  ASSERT(layer != NULL);
+  ASSERT(layer->state_matrix != NULL);
+  ASSERT(layer->state_matrix->data != NULL);
+
+  if ((layer != NULL) && (layer->state_matrix != NULL) && (layer->state_matrix->data != NULL))
+  {
+    TensorView *  state   = &layer->state;
+    uint32_t      rows    = state->size[0];
+    uint32_t      columns = state->size[1];
+    uint16_t      neurons = state->size[2];
+    NeuronState * state_vector;
+
+    uint32_t row;
+    uint32_t column;
+    size_t   offset;
+
+    for (row = 0; row < rows; row++)
+    {
+      for (column = 0; column < columns; column++)
+      {
+        offset = TensorView_offset(state, row, column);
+
+        if (0.0f < blend)
+        {
+          state_vector = TensorView_getVector(state, offset, layer->vector_buffer);
+          SbsBaseLayer_blendIP(state_vector, neurons, blend);
+        }
+        else
+        {
+          state_vector = TensorView_vectorBuffer(state, offset, layer->vector_buffer);
+          SbsBaseLayer_initializeIP(state_vector, neurons);
+        }
+
+        TensorView_putVector(state, offset, state_vector);
+      }
+    }
+
+    if (layer->active_count != NULL)
+      SbsBaseLayer_resetSparseState(layer);
+  }
+}
+
+static void SbsBaseLayer_giveWeights(SbsLayer * layer, SbsWeightMatrix weight_matrix)
+{
+  ASSERT(layer != NULL);
+  ASSERT(weight_matrix != NULL);
+
+  if ((layer != NULL) && (weight_matrix != NULL))
+  {
+    /* The layer keeps a single reference, the caller's one is released */
+    if (((SbsBaseLayer *)layer)->weight_matrix == (Multivector *) weight_matrix)
+    {
+      Multivector * reference = weight_matrix;
+      SbsWeightMatrix_release(&reference);
+    }
+    else
+    {
+      if (((SbsBaseLayer *)layer)->weight_matrix != NULL)
+        SbsWeightMatrix_release(&((SbsBaseLayer *)layer)->weight_matrix);
+
+      ((SbsBaseLayer *)layer)->weight_matrix = (Multivector *) weight_matrix;
+      SbsBaseLayer_bindViews((SbsBaseLayer *)layer);
+    }
+  }
+}
+
+static size_t SbsBaseLayer_pruneWeights(SbsLayer * layer_ptr, float threshold)
+{
+  SbsBaseLayer * layer = (SbsBaseLayer *) layer_ptr;
+  size_t size = 0;
+
+  ASSERT(layer != NULL);
+  ASSERT(layer->weight_matrix != NULL);
+
+  if ((layer != NULL) && (layer->weight_matrix != NULL))
+  {
+    if (layer->sparse_weight_matrix != NULL)
+      SparseMatrix_delete(&layer->sparse_weight_matrix);
+
+    free(layer->scale_vector);
+    layer->scale_vector = NULL;
+
+    if (0.0f <= threshold)
+    {
+      size_t positions = layer->state_matrix->dimension_size[0]
+                       * layer->state_matrix->dimension_size[1];
+      size_t position;
+
+      layer->scale_vector = malloc(positions * sizeof(NeuronState));
+      ASSERT(layer->scale_vector != NULL);
+
+      if (layer->scale_vector != NULL)
+      {
+        for (position = 0; position < positions; position ++)
+          layer->scale_vector[position] = 1.0f;
+
+        layer->sparse_weight_matrix = SparseMatrix_new(layer->weight_matrix, threshold);
+      }
+
+      if (layer->sparse_weight_matrix != NULL)
+      {
+        layer->prune_threshold = threshold;
+        size = SparseMatrix_getMemorySize(layer->sparse_weight_matrix);
+      }
+      else
+      {
+        free(layer->scale_vector);
+        layer->scale_vector = NULL;
+      }
+    }
+  }
+
+  return size;
+}
+
+static void SbsBaseLayer_setUpdateOrder(SbsLayer * layer_ptr, UpdateOrder update_order)
+{
+  SbsBaseLayer * layer = (SbsBaseLayer *) layer_ptr;
+
+  ASSERT(layer != NULL);
+  ASSERT((update_order == RASTER_ORDER) || (update_order == WEIGHT_ROW_ORDER)
+         || (update_order == WINDOW_ORDER));
+
+  if (layer != NULL)
+  {
+    /* Buffers are sized on the first update, once the weights are known */
+    SbsBaseLayer_releaseUpdateOrder(layer);
+    layer->update_order = update_order;
+  }
+}
+
+static void SbsBaseLayer_setSparseState(SbsLayer * layer_ptr, float threshold, uint16_t top_k)
+{
+  SbsBaseLayer * layer = (SbsBaseLayer *) layer_ptr;
+
+  ASSERT(layer != NULL);
+
+  if (layer != NULL)
+  {
+    free(layer->active_count);
+    free(layer->active_index);
+    layer->active_count = NULL;
+    layer->active_index = NULL;
+
+    if (0.0f <= threshold)
+    {
+      size_t   positions = (size_t) layer->state_matrix->dimension_size[0] * layer->state_matrix->dimension_size[1];
+      uint16_t neurons   = layer->state_matrix->dimension_size[2];
+
+      layer->active_count = malloc(positions * sizeof(uint16_t));
+      layer->active_index = malloc(positions * neurons * sizeof(uint16_t));
+
+      ASSERT(layer->active_count != NULL);
+      ASSERT(layer->active_index != NULL);
+
+      if ((layer->active_count != NULL) && (layer->active_index != NULL))
+      {
+        layer->sparse_state_threshold = threshold;
+        layer->sparse_state_top_k     = (top_k < neurons) ? top_k : neurons;
+        /* Positions start dense; states already dropped to zero stay valid */
+        SbsBaseLayer_resetSparseState(layer);
+      }
+      else
+      {
+        free(layer->active_count);
+        free(layer->active_index);
+        layer->active_count = NULL;
+        layer->active_index = NULL;
+      }
+    }
+  }
+}
+
+static void SbsBaseLayer_setStateLayout(SbsLayer * layer_ptr, StateLayout layout)
+{
+  SbsBaseLayer * layer = (SbsBaseLayer *) layer_ptr;
+
+  ASSERT(layer != NULL);
+  ASSERT((layout == POSITION_MAJOR) || (layout == NEURON_MAJOR));
+
+  if ((layer != NULL) && ((layout == POSITION_MAJOR) || (layout == NEURON_MAJOR))
+      && (layer->state_layout != layout))
+  {
+    uint16_t neurons = layer->state_matrix->dimension_size[2];
+
+    if ((layer->vector_buffer == NULL) && (layout != POSITION_MAJOR))
+    {
+      layer->vector_buffer = malloc(neurons * sizeof(NeuronState));
+      ASSERT(layer->vector_buffer != NULL);
+
+      if (layer->vector_buffer == NULL)
+        return;
+    }
+
+    if (layer->state_matrix->data != NULL)
+    {
+      size_t        positions = (size_t) layer->state_matrix->dimension_size[0]
+                              * layer->state_matrix->dimension_size[1];
+      size_t        data_size = positions * neurons * sizeof(NeuronState);
+      NeuronState * copy      = malloc(data_size);
+      TensorView    previous  = layer->state;
+      size_t        position;
+
+      ASSERT(copy != NULL);
+
+      if (copy == NULL)
+        return;
+
+      /* Every position moves from the copy in the old layout */
+      memcpy(copy, layer->state_matrix->data, data_size);
+      previous.data = copy;
+      layer->state_layout = layout;
+      SbsBaseLayer_bindViews(layer);
+
+      for (position = 0; position < positions; position ++)
+        TensorView_putVector(&layer->state, TensorView_positionOffset(&layer->state, position),
+                             TensorView_getVector(&previous, TensorView_positionOffset(&previous, position),
+                                                  layer->vector_buffer));
+
+      free(copy);
+    }
+    else
+    {
+      layer->state_layout = layout;
+      SbsBaseLayer_bindViews(layer);
+    }
+  }
+}
+
+static void SbsBaseLayer_setEpsilon(SbsLayer * layer, float epsilon)
+{
+  ASSERT(layer != NULL);
+  /*ASSERT(epsilon != 0.0f);*/ /* 0.0 is allowed? */
+
+  if (layer != NULL)
+    ((SbsBaseLayer *)layer)->epsilon = epsilon;
+}
+
+/* Same shape, settings and weights (one more reference), states of its own */
+static SbsLayer * SbsBaseLayer_clone(SbsBaseLayer * layer)
+{
+  SbsBaseLayer * clone = NULL;
+
+  ASSERT(layer != NULL);
+
+  if (layer != NULL)
+  {
+    clone = (SbsBaseLayer *) SbsBaseLayer_new(layer->state_matrix->dimension_size[0],
+                                              layer->state_matrix->dimension_size[1],
+                                              layer->state_matrix->dimension_size[2],
+                                              layer->kernel_size,
+                                              layer->kernel_stride,
+                                              layer->weight_shift,
+                                              layer->neurons_previous_Layer);
+    if (clone != NULL)
+    {
+      clone->epsilon        = layer->epsilon;
+      clone->update_order   = layer->update_order;
+      clone->update_variant = layer->update_variant;
+      clone->spike_variant  = layer->spike_variant;
+
+      if (layer->weight_matrix != NULL)
+      {
+        clone->weight_matrix = SbsWeightMatrix_acquire(layer->weight_matrix);
+        SbsBaseLayer_bindViews(clone);
+      }
+
+      if (layer->state_layout != POSITION_MAJOR)
+        SbsBaseLayer_setStateLayout((SbsLayer *) clone, layer->state_layout);
+
+      if (layer->sparse_weight_matrix != NULL)
+        SbsBaseLayer_pruneWeights((SbsLayer *) clone, layer->prune_threshold);
+
+      if (layer->active_count != NULL)
+        SbsBaseLayer_setSparseState((SbsLayer *) clone, layer->sparse_state_threshold,
+                                    layer->sparse_state_top_k);
+    }
+  }
+
+  return (SbsLayer *) clone;
+}
+
+static uint32_t SbsBaseLayer_reverseBits(uint32_t x)
+{
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+  x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+/* Uniform of 'position' at 'cycle' for the variance-reduced SbsSampling modes */
+static NeuronState SbsBaseLayer_sample(SbsBaseLayer * layer, uint8_t sampling, size_t position, uint32_t cycle)
+{
+  MT19937 *  random = &layer->context->random;
+  uint32_t * offset = &layer->sample_offset[position];
+  double     u;
+
+  switch (sampling)
+  {
+    case SAMPLING_R1:
+      u = *offset / 4294967296.0 + cycle * SBS_SAMPLING_R1_ALPHA;
+      return (NeuronState) (u - floor(u));
+    case SAMPLING_SOBOL:
+      return ((NeuronState) (SbsBaseLayer_reverseBits(cycle) ^ *offset)) / ((NeuronState) 0xFFFFFFFF);
+    case SAMPLING_STRATIFIED:
+      u = ((NeuronState) MT19937_genrand(random)) / ((NeuronState) 0xFFFFFFFF);
+      return (NeuronState) (((cycle + *offset) % SBS_SAMPLING_STRATA + u) / SBS_SAMPLING_STRATA);
+    case SAMPLING_ANTITHETIC:
+      if (cycle % 2 == 0)
+        *offset = MT19937_genrand(random);
+      u = ((NeuronState) *offset) / ((NeuronState) 0xFFFFFFFF);
+      return (NeuronState) ((cycle % 2 == 0) ? u : 1.0 - u);
+    default:
+      return ((NeuronState) MT19937_genrand(random)) / ((NeuronState) 0xFFFFFFFF);
+  }
+}
+
+/* Offsets of the sampling sequences, drawn when a chain starts */
+static int SbsBaseLayer_resetSampling(SbsBaseLayer * layer)
+{
+  size_t positions = (size_t) layer->state_matrix->dimension_size[0] * layer->state_matrix->dimension_size[1];
+  size_t position;
+
+  if (layer->sample_offset == NULL)
+    layer->sample_offset = malloc(positions * sizeof(uint32_t));
+
+  ASSERT(layer->sample_offset != NULL);
+
+  if (layer->sample_offset == NULL)
+    return 0;
+
+  for (position = 0; position < positions; position ++)
+    layer->sample_offset[position] = MT19937_genrand(&layer->context->random);
+
+  return 1;
+}
+
+static Multivector * SbsBaseLayer_generateSpikes(SbsBaseLayer * layer, uint32_t cycle)
+{
+  Multivector * spike_matrix = NULL;
+  ASSERT(layer != NULL);
+  ASSERT(layer->state_matrix != NULL);
+  ASSERT(layer->spike_matrix != NULL);
+  ASSERT(layer->state_matrix->data != NULL);
+  ASSERT(layer->spike_matrix->data != NULL);
+
+  if (   (layer != NULL)
+      && (layer->state_matrix != NULL)
+      && (layer->spike_matrix != NULL)
+      && (layer->state_matrix->data != NULL)
+      && (layer->spike_matrix->data != NULL))
+  {
+      TensorView *  state             = &layer->state;
+      uint32_t      rows              = state->size[0];
+      uint32_t      columns           = state->size[1];
+      uint16_t      neurons           = state->size[2];
+      NeuronState * state_vector;
+      SpikeID *     spike_matrix_data = layer->spike_matrix->data;
+      MT19937 *     random            = &layer->context->random;
+      SbsSpikeKernel generate_spike   = SbsBaseLayer_spikeKernel[layer->spike_variant];
+      uint8_t       sampling          = layer->context->sampling;
+      NeuronState   random_s;
+
+      uint32_t row;
+      uint32_t column;
+      size_t   current_row_index;
+      size_t   current_row_column_index;
+
+      if ((sampling != SAMPLING_RANDOM) && ((cycle == 0) || (layer->sample_offset == NULL))
+          && !SbsBaseLayer_resetSampling(layer))
+        sampling = SAMPLING_RANDOM;
+
+      for (row = 0; row < rows; row++)
+      {
+        current_row_index = (size_t) columns * row;
+        for (column = 0; column < columns; column++)
+        {
+            current_row_column_index = current_row_index + column;
+            if (sampling == SAMPLING_RANDOM)
+              random_s = ((NeuronState)MT19937_genrand(random)) / ((NeuronState)0xFFFFFFFF);
+            else
+              random_s = SbsBaseLayer_sample(layer, sampling, current_row_column_index, cycle);
+
+            state_vector = TensorView_getVector(state, TensorView_offset(state, row, column),
+                                                layer->vector_buffer);
+
+            if ((layer->active_count != NULL) && (layer->active_count[current_row_column_index] < neurons))
+              spike_matrix_data[current_row_column_index] = SbsBaseLayer_generateSparseSpikeIP(
+                  state_vector,
+                  &layer->active_index[current_row_column_index * neurons],
+                  layer->active_count[current_row_column_index],
+                  random_s);
+            else
+              spike_matrix_data[current_row_column_index] = generate_spike(state_vector, neurons, random_s);
+        }
+      }
+
+      spike_matrix = layer->spike_matrix;
+  }
+
+  return spike_matrix;
+}
+
+static void SbsBaseLayer_updatePosition(SbsBaseLayer * layer, size_t position, uint32_t weight_row)
+{
+  SparseMatrix * sparse_matrix = layer->sparse_weight_matrix;
+  uint16_t       neurons       = layer->state.size[2];
+  size_t         offset        = TensorView_positionOffset(&layer->state, position);
+  NeuronState *  state_vector;
+  Weight *       weight_vector;
+  size_t         weight_bytes;
+  uint8_t        updated;
+
+  ASSERT(weight_row < layer->weights.size[0]);
+
+  if (layer->weights.size[0] <= weight_row)
+    return;
+
+  state_vector  = TensorView_getVector(&layer->state, offset, layer->vector_buffer);
+  weight_vector = TensorView_at(&layer->weights, weight_row, 0);
+
+  if ((layer->active_count != NULL) && (layer->active_count[position] < neurons))
+  {
+    updated = SbsBaseLayer_updateSparseStateIP(layer, state_vector,
+        &layer->active_index[position * neurons], layer->active_count[position],
+        weight_vector, layer->epsilon);
+    weight_bytes = layer->active_count[position] * sizeof(Weight);
+  }
+  else if (sparse_matrix != NULL)
+  {
+    uint32_t length = sparse_matrix->row_index[weight_row + 1] - sparse_matrix->row_index[weight_row];
+    updated = SbsBaseLayer_updateSparseIP(state_vector, &layer->scale_vector[position],
+        &sparse_matrix->column_index[sparse_matrix->row_index[weight_row]],
+        &sparse_matrix->value[sparse_matrix->row_index[weight_row]],
+        length,
+        layer->epsilon);
+    weight_bytes = length * (sizeof(Weight) + sizeof(uint16_t));
+  }
+  else
+  {
+    updated = SbsBaseLayer_updateKernel[layer->update_variant](layer, state_vector,
+        weight_vector, neurons, layer->epsilon);
+    weight_bytes = neurons * sizeof(Weight);
+  }
+
+  TensorView_putVector(&layer->state, offset, state_vector);
+
+  if (layer->telemetry != NULL)
+  {
+    SbsLayerTelemetry * counters = &layer->telemetry->counters;
+
+    if (counters->fields & TELEMETRY_UPDATES)
+    {
+      counters->updates ++;
+      counters->skipped_updates += !updated;
+    }
+
+    if (counters->fields & TELEMETRY_WEIGHT_BYTES)
+      counters->weight_bytes += weight_bytes;
+  }
+}
+
+/* Applies the 'size' kernel updates of a position in size + 1 passes instead
+ * of 2 * size: every pass finishes the renormalization of the previous update
+ * and accumulates the sum of the next one. The state works in update_buffer
+ * and the state matrix is read and written once. Same arithmetic in the same
+ * order as SbsBaseLayer_updateIP, updates below the sum limit are skipped
+ * alike. Positions on the sparse paths fall back to one update at a time. */
+static void SbsBaseLayer_updateWindow(SbsBaseLayer * layer, size_t position,
+                                      uint32_t * weight_row, uint32_t size)
+{
+  uint16_t      neurons         = layer->state.size[2];
+  size_t        offset          = TensorView_positionOffset(&layer->state, position);
+  NeuronState * state_vector;
+  NeuronState * temp_data       = layer->update_buffer;
+  NeuronState   reverse_epsilon = 1.0f / (1.0f + layer->epsilon);
+  NeuronState   epsion_over_sum = 0.0f;
+  NeuronState   sum;
+  NeuronState   h;
+  Weight *      weight_vector;
+  Weight *      previous_vector = NULL; /* Update pending renormalization */
+  uint16_t      neuron;
+  uint32_t      update;
+  uint32_t      skipped         = 0;
+
+  if ((layer->sparse_weight_matrix != NULL)
+      || ((layer->active_count != NULL) && (layer->active_count[position] < neurons))
+      || (temp_data == NULL) || (neurons == 0))
+  {
+    for (update = 0; update < size; update ++)
+      SbsBaseLayer_updatePosition(layer, position, weight_row[update]);
+    return;
+  }
+
+  state_vector = TensorView_getVector(&layer->state, offset, layer->vector_buffer);
+
+  for (neuron = 0; neuron < neurons; neuron ++)
+    temp_data[neuron] = state_vector[neuron];
+
+  for (update = 0; update < size; update ++)
+  {
+    weight_vector = TensorView_at(&layer->weights, weight_row[update], 0);
+    sum = 0.0f;
+
+    if (previous_vector != NULL)
+    {
+      for (neuron = 0; neuron < neurons; neuron ++)
+      {
+        h = temp_data[neuron];
+        h = reverse_epsilon * (h + (h * previous_vector[neuron]) * epsion_over_sum);
+        temp_data[neuron] = h;
+        sum += h * weight_vector[neuron];
+      }
+    }
+    else
+    {
+      for (neuron = 0; neuron < neurons; neuron ++)
+        sum += temp_data[neuron] * weight_vector[neuron];
+    }
+
+    if (sum < SBS_UPDATE_MIN_SUM)
+    {
+      previous_vector = NULL;
+      skipped ++;
+    }
+    else
+    {
+      previous_vector = weight_vector;
+      epsion_over_sum = layer->epsilon / sum;
+    }
+  }
+
+  if (previous_vector != NULL)
+  {
+    for (neuron = 0; neuron < neurons; neuron ++)
+    {
+      h = temp_data[neuron];
+      state_vector[neuron] = reverse_epsilon * (h + (h * previous_vector[neuron]) * epsion_over_sum);
+    }
+  }
+  else
+  {
+    for (neuron = 0; neuron < neurons; neuron ++)
+      state_vector[neuron] = temp_data[neuron];
+  }
+
+  TensorView_putVector(&layer->state, offset, state_vector);
+
+  if (layer->telemetry != NULL)
+  {
+    SbsLayerTelemetry * counters = &layer->telemetry->counters;
+
+    if (counters->fields & TELEMETRY_UPDATES)
+    {
+      counters->updates += size;
+      counters->skipped_updates += skipped;
+    }
+
+    if (counters->fields & TELEMETRY_WEIGHT_BYTES)
+      counters->weight_bytes += size * neurons * sizeof(Weight);
+  }
+}
+
+/* Applies the updates recorded in order_row grouped by weight row: every
+ * position that needs a given weight row gets it back to back, so the row
+ * stays in cache. Each position still receives all its kernel updates, only
+ * their order inside the window changes. The entries cover a tile of
+ * 'tile_columns' positions wide from 'first_position'. */
+static void SbsBaseLayer_updateByWeightRow(SbsBaseLayer * layer, size_t entries,
+                                           size_t first_position, uint32_t tile_columns)
+{
+  uint32_t   layer_columns  = layer->state.size[1];
+  uint32_t   weight_rows    = layer->weights.size[0];
+  uint32_t   window         = layer->kernel_size * layer->kernel_size;
+  uint32_t * order_row      = layer->order_row;
+  uint32_t * order_position = layer->order_position;
+  uint32_t * order_offset   = layer->order_offset;
+  uint32_t   weight_row;
+  uint32_t   begin;
+  size_t     entry;
+
+  /* Counting sort of the entries by weight row */
+  memset(order_offset, 0x00, (weight_rows + 1) * sizeof(uint32_t));
+
+  for (entry = 0; entry < entries; entry ++)
+    order_offset[order_row[entry] + 1] ++;
+
+  for (weight_row = 0; weight_row < weight_rows; weight_row ++)
+    order_offset[weight_row + 1] += order_offset[weight_row];
+
+  for (entry = 0; entry < entries; entry ++)
+    order_position[order_offset[order_row[entry]] ++] = entry / window;
+
+  /* order_offset[r] now holds the end of bucket r */
+  for (begin = 0, weight_row = 0; weight_row < weight_rows; weight_row ++)
+  {
+    for (; begin < order_offset[weight_row]; begin ++)
+      SbsBaseLayer_updatePosition(layer, first_position
+                                  + (size_t) (order_position[begin] / tile_columns) * layer_columns
+                                  + order_position[begin] % tile_columns,
+                                  weight_row);
+  }
+}
+
+/* Updates the 'rows' x 'columns' positions from ('first_row', 'first_column')
+ * of the layer; 'input' is the tile of input spikes they read */
+static void SbsBaseLayer_updateTile(SbsBaseLayer * layer, const TensorView * input,
+                                    uint32_t first_row, uint32_t first_column,
+                                    uint32_t rows, uint32_t columns)
+{
+  SpikeID   spikeID;
+  uint32_t  weight_row;
+
+  uint32_t  layer_columns  = layer->state.size[1];
+  uint32_t  weight_rows    = layer->weights.size[0];
+  size_t    first_position = (size_t) first_row * layer_columns + first_column;
+  size_t    position;
+
+  uint16_t kernel_stride  = layer->kernel_stride;
+  uint16_t kernel_size    = layer->kernel_size;
+  uint16_t row_shift      = kernel_size;
+  uint16_t column_shift   = 1;
+  uint32_t section_shift  = 0;
+
+  uint32_t tile_row;          /* Row index for navigation on the tile */
+  uint32_t tile_column;       /* Column index for navigation on the tile */
+  uint16_t kernel_row;        /* Row index for navigation inside kernel */
+  uint16_t kernel_column;     /* Column index for navigation inside kernel */
+
+  SpikeID * spike_row;
+
+  uint16_t neurons_previous_Layer = layer->neurons_previous_Layer;
+
+  uint32_t * order_row = NULL;
+  size_t     entries   = 0;
+
+  if (layer->weight_shift == ROW_SHIFT)
+  {
+    row_shift = 1;
+    column_shift = kernel_size;
+  }
+
+  if ((layer->update_order == WEIGHT_ROW_ORDER) || (layer->update_order == WINDOW_ORDER))
+  {
+    if ((layer->order_row == NULL) && !SbsBaseLayer_allocateUpdateOrder(layer))
+      SbsBaseLayer_releaseUpdateOrder(layer);
+    order_row = layer->order_row;
+  }
+
+  for (tile_row = 0; tile_row < rows; tile_row ++)
+  {
+    for (tile_column = 0; tile_column < columns; tile_column ++)
+    {
+      position = first_position + (size_t) tile_row * layer_columns + tile_column;
+      if (layer->update_order == WINDOW_ORDER)
+        entries = 0;
+
+      for (kernel_row = 0; kernel_row < kernel_size; kernel_row ++)
+      {
+        spike_row = TensorView_at(input, tile_row * kernel_stride + kernel_row,
+                                  tile_column * kernel_stride);
+        for (kernel_column = 0; kernel_column < kernel_size; kernel_column ++)
+        {
+          spikeID = spike_row[kernel_column];
+
+          section_shift = (uint32_t) (kernel_row * row_shift + kernel_column * column_shift) * neurons_previous_Layer;
+
+          weight_row = spikeID + section_shift;
+
+          ASSERT(weight_row < weight_rows);
+
+          /* Spike IDs beyond the weight matrix are skipped, as on the accelerator */
+          if (weight_rows <= weight_row)
+            continue;
+
+          if (order_row != NULL)
+            order_row[entries ++] = weight_row;
+          else
+            SbsBaseLayer_updatePosition(layer, position, weight_row);
+        }
+      }
+
+      if ((order_row != NULL) && (layer->update_order == WINDOW_ORDER))
+        SbsBaseLayer_updateWindow(layer, position, order_row, entries);
+    }
+  }
+
+  if ((order_row != NULL) && (layer->update_order == WEIGHT_ROW_ORDER))
+    SbsBaseLayer_updateByWeightRow(layer, entries, first_position, columns);
+}
+
+/* The layer is updated in square tiles of context->update_tile positions a
+ * side, each reading its own tile of the input spikes; every position keeps
+ * its update order, so the result does not depend on the tiling */
+static void SbsBaseLayer_update(SbsBaseLayer * layer, const TensorView * input_spikes)
+{
+  ASSERT(layer != NULL);
+  ASSERT(layer->state_matrix != NULL);
+  ASSERT(layer->state_matrix->data != NULL);
+  ASSERT(layer->weight_matrix != NULL);
+  ASSERT(layer->weight_matrix->data != NULL);
+
+  ASSERT(0 < layer->kernel_size);
+
+  ASSERT(input_spikes != NULL);
+  ASSERT(input_spikes->data != NULL);
+
+  if (   (layer != NULL)
+      && (layer->state_matrix != NULL)
+      && (layer->state_matrix->data != NULL)
+      && (layer->weight_matrix != NULL)
+      && (layer->weight_matrix->data != NULL)
+      && (input_spikes != NULL)
+      && (input_spikes->data != NULL))
+  {
+      uint32_t  spike_rows     = input_spikes->size[0];
+      uint32_t  spike_columns  = input_spikes->size[1];
+
+      uint32_t  weight_columns = layer->weights.size[1];
+
+      uint32_t  layer_columns  = layer->state.size[1];
+      uint16_t  neurons        = layer->state.size[2];
+
+      uint16_t  kernel_stride  = layer->kernel_stride;
+      uint16_t  kernel_size    = layer->kernel_size;
+
+      uint32_t  rows;
+      uint32_t  columns;
+      uint32_t  tile;
+      uint32_t  tile_rows;
+      uint32_t  tile_columns;
+      uint32_t  row;
+      uint32_t  column;
+      TensorView input;
+
+      ASSERT(weight_columns == neurons);
+      ASSERT(0 < kernel_stride);
+      ASSERT((kernel_size <= spike_rows) && (kernel_size <= spike_columns));
+
+      if ((weight_columns != neurons) || (kernel_stride == 0)
+          || (spike_rows < kernel_size) || (spike_columns < kernel_size))
+        return;
+
+      /* Positions the kernel visits */
+      rows    = (spike_rows - kernel_size) / kernel_stride + 1;
+      columns = (spike_columns - kernel_size) / kernel_stride + 1;
+
+      ASSERT((rows <= layer->state.size[0]) && (columns <= layer_columns));
+
+      /* Input too large for the layer, its positions would run past the state */
+      if ((layer->state.size[0] < rows) || (layer_columns < columns))
+        return;
+
+      tile = layer->context->update_tile;
+
+      /* Update begins */
+      for (row = 0; row < rows; row += tile_rows)
+      {
+        tile_rows = ((0 < tile) && (tile < rows - row)) ? tile : rows - row;
+
+        for (column = 0; column < columns; column += tile_columns)
+        {
+          tile_columns = ((0 < tile) && (tile < columns - column)) ? tile : columns - column;
+
+          input = TensorView_tile(input_spikes, row * kernel_stride, column * kernel_stride,
+                                  (tile_rows - 1) * kernel_stride + kernel_size,
+                                  (tile_columns - 1) * kernel_stride + kernel_size);
+
+          SbsBaseLayer_updateTile(layer, &input, row, column, tile_rows, tile_columns);
+        }
+      }
+
+      if (layer->sparse_weight_matrix != NULL)
+        SbsBaseLayer_applyScale(layer);
+
+      if ((layer->active_count != NULL)
+          && (layer->context->sparse_state_interval <= ++ layer->sparse_state_counter))
+      {
+        size_t positions = (size_t) layer->state.size[0] * layer_columns;
+        size_t position;
+
+        for (position = 0; position < positions; position ++)
+          SbsBaseLayer_sparsifyIP(layer, position);
+
+        layer->sparse_state_counter = 0;
+      }
+      /* Update ends*/
+  }
+}
+
+/************************ Memory planner *************************************/
+/* A cycle runs the layers in network order: layer i generates its spikes
+ * from its state, then updates its state from the spikes of layer i - 1.
+ * With every layer placed as state then spikes, spikes(i - 1), state(i) and
+ * spikes(i) lie next to each other, in the order the cycle reads them. */
+
+static void SbsMemory_planLayer(SbsBaseLayer * layer, SbsLayerMemory * memory)
+{
+  memory->state_bytes  = Multivector_dataSize(layer->state_matrix);
+  memory->spike_bytes  = Multivector_dataSize(layer->spike_matrix);
+  memory->weight_bytes = (layer->weight_matrix != NULL) ? Multivector_dataSize(layer->weight_matrix) : 0;
+  memory->arena_bytes  = Memory_align(memory->state_bytes) + Memory_align(memory->spike_bytes);
+  memory->heap_bytes   = 0;
+}
+
+/* Arena bytes of 'layers' given in this order to a network of their own */
+static size_t SbsMemory_plan(SbsLayer ** layers, uint16_t count, SbsLayerMemory * report)
+{
+  SbsLayerMemory memory;
+  size_t         size = 0;
+  uint16_t       i;
+
+  ASSERT((layers != NULL) || (count == 0));
+
+  if ((layers == NULL) && (0 < count))
+    return 0;
+
+  for (i = 0; i < count; i ++)
+  {
+    ASSERT(layers[i] != NULL);
+
+    if (layers[i] == NULL)
+      continue;
+
+    SbsMemory_planLayer((SbsBaseLayer *) layers[i], &memory);
+    size += memory.arena_bytes;
+
+    if (report != NULL)
+      report[i] = memory;
+  }
+
+  return size;
+}
+
+/************************ Autotune *******************************************/
+
+static void SbsAutotune_cpuModel(char * model, size_t size)
+{
+#ifdef USE_XILINX
+  snprintf(model, size, "Zynq");
+#else
+  FILE * file = fopen("/proc/cpuinfo", "r");
+  char   line[256];
+
+  snprintf(model, size, "unknown");
+
+  if (file != NULL)
+  {
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+      char * value = strchr(line, ':');
+
+      if ((value != NULL)
+          && ((strncmp(line, "model name", 10) == 0) || (strncmp(line, "Hardware", 8) == 0)
+              || (strncmp(line, "CPU part", 8) == 0)))
+      {
+        value += strspn(value, ": \t");
+        value[strcspn(value, ";\r\n")] = '\0';
+        snprintf(model, size, "%s", value);
+        break;
+      }
+    }
+
+    fclose(file);
+  }
+#endif
+}
+
+/* Cache lines: "<cpu model>;<rows>x<columns>x<neurons>/<kernel>/<previous>;<update>;<spike>",
+ * later lines win. The board has a single CPU model, there the cache is not kept */
+static int SbsAutotune_lookup(const char * cache_file, const char * key,
+                              uint8_t * update_variant, uint8_t * spike_variant)
+{
+  int found = 0;
+#ifndef USE_XILINX
+  FILE * file = fopen(cache_file, "r");
+  size_t length = strlen(key);
+  char   line[256];
+
+  if (file != NULL)
+  {
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+      unsigned update;
+      unsigned spike;
+
+      if ((strncmp(line, key, length) == 0) && (line[length] == ';')
+          && (sscanf(&line[length + 1], "%u;%u", &update, &spike) == 2)
+          && (update < UPDATE_VARIANTS) && (spike < SPIKE_VARIANTS))
+      {
+        *update_variant = update;
+        *spike_variant  = spike;
+        found = 1;
+      }
+    }
+
+    fclose(file);
+  }
+#endif
+  return found;
+}
+
+static void SbsAutotune_store(const char * cache_file, const char * key,
+                              uint8_t update_variant, uint8_t spike_variant)
+{
+#ifndef USE_XILINX
+  FILE * file = fopen(cache_file, "a");
+
+  if (file != NULL)
+  {
+    fprintf(file, "%s;%u;%u\n", key, update_variant, spike_variant);
+    fclose(file);
+  }
+#endif
+}
+
+/* Kernel calls on the real weight rows, 'state_vector' is scratch */
+static double SbsAutotune_timeUpdate(SbsBaseLayer * layer, SbsUpdateKernel kernel, NeuronState * state_vector)
+{
+  uint16_t neurons     = layer->state_matrix->dimension_size[2];
+  uint32_t weight_rows = layer->weight_matrix->dimension_size[0];
+  Weight * weight_data = layer->weight_matrix->data;
+  double   start;
+  uint32_t i;
+
+  SbsBaseLayer_initializeIP(state_vector, neurons);
+
+  start = SbsTelemetry_now();
+
+  for (i = 0; i < SBS_AUTOTUNE_CALLS; i ++)
+    kernel(layer, state_vector, &weight_data[(size_t) (i % weight_rows) * neurons], neurons, layer->epsilon);
+
+  return SbsTelemetry_now() - start;
+}
+
+static double SbsAutotune_timeSpike(SbsSpikeKernel kernel, NeuronState * state_vector,
+                                    uint16_t neurons, NeuronState * random_s)
+{
+  volatile SpikeID spikeID;
+  double           start;
+  uint32_t         i;
+
+  SbsBaseLayer_initializeIP(state_vector, neurons);
+
+  start = SbsTelemetry_now();
+
+  for (i = 0; i < SBS_AUTOTUNE_CALLS; i ++)
+    spikeID = kernel(state_vector, neurons, random_s[i]);
+
+  (void) spikeID;
+
+  return SbsTelemetry_now() - start;
+}
+
+/* Picks the dispatch slots of a layer: from the cache, otherwise the best
+ * time of SBS_AUTOTUNE_ROUNDS interleaved rounds per variant. Layers without
+ * weights (input) keep the default update kernel */
+static void SbsBaseNetwork_tuneLayer(SbsBaseNetwork * network, uint16_t index)
+{
+  SbsBaseLayer * layer   = network->layer_array[index];
+  uint16_t       neurons = layer->state_matrix->dimension_size[2];
+  int            tune_update = (layer->weight_matrix != NULL);
+  int            cached = 0;
+  char           key[160];
+  char           model[96];
+
+  SbsAutotune_cpuModel(model, sizeof(model));
+  snprintf(key, sizeof(key), "%s;%ux%ux%u/%u/%u", model,
+           layer->state_matrix->dimension_size[0], layer->state_matrix->dimension_size[1],
+           neurons, layer->kernel_size, layer->neurons_previous_Layer);
+
+  if (network->autotune_cache != NULL)
+    cached = SbsAutotune_lookup(network->autotune_cache, key,
+                                &layer->update_variant, &layer->spike_variant);
+
+  if (!cached)
+  {
+    NeuronState * state_vector = malloc(neurons * sizeof(NeuronState));
+    NeuronState * random_s     = malloc(SBS_AUTOTUNE_CALLS * sizeof(NeuronState));
+    double        update_time[UPDATE_VARIANTS];
+    double        spike_time[SPIKE_VARIANTS];
+    double        time;
+    MT19937       random;
+    uint8_t       round;
+    uint8_t       variant;
+    uint32_t      i;
+
+    ASSERT(state_vector != NULL);
+    ASSERT(random_s != NULL);
+
+    if ((state_vector == NULL) || (random_s == NULL))
+    {
+      free(state_vector);
+      free(random_s);
+      return;
+    }
+
+    /* A generator of its own, the context sequence stays untouched */
+    MT19937_sgenrand(&random, SBS_DEFAULT_SEED);
+    for (i = 0; i < SBS_AUTOTUNE_CALLS; i ++)
+      random_s[i] = ((NeuronState) MT19937_genrand(&random)) / ((NeuronState) 0xFFFFFFFF);
+
+    for (variant = 0; variant < UPDATE_VARIANTS; variant ++)
+      update_time[variant] = DBL_MAX;
+    for (variant = 0; variant < SPIKE_VARIANTS; variant ++)
+      spike_time[variant] = DBL_MAX;
+
+    for (round = 0; round < SBS_AUTOTUNE_ROUNDS; round ++)
+    {
+      for (variant = 0; tune_update && (variant < UPDATE_VARIANTS); variant ++)
+      {
+        time = SbsAutotune_timeUpdate(layer, SbsBaseLayer_updateKernel[variant], state_vector);
+        if (time < update_time[variant])
+          update_time[variant] = time;
+      }
+
+      for (variant = 0; variant < SPIKE_VARIANTS; variant ++)
+      {
+        time = SbsAutotune_timeSpike(SbsBaseLayer_spikeKernel[variant], state_vector, neurons, random_s);
+        if (time < spike_time[variant])
+          spike_time[variant] = time;
+      }
+    }
+
+    layer->update_variant = UPDATE_BUFFERED;
+    for (variant = 1; tune_update && (variant < UPDATE_VARIANTS); variant ++)
+      if (update_time[variant] < update_time[layer->update_variant])
+        layer->update_variant = variant;
+
+    layer->spike_variant = SPIKE_LINEAR;
+    for (variant = 1; variant < SPIKE_VARIANTS; variant ++)
+      if (spike_time[variant] < spike_time[layer->spike_variant])
+        layer->spike_variant = variant;
+
+    free(state_vector);
+    free(random_s);
+
+    if (network->autotune_cache != NULL)
+      SbsAutotune_store(network->autotune_cache, key, layer->update_variant, layer->spike_variant);
+  }
+
+  if (network->context->progress_interval)
+    printf(" - Autotune layer %d: %s update, %s spikes%s\n", index,
+           SbsBaseLayer_updateVariantName[layer->update_variant],
+           SbsBaseLayer_spikeVariantName[layer->spike_variant],
+           cached ? " (cached)" : "");
+}
+
+/*****************************************************************************/
+
+static SbsNetwork * SbsBaseNetwork_new(SbsContext * context)
+{
+  SbsBaseNetwork * network = NULL;
+
+  network = malloc(sizeof(SbsBaseNetwork));
+
+  ASSERT(network != NULL);
+
+  if (network != NULL)
+  {
+      memset(network, 0x0, sizeof(SbsBaseNetwork));
+      network->vtbl = _SbsNetwork;
+      network->input_label = (uint8_t)-1;
+      network->inferred_output = (uint8_t)-1;
+
+      if (context == NULL)
+      {
+        network->context = &SbsBaseContext_default;
+        SbsBaseContext_seed((SbsContext *) network->context, SBS_DEFAULT_SEED);
+      }
+      else
+        network->context = (SbsBaseContext *) context;
+  }
+
+  ASSERT(network->size == 0);
+  ASSERT(network->layer_array == NULL);
+
+  return (SbsNetwork *) network;
+}
+
+static void SbsBaseNetwork_deleteEnsemble(SbsBaseNetwork * network);
+static void SbsBaseNetwork_wait(SbsNetwork * network_ptr);
+
+static void SbsBaseNetwork_delete(SbsNetwork ** network_ptr)
+{
+  ASSERT(network_ptr != NULL);
+  ASSERT(*network_ptr != NULL);
+
+  if ((network_ptr != NULL) && (*network_ptr != NULL))
+  {
+    SbsBaseNetwork ** network = (SbsBaseNetwork **) network_ptr;
+
+    SbsBaseNetwork_wait(*network_ptr);
+
+    while (0 < (*network)->size)
+      SbsBaseLayer_delete((SbsLayer **)&(*network)->layer_array[--((*network)->size)]);
+
+    SbsBaseNetwork_deleteEnsemble(*network);
+    free((*network)->layer_array);
+    free((*network)->ticket);
+    free((*network)->autotune_cache);
+    free(*network);
+    *network = NULL;
+  }
+}
+
+static void SbsBaseNetwork_giveLayer(SbsNetwork * network_ptr, SbsLayer * layer)
+{
+  ASSERT(network_ptr != NULL);
+  ASSERT(layer != NULL);
+
+  if ((network_ptr != NULL) && (layer != NULL))
+  {
+    SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+    SbsBaseLayer ** layer_array = network->layer_array;
+    uint16_t size = network->size;
+    uint32_t * ticket;
+    MemoryBlock * memory = &network->context->memory;
+    uint8_t * begin;
+
+    ASSERT(size < 0xFFFF);
+
+    if (0xFFFF <= size)
+      return;
+
+    /* The arrays grow first, a failure leaves the arena and the layer untouched */
+    layer_array = realloc(layer_array, (size + 1) * sizeof(SbsBaseLayer *));
+    if (layer_array != NULL)
+      network->layer_array = layer_array;
+
+    ticket = realloc(network->ticket, (size + 1) * sizeof(uint32_t));
+    if (ticket != NULL)
+      network->ticket = ticket;
+
+    ASSERT(layer_array != NULL);
+    ASSERT(ticket != NULL);
+
+    if ((layer_array == NULL) || (ticket == NULL))
+      return;
+
+    /* Layer buffers are placed in the arena of the network context, state
+     * then spikes: the order SbsMemory_plan() sizes */
+    ((SbsBaseLayer *)layer)->context = network->context;
+    Multivector_allocate(((SbsBaseLayer *)layer)->state_matrix, memory);
+    Multivector_allocate(((SbsBaseLayer *)layer)->spike_matrix, memory);
+    SbsBaseLayer_bindViews((SbsBaseLayer *)layer);
+
+    begin = ((SbsBaseLayer *)layer)->state_matrix->heap_data ? &memory->block[memory->index]
+                                                             : ((SbsBaseLayer *)layer)->state_matrix->data;
+
+    /* Track the span for single-copy checkpoints */
+    if (network->memory_begin == NULL)
+    {
+      network->memory_begin = begin;
+      network->memory_contiguous = 1;
+    }
+    else if (begin != network->memory_begin + Memory_align(network->memory_size))
+      network->memory_contiguous = 0;
+
+    network->memory_size = &memory->block[memory->index] - network->memory_begin;
+
+    /* Buffers past the arena break the span */
+    if (((SbsBaseLayer *)layer)->state_matrix->heap_data || ((SbsBaseLayer *)layer)->spike_matrix->heap_data)
+      network->memory_contiguous = 0;
+
+    layer_array[size] = (SbsBaseLayer *)layer;
+    ticket[size] = 0;
+
+    network->size ++;
+
+    if (network->autotune)
+      SbsBaseNetwork_tuneLayer(network, size);
+  }
+}
+
+static int SbsBaseNetwork_loadInput(SbsNetwork * network_ptr, char * file_name)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  uint8_t good_reading_flag = 0;
+  ASSERT(network != NULL);
+  ASSERT(1 <= network->size);
+  ASSERT(network->layer_array != NULL);
+  ASSERT(*network->layer_array != NULL);
+
+  ASSERT(file_name != NULL);
+
+  if ((network != NULL)
+      && (1 <= network->size)
+      && (network->layer_array != NULL) && (*network->layer_array != NULL)
+      && (file_name != NULL))
+  {
+    BufferedFile * file = BufferedFile_new (file_name, BUFFERED_FILE_DEFAULT, 0);
+
+    if (file != NULL)
+    {
+      SbsBaseLayer * input_layer = network->layer_array[0];
+      TensorView * state = &input_layer->state;
+      uint32_t rows = state->size[0];
+      uint32_t columns = state->size[1];
+      uint16_t neurons = state->size[2];
+      NeuronState * vector;
+
+      uint32_t row;
+      uint32_t column;
+      size_t offset;
+      size_t read_result = 0;
+
+      size_t inference_population_size = sizeof(NeuronState) * neurons;
+
+      good_reading_flag = 1;
+
+      /* The small per-position reads are served from the block buffer */
+      for (column = 0; (column < columns) && good_reading_flag; column++)
+        for (row = 0; (row < rows) && good_reading_flag; row++)
+        {
+          offset = TensorView_offset(state, row, column);
+          vector = TensorView_vectorBuffer(state, offset, input_layer->vector_buffer);
+
+          read_result = BufferedFile_read (file, vector, inference_population_size);
+
+          good_reading_flag = read_result == inference_population_size;
+
+          if (good_reading_flag)
+            TensorView_putVector(state, offset, vector);
+        }
+
+      if (good_reading_flag)
+      {
+        read_result = BufferedFile_read (file, &network->input_label, sizeof(uint8_t));
+        network->input_label --;
+        good_reading_flag = read_result == sizeof(uint8_t);
+      }
+
+      BufferedFile_delete (&file);
+    }
+  }
+
+  return good_reading_flag;
+}
+
+/* Same layout as the input files: one neuron vector per position, column
+ * by column, optionally followed by the 1-based label byte */
+static void SbsBaseNetwork_loadInputBuffer(SbsNetwork * network_ptr, void * buffer, size_t size)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  ASSERT(network != NULL);
+  ASSERT(1 <= network->size);
+  ASSERT(network->layer_array != NULL);
+  ASSERT(*network->layer_array != NULL);
+
+  ASSERT(buffer != NULL);
+
+  if ((network != NULL)
+      && (1 <= network->size)
+      && (network->layer_array != NULL) && (*network->layer_array != NULL)
+      && (buffer != NULL))
+  {
+    SbsBaseLayer * input_layer = network->layer_array[0];
+    TensorView * state = &input_layer->state;
+    uint32_t rows = state->size[0];
+    uint32_t columns = state->size[1];
+    uint16_t neurons = state->size[2];
+    NeuronState * vector;
+    uint8_t * source = buffer;
+
+    uint32_t row;
+    uint32_t column;
+    size_t offset;
+
+    size_t inference_population_size = sizeof(NeuronState) * neurons;
+    size_t data_size = inference_population_size * rows * columns;
+
+    ASSERT(data_size <= size);
+
+    if (data_size <= size)
+    {
+      for (column = 0; column < columns; column++)
+        for (row = 0; row < rows; row++)
+        {
+          offset = TensorView_offset(state, row, column);
+          vector = TensorView_vectorBuffer(state, offset, input_layer->vector_buffer);
+          memcpy (vector, source, inference_population_size);
+          TensorView_putVector(state, offset, vector);
+          source += inference_population_size;
+        }
+
+      network->input_label = (data_size < size) ? *source - 1 : (uint8_t)-1;
+    }
+  }
+}
+
+static void SbsBaseNetwork_reset(SbsNetwork * network_ptr)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  uint16_t i;
+  ASSERT(network != NULL);
+  ASSERT(network->layer_array != NULL);
+
+  if ((network != NULL) && (network->layer_array != NULL))
+  {
+    /* Warm start only when the layers hold the states of a previous run */
+    float blend = network->ready ? network->warm_start_blend : 0.0f;
+
+    /* Initialize all layers except the input-layer */
+    for (i = 1; i < network->size; i++)
+    {
+      ASSERT(network->layer_array[i] != NULL);
+      SbsBaseLayer_initialize(network->layer_array[i], blend);
+    }
+
+    network->cycle = 0;
+    network->ready = 1;
+
+    if (network->ensemble != NULL)
+    {
+      uint8_t k;
+
+      /* Chain k restarts from seed + k * stride whenever the context was reseeded */
+      if (network->ensemble_seed_count != network->context->seed_count)
+      {
+        for (k = 1; k < network->ensemble_size; k ++)
+          SbsBaseContext_seed((SbsContext *) ((SbsBaseNetwork *) network->ensemble[k - 1])->context,
+                              network->context->seed + k * SBS_ENSEMBLE_SEED_STRIDE);
+        network->ensemble_seed_count = network->context->seed_count;
+      }
+
+      for (k = 1; k < network->ensemble_size; k ++)
+        SbsBaseNetwork_reset(network->ensemble[k - 1]);
+    }
+  }
+}
+
+static void SbsBaseNetwork_readout(SbsBaseNetwork * network)
+{
+  NeuronState max_value = 0;
+  SbsBaseLayer * output_layer = network->layer_array[network->size - 1];
+  Multivector * output_state_matrix = output_layer->state_matrix;
+  NeuronState * output_state_vector = output_state_matrix->data;
+  uint16_t i;
+
+  ASSERT(output_state_matrix->dimensionality == 3);
+  ASSERT(output_state_matrix->dimension_size[0] == 1);
+  ASSERT(output_state_matrix->dimension_size[1] == 1);
+  ASSERT(0 < output_state_matrix->dimension_size[2]);
+
+  for (i = 0; i < output_state_matrix->dimension_size[2]; i++)
+  {
+    NeuronState h = output_state_vector[i]; /* Ensure data alignment */
+    if (max_value < h)
+    {
+      network->inferred_output = i;
+      max_value = h;
+    }
+  }
+}
+
+/* Submits the update of layer 'i' to the accelerator, returns its ticket or
+ * 0 when the layer has to be updated here */
+static uint32_t SbsBaseNetwork_submitUpdate(SbsBaseNetwork * network, uint16_t i)
+{
+  SbsBaseLayer *      layer = network->layer_array[i];
+  Multivector *       spike_matrix = network->layer_array[i - 1]->spike_matrix;
+  SbsUpdateDescriptor descriptor;
+
+  if ((network->accelerator == NULL)
+      || (layer->sparse_weight_matrix != NULL)
+      || (layer->active_count != NULL)
+      || (layer->update_order == WEIGHT_ROW_ORDER)
+      || (layer->state_layout != POSITION_MAJOR)
+      || ((layer->telemetry != NULL)
+          && (layer->telemetry->counters.fields & (TELEMETRY_UPDATES | TELEMETRY_WEIGHT_BYTES)))
+      || (layer->weight_matrix == NULL)
+      || (layer->weight_matrix->dimension_size[1] != layer->state_matrix->dimension_size[2]))
+    return 0;
+
+  descriptor.state         = layer->state_matrix->data;
+  descriptor.spike         = spike_matrix->data;
+  descriptor.weight        = layer->weight_matrix->data;
+  descriptor.rows          = layer->state_matrix->dimension_size[0];
+  descriptor.columns       = layer->state_matrix->dimension_size[1];
+  descriptor.neurons       = layer->state_matrix->dimension_size[2];
+  descriptor.spike_rows    = spike_matrix->dimension_size[0];
+  descriptor.spike_columns = spike_matrix->dimension_size[1];
+  descriptor.weight_rows   = layer->weight_matrix->dimension_size[0];
+  descriptor.kernel_size   = layer->kernel_size;
+  descriptor.kernel_stride = layer->kernel_stride;
+  descriptor.weight_shift  = layer->weight_shift;
+  descriptor.neurons_previous_layer = layer->neurons_previous_Layer;
+  descriptor.epsilon       = layer->epsilon;
+
+  return network->accelerator->submit(network->accelerator, &descriptor);
+}
+
+/* Runs 'cycles' more update cycles of a single chain from the current layer
+ * states and RNG, then refreshes its readout */
+static void SbsBaseNetwork_stepChain(SbsNetwork * network_ptr, uint16_t cycles)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  uint16_t cycle;
+  ASSERT(network != NULL);
+  ASSERT(3 <= network->size);
+  ASSERT(network->layer_array != NULL);
+  ASSERT(0 < cycles);
+
+  if ((network != NULL) && (3 <= network->size)
+      && (network->layer_array != NULL) && (cycles != 0))
+  {
+    uint16_t   i;
+    uint32_t * ticket = network->ticket;
+
+    if (!network->ready)
+      SbsBaseNetwork_reset(network_ptr);
+
+    /************************ Begins Update cycle **************************/
+    for (cycle = 0; cycle < cycles; cycle ++)
+    {
+      for (i = 0; i < network->size; i++)
+      {
+        SbsBaseLayer * layer     = network->layer_array[i];
+        SbsTelemetry * telemetry = layer->telemetry;
+        uint32_t       fields    = (telemetry != NULL) ? telemetry->counters.fields : 0;
+        double         start     = (fields & TELEMETRY_TIME) ? SbsTelemetry_now() : 0.0;
+
+        if (i < network->size - 1)
+        {
+          if (network->phase_hook != NULL)
+            network->phase_hook(network->phase_hook_data, i, PHASE_GENERATE, 0, network->cycle);
+
+          SbsBaseLayer_generateSpikes(layer, network->cycle);
+
+          if (network->phase_hook != NULL)
+            network->phase_hook(network->phase_hook_data, i, PHASE_GENERATE, 1, network->cycle);
+
+          if (fields & TELEMETRY_TIME)
+            telemetry->counters.time += SbsTelemetry_now() - start;
+
+          if (network->spike_trace != NULL)
+          {
+            Multivector * spike_matrix = layer->spike_matrix;
+            SbsSpikeTrace_record(network->spike_trace, i, network->cycle, spike_matrix->data,
+                                 spike_matrix->dimension_size[0], spike_matrix->dimension_size[1]);
+          }
+
+          if (fields & TELEMETRY_SPIKES)
+            SbsTelemetry_countSpikes(telemetry, layer->spike_matrix);
+        }
 
-    if (sum < 1e-20) // TODO: DEFINE constant
-      return;
+        if (0 < i)
+        {
+          if (fields & TELEMETRY_STATE_CHANGE)
+            memcpy(telemetry->previous_state, layer->state_matrix->data,
+                   Multivector_dataSize(layer->state_matrix));
 
-    epsion_over_sum = epsilon / sum;
+          if (fields & TELEMETRY_TIME)
+            start = SbsTelemetry_now();
 
-    for (neuron = 0; neuron < size; neuron ++)
-    {
-      h_p = temp_data[neuron];
-      h = state_vector[neuron];
+          if (network->phase_hook != NULL)
+            network->phase_hook(network->phase_hook_data, i, PHASE_UPDATE, 0, network->cycle);
 
-      h_new = reverse_epsilon * (h + h_p * epsion_over_sum);
-      state_vector[neuron] = h_new;
+          /* Updates only read spikes generated earlier in the cycle, they can
+           * run while the following layers generate theirs */
+          ticket[i] = SbsBaseNetwork_submitUpdate(network, i);
+
+          if (ticket[i] == 0)
+            SbsBaseLayer_update(layer, &network->layer_array[i - 1]->spikes);
+          else if ((network->phase_hook != NULL) || fields)
+          {
+            network->accelerator->wait(network->accelerator, ticket[i]);
+            ticket[i] = 0;
+          }
+
+          if (network->phase_hook != NULL)
+            network->phase_hook(network->phase_hook_data, i, PHASE_UPDATE, 1, network->cycle);
+
+          if (fields & TELEMETRY_TIME)
+            telemetry->counters.time += SbsTelemetry_now() - start;
+
+          if (fields & TELEMETRY_STATE_CHANGE)
+            telemetry->state_change += SbsTelemetry_stateChange(telemetry, layer->state_matrix);
+        }
+
+        if (telemetry != NULL)
+          telemetry->counters.cycles ++;
+      }
+
+      for (i = 1; i < network->size; i ++)
+        if (ticket[i] != 0)
+          network->accelerator->wait(network->accelerator, ticket[i]);
+
+      if (network->context->progress_interval
+          && (network->cycle % network->context->progress_interval == 0))
+        printf(" - Spike cycle: %lu\n", (unsigned long) network->cycle);
+
+      network->cycle ++;
     }
-#else
-#error "Unsupported processor architecture"
-#endif
+    /************************ Ends Update cycle ****************************/
+
+    /************************ Get inferred output **************************/
+    SbsBaseNetwork_readout(network);
   }
 }
 
-static SpikeID SbsBaseLayer_generateSpikeIP(NeuronState * state_vector, uint16_t size)
+/************************ Ensemble *******************************************/
+/* Chains 1 .. ensemble_size - 1 are replicas of the network on contexts of
+ * their own: same layers and weights (shared through the registry), their
+ * own states, arena and RNG stream. Chain 0 is the network itself. */
+
+#ifndef USE_XILINX
+static void * SbsBaseNetwork_chainThread(void * data)
 {
-  ASSERT(state_vector != NULL);
-  ASSERT(0 < size);
+  SbsEnsembleJob *  job = data;
+  SbsEnsembleSync * sync = job->sync;
+  uint16_t          cycles;
 
-  if ((state_vector != NULL) && (0 < size))
+  pthread_mutex_lock(&sync->mutex);
+  for (;;)
   {
-    NeuronState random_s = ((NeuronState)genrand()) / ((NeuronState)0xFFFFFFFF);
-    NeuronState sum      = 0.0f;
-    SpikeID     spikeID;
+    while (!sync->stop && (sync->generation == job->generation))
+      pthread_cond_wait(&sync->start_cond, &sync->mutex);
 
-    ASSERT(random_s <= 1.0F);
+    if (sync->stop)
+      break;
 
-    for (spikeID = 0; spikeID < size; spikeID ++)
-    {
-        sum += state_vector[spikeID];
+    job->generation = sync->generation;
+    cycles = sync->cycles;
+    pthread_mutex_unlock(&sync->mutex);
 
-        ASSERT(sum <= 1 + 1e-5);
+    SbsBaseNetwork_stepChain(job->network, cycles);
 
-        if (random_s <= sum)
-              return spikeID;
-    }
+    pthread_mutex_lock(&sync->mutex);
+    sync->pending --;
+    if (sync->pending == 0)
+      pthread_cond_signal(&sync->done_cond);
   }
+  pthread_mutex_unlock(&sync->mutex);
 
-  return size - 1;
+  return NULL;
 }
 
-static void SbsBaseLayer_initialize(SbsBaseLayer * layer)
+static void SbsBaseNetwork_stopChains(SbsBaseNetwork * network)
 {
-  ASSERT(layer != NULL);
-  ASSERT(layer->state_matrix != NULL);
-  ASSERT(layer->state_matrix->data != NULL);
+  SbsEnsembleSync * sync = network->ensemble_sync;
+  uint8_t           k;
+
+  if (sync == NULL)
+    return;
+
+  pthread_mutex_lock(&sync->mutex);
+  sync->stop = 1;
+  pthread_cond_broadcast(&sync->start_cond);
+  pthread_mutex_unlock(&sync->mutex);
+
+  for (k = 1; k < network->ensemble_size; k ++)
+    if (network->ensemble_job[k].started)
+      pthread_join(network->ensemble_job[k].thread, NULL);
+
+  pthread_cond_destroy(&sync->done_cond);
+  pthread_cond_destroy(&sync->start_cond);
+  pthread_mutex_destroy(&sync->mutex);
+  free(sync);
+  network->ensemble_sync = NULL;
+}
 
-  if ((layer != NULL) && (layer->state_matrix != NULL) && (layer->state_matrix->data != NULL))
+/* A chain whose thread could not be started is run by step() */
+static void SbsBaseNetwork_startChains(SbsBaseNetwork * network)
+{
+  SbsEnsembleSync * sync = malloc(sizeof(SbsEnsembleSync));
+  uint8_t           k;
+
+  if (sync == NULL)
+    return;
+
+  memset(sync, 0x0, sizeof(SbsEnsembleSync));
+
+  if (pthread_mutex_init(&sync->mutex, NULL) != 0)
   {
-    Multivector * state_matrix      = layer->state_matrix;
-    uint16_t      rows              = state_matrix->dimension_size[0];
-    uint16_t      columns           = state_matrix->dimension_size[1];
-    uint16_t      neurons           = state_matrix->dimension_size[2];
-    NeuronState * state_matrix_data = state_matrix->data;
+    free(sync);
+    return;
+  }
 
-    uint16_t row;
-    uint16_t column;
-    size_t   current_row_index;
+  pthread_cond_init(&sync->start_cond, NULL);
+  pthread_cond_init(&sync->done_cond, NULL);
+  network->ensemble_sync = sync;
 
-    for (row = 0; row < rows; row++)
+  for (k = 1; k < network->ensemble_size; k ++)
+  {
+    SbsEnsembleJob * job = &network->ensemble_job[k];
+
+    job->sync       = sync;
+    job->generation = 0;
+    job->started    = (pthread_create(&job->thread, NULL, SbsBaseNetwork_chainThread, job) == 0);
+  }
+}
+#endif
+
+static void SbsBaseNetwork_deleteEnsemble(SbsBaseNetwork * network)
+{
+  uint8_t k;
+
+#ifndef USE_XILINX
+  SbsBaseNetwork_stopChains(network);
+#endif
+
+  free(network->ensemble_job);
+  network->ensemble_job = NULL;
+
+  if (network->ensemble != NULL)
+  {
+    for (k = 1; k < network->ensemble_size; k ++)
     {
-      current_row_index = row * columns * neurons;
-      for (column = 0; column < columns; column++)
+      if (network->ensemble[k - 1] != NULL)
       {
-        SbsBaseLayer_initializeIP(&state_matrix_data[current_row_index + column * neurons], neurons);
+        SbsContext * context = (SbsContext *) ((SbsBaseNetwork *) network->ensemble[k - 1])->context;
+        SbsBaseNetwork_delete(&network->ensemble[k - 1]);
+        SbsBaseContext_delete(&context);
       }
     }
+
+    free(network->ensemble);
+    network->ensemble = NULL;
   }
+
+  free(network->ensemble_output);
+  network->ensemble_output = NULL;
 }
 
-static void SbsBaseLayer_giveWeights(SbsLayer * layer, SbsWeightMatrix weight_matrix)
+/* Settings are copied here, changes made later apply to chain 0 only (see setEnsemble) */
+static int SbsBaseNetwork_buildEnsemble(SbsBaseNetwork * network)
 {
-  ASSERT(layer != NULL);
-  ASSERT(weight_matrix != NULL);
+  SbsBaseContext * context = network->context;
+  size_t           memory_size = SbsMemory_plan((SbsLayer **) network->layer_array, network->size, NULL);
+  uint16_t         neurons = network->layer_array[network->size - 1]->state_matrix->dimension_size[2];
+  uint8_t          k;
+  uint16_t         i;
+
+  network->ensemble        = calloc(network->ensemble_size - 1, sizeof(SbsNetwork *));
+  network->ensemble_job    = calloc(network->ensemble_size, sizeof(SbsEnsembleJob));
+  network->ensemble_output = malloc(neurons * sizeof(NeuronState));
+
+  ASSERT(network->ensemble != NULL);
+  ASSERT(network->ensemble_job != NULL);
+  ASSERT(network->ensemble_output != NULL);
+
+  if ((network->ensemble == NULL) || (network->ensemble_job == NULL)
+      || (network->ensemble_output == NULL))
+  {
+    SbsBaseNetwork_deleteEnsemble(network);
+    return 0;
+  }
 
-  if (layer != NULL)
-    ((SbsBaseLayer *)layer)->weight_matrix = (Multivector *) weight_matrix;
+  for (k = 1; k < network->ensemble_size; k ++)
+  {
+    SbsBaseContext * chain_context = (SbsBaseContext *) SbsBaseContext_new(memory_size,
+        context->seed + k * SBS_ENSEMBLE_SEED_STRIDE);
+    SbsBaseNetwork * chain = NULL;
+
+    if (chain_context != NULL)
+    {
+      chain_context->progress_interval     = 0;
+      chain_context->sparse_state_interval = context->sparse_state_interval;
+      chain_context->sparse_state_switch   = context->sparse_state_switch;
+      chain_context->sampling              = context->sampling;
+      chain_context->update_tile           = context->update_tile;
+      chain = (SbsBaseNetwork *) SbsBaseNetwork_new((SbsContext *) chain_context);
+    }
+
+    ASSERT(chain != NULL);
+
+    if (chain == NULL)
+    {
+      if (chain_context != NULL)
+        SbsBaseContext_delete((SbsContext **) &chain_context);
+      SbsBaseNetwork_deleteEnsemble(network);
+      return 0;
+    }
+
+    for (i = 0; i < network->size; i ++)
+      SbsBaseNetwork_giveLayer((SbsNetwork *) chain, SbsBaseLayer_clone(network->layer_array[i]));
+
+    chain->warm_start_blend = network->warm_start_blend;
+    chain->accelerator      = network->accelerator;
+    network->ensemble[k - 1] = (SbsNetwork *) chain;
+  }
+
+  for (k = 0; k < network->ensemble_size; k ++)
+    network->ensemble_job[k].network = (k == 0) ? (SbsNetwork *) network : network->ensemble[k - 1];
+
+#ifndef USE_XILINX
+  SbsBaseNetwork_startChains(network);
+#endif
+
+  network->ensemble_seed_count = context->seed_count;
+
+  return 1;
 }
 
-static void SbsBaseLayer_setEpsilon(SbsLayer * layer, float epsilon)
+/* Mean of the chain output vectors, inferred output is its maximum */
+static void SbsBaseNetwork_readoutEnsemble(SbsBaseNetwork * network)
 {
-  ASSERT(layer != NULL);
-  /*ASSERT(epsilon != 0.0f);*/ /* 0.0 is allowed? */
+  Multivector * output_state_matrix = network->layer_array[network->size - 1]->state_matrix;
+  uint16_t      neurons = output_state_matrix->dimension_size[2];
+  NeuronState   max_value = 0;
+  uint16_t      i;
+  uint8_t       k;
 
-  if (layer != NULL)
-    ((SbsBaseLayer *)layer)->epsilon = epsilon;
+  memcpy(network->ensemble_output, output_state_matrix->data, neurons * sizeof(NeuronState));
+
+  for (k = 1; k < network->ensemble_size; k ++)
+  {
+    SbsBaseNetwork * chain = (SbsBaseNetwork *) network->ensemble[k - 1];
+    NeuronState *    output_state_vector = chain->layer_array[chain->size - 1]->state_matrix->data;
+
+    for (i = 0; i < neurons; i ++)
+      network->ensemble_output[i] += output_state_vector[i];
+  }
+
+  for (i = 0; i < neurons; i ++)
+  {
+    network->ensemble_output[i] /= network->ensemble_size;
+    if (max_value < network->ensemble_output[i])
+    {
+      network->inferred_output = i;
+      max_value = network->ensemble_output[i];
+    }
+  }
 }
 
-static Multivector * SbsBaseLayer_generateSpikes(SbsBaseLayer * layer)
+/* Runs 'cycles' more update cycles from the current layer states and RNG,
+ * then refreshes the readout (getInferredOutput, getOutputVector) */
+static void SbsBaseNetwork_step(SbsNetwork * network_ptr, uint16_t cycles)
 {
-  Multivector * spike_matrix = NULL;
-  ASSERT(layer != NULL);
-  ASSERT(layer->state_matrix != NULL);
-  ASSERT(layer->spike_matrix != NULL);
-  ASSERT(layer->state_matrix->data != NULL);
-  ASSERT(layer->spike_matrix->data != NULL);
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  uint8_t          k;
 
-  if (   (layer != NULL)
-      && (layer->state_matrix != NULL)
-      && (layer->spike_matrix != NULL)
-      && (layer->state_matrix->data != NULL)
-      && (layer->spike_matrix->data != NULL))
+  ASSERT(network != NULL);
+
+  if (network == NULL)
+    return;
+
+  if ((network->ensemble_size <= 1) || (network->size < 3)
+      || ((network->ensemble == NULL) && !SbsBaseNetwork_buildEnsemble(network)))
   {
-      Multivector * state_matrix      = layer->state_matrix;
-      uint16_t      rows              = state_matrix->dimension_size[0];
-      uint16_t      columns           = state_matrix->dimension_size[1];
-      uint16_t      neurons           = state_matrix->dimension_size[2];
-      NeuronState * state_matrix_data = state_matrix->data;
-      SpikeID *     spike_matrix_data = layer->spike_matrix->data;
+    SbsBaseNetwork_stepChain(network_ptr, cycles);
+    return;
+  }
 
-      uint16_t row;
-      uint16_t column;
-      size_t   current_row_index;
-      size_t   current_row_column_index;
+  /* Every chain samples the input held by chain 0 */
+  for (k = 1; k < network->ensemble_size; k ++)
+    memcpy(((SbsBaseNetwork *) network->ensemble[k - 1])->layer_array[0]->state_matrix->data,
+           network->layer_array[0]->state_matrix->data,
+           Multivector_dataSize(network->layer_array[0]->state_matrix));
 
-      for (row = 0; row < rows; row++)
-      {
-        current_row_index = columns * row;
-        for (column = 0; column < columns; column++)
-        {
-            current_row_column_index = current_row_index + column;
-            spike_matrix_data[current_row_column_index] = SbsBaseLayer_generateSpikeIP(&state_matrix_data[current_row_column_index * neurons], neurons);
-        }
-      }
+#ifdef USE_XILINX
+  for (k = 0; k < network->ensemble_size; k ++)
+    SbsBaseNetwork_stepChain(network->ensemble_job[k].network, cycles);
+#else
+  {
+    SbsEnsembleSync * sync = network->ensemble_sync;
 
-      spike_matrix = layer->spike_matrix;
+    if (sync != NULL)
+    {
+      pthread_mutex_lock(&sync->mutex);
+      sync->cycles  = cycles;
+      sync->pending = 0;
+      for (k = 1; k < network->ensemble_size; k ++)
+        sync->pending += network->ensemble_job[k].started;
+      sync->generation ++;
+      pthread_cond_broadcast(&sync->start_cond);
+      pthread_mutex_unlock(&sync->mutex);
+    }
+
+    for (k = 0; k < network->ensemble_size; k ++)
+      if ((k == 0) || (sync == NULL) || !network->ensemble_job[k].started)
+        SbsBaseNetwork_stepChain(network->ensemble_job[k].network, cycles);
+
+    if (sync != NULL)
+    {
+      pthread_mutex_lock(&sync->mutex);
+      while (0 < sync->pending)
+        pthread_cond_wait(&sync->done_cond, &sync->mutex);
+      pthread_mutex_unlock(&sync->mutex);
+    }
   }
+#endif
 
-  return spike_matrix;
+  SbsBaseNetwork_readoutEnsemble(network);
 }
 
-static void SbsBaseLayer_update(SbsBaseLayer * layer, Multivector * input_spike_matrix)
+static void SbsBaseNetwork_setAccelerator(SbsNetwork * network_ptr, SbsAccelerator * device)
 {
-  ASSERT(layer != NULL);
-  ASSERT(layer->state_matrix != NULL);
-  ASSERT(layer->state_matrix->data != NULL);
-  ASSERT(layer->weight_matrix != NULL);
-  ASSERT(layer->weight_matrix->data != NULL);
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  uint8_t          k;
 
-  ASSERT(0 < layer->kernel_size);
+  ASSERT(network != NULL);
 
-  ASSERT(input_spike_matrix != NULL);
-  ASSERT(input_spike_matrix->data != NULL);
+  if (network != NULL)
+  {
+    network->accelerator = device;
 
-  if (   (layer != NULL)
-      && (layer->state_matrix != NULL)
-      && (layer->state_matrix->data != NULL)
-      && (layer->weight_matrix != NULL)
-      && (layer->weight_matrix->data != NULL)
-      && (input_spike_matrix != NULL)
-      && (input_spike_matrix->data != NULL))
+    for (k = 1; (network->ensemble != NULL) && (k < network->ensemble_size); k ++)
+      ((SbsBaseNetwork *) network->ensemble[k - 1])->accelerator = device;
+  }
+}
+
+static void SbsBaseNetwork_setEnsemble(SbsNetwork * network_ptr, uint8_t chains)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+
+  ASSERT(network != NULL);
+  ASSERT(0 < chains);
+
+  if (network != NULL)
   {
-      SpikeID   spikeID       = 0;
-      SpikeID * spike_data    = input_spike_matrix->data;
-      uint16_t  spike_rows    = input_spike_matrix->dimension_size[0];
-      uint16_t  spike_columns = input_spike_matrix->dimension_size[1];
+    SbsBaseNetwork_deleteEnsemble(network);
+    network->ensemble_size = (1 < chains) ? chains : 1;
+  }
+}
 
-      NeuronState * weight_data    = layer->weight_matrix->data;
-      NeuronState * weight_vector  = NULL;
-      uint16_t      weight_columns = layer->weight_matrix->dimension_size[1];
+static void SbsBaseNetwork_updateCycle(SbsNetwork * network_ptr, uint16_t cycles)
+{
+  SbsBaseNetwork_reset(network_ptr);
+  SbsBaseNetwork_step(network_ptr, cycles);
+}
 
-      NeuronState * state_data     = layer->state_matrix->data;
-      NeuronState * state_vector   = NULL;
-      uint16_t      state_row_size = layer->state_matrix->dimension_size[1] * layer->state_matrix->dimension_size[2];
-      uint16_t      neurons        = layer->state_matrix->dimension_size[2];
+static void SbsBaseNetwork_setWarmStart(SbsNetwork * network, float blend)
+{
+  ASSERT(network != NULL);
+  ASSERT((0.0f <= blend) && (blend <= 1.0f));
 
-      uint16_t kernel_stride  = layer->kernel_stride;
-      uint16_t kernel_size    = layer->kernel_size;
-      uint16_t row_shift      = kernel_size;
-      uint16_t column_shift   = 1;
-      uint16_t section_shift  = 0;
+  if (network != NULL)
+  {
+    ((SbsBaseNetwork *) network)->warm_start_blend =
+        (blend < 0.0f) ? 0.0f : (1.0f < blend) ? 1.0f : blend;
+  }
+}
 
+static void SbsBaseNetwork_setSpikeTrace(SbsNetwork * network, SbsSpikeTrace * trace)
+{
+  ASSERT(network != NULL);
 
-      uint16_t layer_row;         /* Row index for navigation on the layer */
-      uint16_t layer_column;      /* Column index for navigation on the layer */
-      uint16_t kernel_column_pos; /* Kernel column position for navigation on the spike matrix */
-      uint16_t kernel_row_pos;    /* Kernel row position for navigation on the spike matrix */
-      uint16_t kernel_row;        /* Row index for navigation inside kernel */
-      uint16_t kernel_column;     /* Column index for navigation inside kernel */
+  if (network != NULL)
+  {
+    ((SbsBaseNetwork *) network)->spike_trace = trace;
+  }
+}
 
-      uint16_t  spike_row_index;
+static void SbsBaseNetwork_setTelemetry(SbsNetwork * network_ptr, uint32_t fields)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  uint16_t i;
 
-      uint16_t neurons_previous_Layer = layer->neurons_previous_Layer;
+  ASSERT(network != NULL);
 
-      float epsilon = layer->epsilon;
+  if (network != NULL)
+  {
+    for (i = 0; i < network->size; i ++)
+    {
+      SbsTelemetry_delete(&network->layer_array[i]->telemetry);
 
-      ASSERT(weight_columns == neurons);
+      if (fields & TELEMETRY_ALL)
+        network->layer_array[i]->telemetry = SbsTelemetry_new(network->layer_array[i],
+                                                              fields & TELEMETRY_ALL);
+    }
+  }
+}
 
-      if (weight_columns != neurons)
-        return;
+static void SbsBaseNetwork_getTelemetry(SbsNetwork * network_ptr, uint16_t layer, SbsLayerTelemetry * telemetry)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
 
-      if (layer->weight_shift == ROW_SHIFT)
-      {
-        row_shift = 1;
-        column_shift = kernel_size;
-      }
+  ASSERT(network != NULL);
+  ASSERT(layer < network->size);
+  ASSERT(telemetry != NULL);
 
-      /* Update begins */
-      for (kernel_row_pos = 0, layer_row = 0;
-           kernel_row_pos < spike_rows - (kernel_size - 1);
-           kernel_row_pos += kernel_stride, layer_row ++)
+  if ((network != NULL) && (layer < network->size) && (telemetry != NULL))
+  {
+    SbsTelemetry * layer_telemetry = network->layer_array[layer]->telemetry;
+
+    memset(telemetry, 0x00, sizeof(SbsLayerTelemetry));
+
+    if (layer_telemetry != NULL)
+    {
+      *telemetry = layer_telemetry->counters;
+      telemetry->spike_histogram = layer_telemetry->spike_histogram;
+
+      if (layer_telemetry->spike_histogram != NULL)
       {
-        for (kernel_column_pos = 0, layer_column = 0;
-             kernel_column_pos < spike_columns - (kernel_size - 1);
-             kernel_column_pos += kernel_stride, layer_column ++)
-        {
-          state_vector = &state_data[layer_row * state_row_size + layer_column * neurons];
-          for (kernel_row = 0; kernel_row < kernel_size; kernel_row ++)
+        uint64_t spikes = 0;
+        uint16_t neuron;
+
+        for (neuron = 0; neuron < telemetry->neurons; neuron ++)
+          spikes += layer_telemetry->spike_histogram[neuron];
+
+        for (neuron = 0; (0 < spikes) && (neuron < telemetry->neurons); neuron ++)
+          if (layer_telemetry->spike_histogram[neuron])
           {
-              spike_row_index = (kernel_row_pos + kernel_row) * spike_columns;
-            for (kernel_column = 0; kernel_column < kernel_size; kernel_column ++)
-            {
-              spikeID = spike_data[spike_row_index + kernel_column_pos + kernel_column];
+            double p = (double) layer_telemetry->spike_histogram[neuron] / spikes;
+            telemetry->spike_entropy -= p * log2(p);
+          }
+      }
+
+      if (0 < telemetry->cycles)
+        telemetry->state_change = layer_telemetry->state_change / telemetry->cycles;
+    }
+  }
+}
 
-              section_shift = (kernel_row * row_shift + kernel_column * column_shift) * neurons_previous_Layer;
+static size_t SbsBaseNetwork_getTelemetryJSON(SbsNetwork * network_ptr, char * buffer, size_t size)
+{
+  SbsBaseNetwork *  network = (SbsBaseNetwork *) network_ptr;
+  SbsLayerTelemetry telemetry;
+  size_t            length = 0;
+  uint16_t          i;
+  uint16_t          neuron;
 
-              weight_vector = &weight_data[(spikeID + section_shift) * weight_columns];
+  ASSERT(network != NULL);
+  ASSERT((buffer != NULL) || (size == 0));
 
-              SbsBaseLayer_updateIP(layer, state_vector, weight_vector, neurons, epsilon);
-            }
-          }
-        }
+/* Appends like snprintf(), counting what does not fit */
+#define SBS_JSON_APPEND(...) \
+  length += snprintf(buffer + ((length < size) ? length : size), \
+                     (length < size) ? size - length : 0, __VA_ARGS__)
+
+  if ((network != NULL) && ((buffer != NULL) || (size == 0)))
+  {
+    SBS_JSON_APPEND("{\"cycle\": %u, \"layers\": [", network->cycle);
+
+    for (i = 0; i < network->size; i ++)
+    {
+      SbsBaseNetwork_getTelemetry(network_ptr, i, &telemetry);
+
+      SBS_JSON_APPEND("%s\n  {\"layer\": %u, \"fields\": %u, \"cycles\": %u", i ? "," : "",
+                      i, telemetry.fields, telemetry.cycles);
+
+      if (telemetry.fields & TELEMETRY_UPDATES)
+        SBS_JSON_APPEND(", \"updates\": %llu, \"skipped_updates\": %llu",
+                        (unsigned long long) telemetry.updates,
+                        (unsigned long long) telemetry.skipped_updates);
+
+      if (telemetry.fields & TELEMETRY_WEIGHT_BYTES)
+        SBS_JSON_APPEND(", \"weight_bytes\": %llu", (unsigned long long) telemetry.weight_bytes);
+
+      if (telemetry.fields & TELEMETRY_SPIKES)
+      {
+        SBS_JSON_APPEND(", \"spike_entropy\": %g, \"spike_histogram\": [", telemetry.spike_entropy);
+        for (neuron = 0; neuron < telemetry.neurons; neuron ++)
+          SBS_JSON_APPEND("%s%u", neuron ? ", " : "", telemetry.spike_histogram[neuron]);
+        SBS_JSON_APPEND("]");
       }
-      /* Update ends*/
+
+      if (telemetry.fields & TELEMETRY_STATE_CHANGE)
+        SBS_JSON_APPEND(", \"state_change\": %g", telemetry.state_change);
+
+      if (telemetry.fields & TELEMETRY_TIME)
+        SBS_JSON_APPEND(", \"time\": %g", telemetry.time);
+
+      SBS_JSON_APPEND("}");
+    }
+
+    SBS_JSON_APPEND("\n]}\n");
+  }
+
+#undef SBS_JSON_APPEND
+
+  return length;
+}
+
+static void SbsBaseNetwork_setPhaseHook(SbsNetwork * network, SbsPhaseHook hook, void * data)
+{
+  ASSERT(network != NULL);
+
+  if (network != NULL)
+  {
+    ((SbsBaseNetwork *) network)->phase_hook = hook;
+    ((SbsBaseNetwork *) network)->phase_hook_data = data;
+  }
+}
+
+/* Snapshot layout: header, layer table, then the data part aligned to 8 bytes,
+ * the sparse part and the sampling part. The data part lays the buffers out as
+ * the arena does, each one at an SBS_MEMORY_ALIGNMENT offset, so a contiguous
+ * network copies it at once */
+static size_t SbsBaseNetwork_snapshotDataOffset(uint16_t layers)
+{
+  return (sizeof(SbsSnapshotHeader) + layers * sizeof(SbsSnapshotLayer) + 7) & ~(size_t) 7;
+}
+
+static size_t SbsBaseNetwork_snapshotDataSize(SbsBaseNetwork * network)
+{
+  size_t   size = 0;
+  uint16_t i;
+
+  for (i = 0; i < network->size; i ++)
+  {
+    size = Memory_align(size) + Multivector_dataSize(network->layer_array[i]->state_matrix);
+    size = Memory_align(size) + Multivector_dataSize(network->layer_array[i]->spike_matrix);
   }
+
+  return size;
 }
 
-/*****************************************************************************/
+static size_t SbsBaseNetwork_snapshotSparseSize(SbsBaseLayer * layer)
+{
+  size_t positions = (size_t) layer->state_matrix->dimension_size[0] * layer->state_matrix->dimension_size[1];
+
+  return (layer->active_count != NULL) ?
+      positions * (1 + layer->state_matrix->dimension_size[2]) * sizeof(uint16_t) : 0;
+}
 
-static SbsNetwork * SbsBaseNetwork_new(void)
+static size_t SbsBaseNetwork_snapshotSamplingSize(SbsBaseLayer * layer)
 {
-  SbsBaseNetwork * network = NULL;
+  size_t positions = (size_t) layer->state_matrix->dimension_size[0] * layer->state_matrix->dimension_size[1];
 
-  network = malloc(sizeof(SbsBaseNetwork));
+  return (layer->sample_offset != NULL) ? positions * sizeof(uint32_t) : 0;
+}
 
-  ASSERT(network != NULL);
+/* Copies the layer buffers in or out of the snapshot data part: one copy when
+ * the network span holds nothing else, otherwise buffer by buffer, as with
+ * buffers on the heap or after another network's in the arena */
+static void SbsBaseNetwork_copyLayerData(SbsBaseNetwork * network, uint8_t * data, uint8_t save)
+{
+  size_t   offset = 0;
+  uint16_t i;
 
-  if (network != NULL)
+  if (network->memory_contiguous && (network->memory_size == SbsBaseNetwork_snapshotDataSize(network)))
   {
-      memset(network, 0x0, sizeof(SbsBaseNetwork));
-      network->vtbl = _SbsNetwork;
-      network->input_label = (uint8_t)-1;
-      network->inferred_output = (uint8_t)-1;
-
-      sgenrand(666); /*TODO: Create MT19937 object wrapper */
+    if (save)
+      memcpy(data, network->memory_begin, network->memory_size);
+    else
+      memcpy(network->memory_begin, data, network->memory_size);
+    return;
   }
 
-  ASSERT(network->size == 0);
-  ASSERT(network->layer_array == NULL);
-
-  return (SbsNetwork *) network;
-}
+  for (i = 0; i < network->size; i ++)
+  {
+    Multivector * matrix[2] = { network->layer_array[i]->state_matrix,
+                                network->layer_array[i]->spike_matrix };
+    uint8_t m;
 
-static void SbsBaseNetwork_delete(SbsNetwork ** network_ptr)
-{
-  ASSERT(network_ptr != NULL);
-  ASSERT(*network_ptr != NULL);
+    for (m = 0; m < 2; m ++)
+    {
+      size_t size = Multivector_dataSize(matrix[m]);
 
-  if ((network_ptr != NULL) && (*network_ptr != NULL))
-  {
-    SbsBaseNetwork ** network = (SbsBaseNetwork **) network_ptr;
-    while (0 < (*network)->size)
-      SbsBaseLayer_delete((SbsLayer **)&(*network)->layer_array[--((*network)->size)]);
+      if (save)
+      {
+        memset(&data[offset], 0x00, Memory_align(offset) - offset);
+        memcpy(&data[Memory_align(offset)], matrix[m]->data, size);
+      }
+      else
+        memcpy(matrix[m]->data, &data[Memory_align(offset)], size);
 
-    free(*network);
-    *network = NULL;
+      offset = Memory_align(offset) + size;
+    }
   }
 }
 
-static void SbsBaseNetwork_giveLayer(SbsNetwork * network_ptr, SbsLayer * layer)
+static size_t SbsBaseNetwork_checkpoint(SbsNetwork * network_ptr, void * buffer, size_t size)
 {
-  ASSERT(network_ptr != NULL);
-  ASSERT(layer != NULL);
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  size_t           snapshot_size = 0;
 
-  if ((network_ptr != NULL) && (layer != NULL))
-  {
-    SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
-    SbsBaseLayer ** layer_array = network->layer_array;
-    uint8_t size = network->size;
+  ASSERT(network != NULL);
+  ASSERT((buffer != NULL) || (size == 0));
 
-    ASSERT(size < 0xFF);
+  if ((network != NULL) && ((buffer != NULL) || (size == 0)))
+  {
+    size_t   data_offset = SbsBaseNetwork_snapshotDataOffset(network->size);
+    size_t   data_size = SbsBaseNetwork_snapshotDataSize(network);
+    size_t   sparse_size = 0;
+    size_t   sampling_size = 0;
+    uint16_t i;
 
-    layer_array = realloc(layer_array, (size + 1) * sizeof(SbsBaseLayer *));
+    for (i = 0; i < network->size; i ++)
+    {
+      sparse_size += SbsBaseNetwork_snapshotSparseSize(network->layer_array[i]);
+      sampling_size += SbsBaseNetwork_snapshotSamplingSize(network->layer_array[i]);
+    }
 
-    ASSERT(layer_array != NULL);
+    snapshot_size = data_offset + data_size + sparse_size + sampling_size;
 
-    if (layer_array != NULL)
+    if (snapshot_size <= size)
     {
-        layer_array[size] = (SbsBaseLayer *)layer;
+      SbsSnapshotHeader * header = buffer;
+      SbsSnapshotLayer *  layer_table = (SbsSnapshotLayer *) (header + 1);
+      uint8_t *           sparse = (uint8_t *) buffer + data_offset + data_size;
+      uint8_t *           sampling = sparse + sparse_size;
+      MT19937 *           random = &network->context->random;
+      uint16_t            n;
+
+      memset(buffer, 0x00, data_offset);
+
+      header->magic = SBS_SNAPSHOT_MAGIC;
+      header->version = SBS_SNAPSHOT_VERSION;
+      header->layers = network->size;
+      header->ready = network->ready;
+      header->input_label = network->input_label;
+      header->inferred_output = network->inferred_output;
+      header->cycle = network->cycle;
+      header->random_index = random->mti;
+      for (n = 0; n < MT19937_N; n ++)
+        header->random_state[n] = (uint32_t) random->mt[n];
+      header->data_size = data_size;
+      header->sparse_size = sparse_size;
+      header->sampling_size = sampling_size;
+
+      for (i = 0; i < network->size; i ++)
+      {
+        SbsBaseLayer * layer = network->layer_array[i];
+        size_t positions = (size_t) layer->state_matrix->dimension_size[0]
+                         * layer->state_matrix->dimension_size[1];
+
+        layer_table[i].rows = layer->state_matrix->dimension_size[0];
+        layer_table[i].columns = layer->state_matrix->dimension_size[1];
+        layer_table[i].neurons = layer->state_matrix->dimension_size[2];
+        layer_table[i].sparse_state_counter = layer->sparse_state_counter;
+        layer_table[i].sparse_state = (layer->active_count != NULL);
+        layer_table[i].state_layout = layer->state_layout;
+        layer_table[i].sampling = (layer->sample_offset != NULL);
+
+        if (layer->active_count != NULL)
+        {
+          memcpy(sparse, layer->active_count, positions * sizeof(uint16_t));
+          sparse += positions * sizeof(uint16_t);
+          memcpy(sparse, layer->active_index, positions * layer_table[i].neurons * sizeof(uint16_t));
+          sparse += positions * layer_table[i].neurons * sizeof(uint16_t);
+        }
 
-        network->layer_array = layer_array;
-        network->size ++;
+        if (layer->sample_offset != NULL)
+        {
+          memcpy(sampling, layer->sample_offset, positions * sizeof(uint32_t));
+          sampling += positions * sizeof(uint32_t);
+        }
+      }
+
+      SbsBaseNetwork_copyLayerData(network, (uint8_t *) buffer + data_offset, 1);
     }
   }
+
+  return snapshot_size;
 }
 
-static void SbsBaseNetwork_loadInput(SbsNetwork * network_ptr, char * file_name)
+static size_t SbsBaseNetwork_restore(SbsNetwork * network_ptr, const void * buffer, size_t size)
 {
-  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  SbsBaseNetwork *          network = (SbsBaseNetwork *) network_ptr;
+  const SbsSnapshotHeader * header = buffer;
+  const SbsSnapshotLayer *  layer_table;
+  const uint8_t *           sparse;
+  const uint8_t *           sampling;
+  size_t                    data_offset;
+  size_t                    sparse_size;
+  size_t                    sampling_size;
+  size_t                    snapshot_size;
+  uint16_t                  i;
+  uint16_t                  n;
+
   ASSERT(network != NULL);
-  ASSERT(1 <= network->size);
-  ASSERT(network->layer_array != NULL);
-  ASSERT(*network->layer_array != NULL);
+  ASSERT(buffer != NULL);
 
-  ASSERT(file_name != NULL);
+  if ((network == NULL) || (buffer == NULL) || (size < sizeof(SbsSnapshotHeader))
+      || (header->magic != SBS_SNAPSHOT_MAGIC) || (header->version != SBS_SNAPSHOT_VERSION)
+      || (header->layers != network->size)
+      || (header->data_size != SbsBaseNetwork_snapshotDataSize(network)))
+    return 0;
 
-  if ((network != NULL)
-      && (1 <= network->size)
-      && (network->layer_array != NULL) && (*network->layer_array != NULL)
-      && (file_name != NULL))
+  data_offset = SbsBaseNetwork_snapshotDataOffset(network->size);
+  layer_table = (const SbsSnapshotLayer *) (header + 1);
+
+  if (size < data_offset)
+    return 0;
+
+  /* Same topology, the same layers in sparse-state mode and the same layouts.
+   * A chain past its first cycle in a SbsSampling mode other than
+   * SAMPLING_RANDOM resumes only with the offsets of its spiking layers */
+  for (sparse_size = 0, sampling_size = 0, i = 0; i < network->size; i ++)
   {
-#ifdef USE_XILINX
-    FIL fil; /* File object */
-    FRESULT rc;
-    rc = f_open (&fil, file_name, FA_READ);
-    ASSERT(rc == FR_OK);
+    SbsBaseLayer * layer = network->layer_array[i];
+    size_t positions = (size_t) layer->state_matrix->dimension_size[0]
+                     * layer->state_matrix->dimension_size[1];
+
+    if ((layer_table[i].rows != layer->state_matrix->dimension_size[0])
+        || (layer_table[i].columns != layer->state_matrix->dimension_size[1])
+        || (layer_table[i].neurons != layer->state_matrix->dimension_size[2])
+        || (layer_table[i].sparse_state && (layer->active_count == NULL))
+        || (layer_table[i].state_layout != layer->state_layout)
+        || (!layer_table[i].sampling && (i < network->size - 1) && (0 < header->cycle)
+            && (network->context->sampling != SAMPLING_RANDOM)))
+      return 0;
+
+    if (layer_table[i].sparse_state)
+      sparse_size += SbsBaseNetwork_snapshotSparseSize(layer);
+
+    if (layer_table[i].sampling)
+      sampling_size += positions * sizeof(uint32_t);
+  }
 
-    if (rc == FR_OK)
-    {
-      SbsBaseLayer * input_layer = network->layer_array[0];
-      uint16_t       rows        = input_layer->state_matrix->dimension_size[0];
-      uint16_t       columns     = input_layer->state_matrix->dimension_size[1];
-      uint16_t       neurons     = input_layer->state_matrix->dimension_size[2];
-      NeuronState *  data        = input_layer->state_matrix->data;
+  /* The sparse and sampling parts hold exactly the lists and offsets of those layers */
+  if ((header->sparse_size != sparse_size) || (header->sampling_size != sampling_size))
+    return 0;
 
-      uint16_t row;
-      uint16_t column;
-      size_t   read_result = 0;
+  snapshot_size = data_offset + header->data_size + sparse_size + sampling_size;
 
-      uint8_t good_reading_flag = 1;
+  if (size < snapshot_size)
+    return 0;
 
-      size_t inference_population_size = sizeof(NeuronState) * neurons;
+  /* Active counts from 1 to the neuron count, indices below it */
+  sparse = (const uint8_t *) buffer + data_offset + header->data_size;
+  sampling = sparse + sparse_size;
 
-      for (column = 0; (column < columns) && good_reading_flag; column++)
-        for (row = 0; (row < rows) && good_reading_flag; row++)
-        {
-          rc = f_read (&fil, &data[column * neurons + row * columns * neurons],
-                       inference_population_size, &read_result);
+  for (i = 0; i < network->size; i ++)
+  {
+    size_t positions = (size_t) layer_table[i].rows * layer_table[i].columns;
+    const uint8_t * index = sparse + positions * sizeof(uint16_t);
+    size_t position;
+    uint16_t count;
+    uint16_t k;
 
-          good_reading_flag = read_result == inference_population_size;
-        }
+    if (!layer_table[i].sparse_state)
+      continue;
 
-      if (good_reading_flag)
+    for (position = 0; position < positions; position ++)
+    {
+      memcpy(&count, sparse + position * sizeof(uint16_t), sizeof(count));
+
+      if ((count == 0) || (layer_table[i].neurons < count))
+        return 0;
+
+      for (k = 0; k < count; k ++)
       {
-        rc = f_read (&fil, &network->input_label, sizeof(uint8_t), &read_result);
-        network->input_label--;
-        good_reading_flag = read_result == sizeof(uint8_t);
+        uint16_t neuron;
+        memcpy(&neuron, index + ((size_t) position * layer_table[i].neurons + k) * sizeof(uint16_t),
+               sizeof(neuron));
+        if (layer_table[i].neurons <= neuron)
+          return 0;
       }
-
-      f_close (&fil);
-      ASSERT(good_reading_flag);
     }
-#else
-    FILE * file = fopen(file_name, "rb");
 
-    ASSERT(file != NULL);
+    sparse = index + positions * layer_table[i].neurons * sizeof(uint16_t);
+  }
 
-    if (file != NULL)
+  /* Allocated before anything is copied, a failure leaves the network untouched */
+  for (i = 0; i < network->size; i ++)
+  {
+    SbsBaseLayer * layer = network->layer_array[i];
+    size_t positions = (size_t) layer_table[i].rows * layer_table[i].columns;
+
+    if (layer_table[i].sampling && (layer->sample_offset == NULL))
     {
-      SbsBaseLayer * input_layer = network->layer_array[0];
-      uint16_t rows = input_layer->state_matrix->dimension_size[0];
-      uint16_t columns = input_layer->state_matrix->dimension_size[1];
-      uint16_t neurons = input_layer->state_matrix->dimension_size[2];
-      NeuronState * data = input_layer->state_matrix->data;
+      layer->sample_offset = malloc(positions * sizeof(uint32_t));
+      ASSERT(layer->sample_offset != NULL);
+      if (layer->sample_offset == NULL)
+        return 0;
+    }
+  }
 
-      uint16_t row;
-      uint16_t column;
-      size_t read_result = 0;
+  sparse = (const uint8_t *) buffer + data_offset + header->data_size;
 
-      uint8_t good_reading_flag = 1;
+  for (i = 0; i < network->size; i ++)
+  {
+    SbsBaseLayer * layer = network->layer_array[i];
+    size_t positions = (size_t) layer_table[i].rows * layer_table[i].columns;
 
-      size_t inference_population_size = sizeof(NeuronState) * neurons;
+    if (layer_table[i].sampling)
+    {
+      memcpy(layer->sample_offset, sampling, positions * sizeof(uint32_t));
+      sampling += positions * sizeof(uint32_t);
+    }
+    else
+    {
+      /* Offsets of an earlier run, drawn again when needed */
+      free(layer->sample_offset);
+      layer->sample_offset = NULL;
+    }
 
-      for (column = 0; (column < columns) && good_reading_flag; column++)
-        for (row = 0; (row < rows) && good_reading_flag; row++)
-        {
-          read_result = fread (&data[column * neurons + row * columns * neurons], 1,
-              inference_population_size, file);
+    if (layer_table[i].sparse_state)
+    {
+      memcpy(layer->active_count, sparse, positions * sizeof(uint16_t));
+      sparse += positions * sizeof(uint16_t);
+      memcpy(layer->active_index, sparse, positions * layer_table[i].neurons * sizeof(uint16_t));
+      sparse += positions * layer_table[i].neurons * sizeof(uint16_t);
+      layer->sparse_state_counter = layer_table[i].sparse_state_counter;
+    }
+    else if (layer->active_count != NULL)
+      SbsBaseLayer_resetSparseState(layer);
+  }
 
-          good_reading_flag = read_result == inference_population_size;
-        }
+  SbsBaseNetwork_copyLayerData(network, (uint8_t *) buffer + data_offset, 0);
 
-      if (good_reading_flag)
-      {
-        read_result = fread(&network->input_label, 1, sizeof(uint8_t), file);
-        network->input_label --;
-        good_reading_flag = read_result == sizeof(uint8_t);
-      }
+  network->ready = header->ready;
+  network->input_label = header->input_label;
+  network->inferred_output = header->inferred_output;
+  network->cycle = header->cycle;
 
-      fclose(file);
-      ASSERT(good_reading_flag);
-    }
-#endif
-  }
+  network->context->random.mti = header->random_index;
+  for (n = 0; n < MT19937_N; n ++)
+    network->context->random.mt[n] = header->random_state[n];
+
+  return snapshot_size;
 }
 
-static void SbsBaseNetwork_updateCycle(SbsNetwork * network_ptr, uint16_t cycles)
+static void SbsBaseNetwork_autotune(SbsNetwork * network_ptr, const char * cache_file)
 {
   SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
-  uint16_t cycle;
-  char file_name[80];
+
   ASSERT(network != NULL);
-  ASSERT(3 <= network->size);
-  ASSERT(network->layer_array != NULL);
-  ASSERT(0 < cycles);
 
-  if ((network != NULL) && (3 <= network->size)
-      && (network->layer_array != NULL) && (cycles != 0))
+  if (network != NULL)
   {
     uint16_t i;
-    /* Initialize all layers except the input-layer */
-    for (i = 1; i < network->size; i++)
-    {
-      ASSERT(network->layer_array[i] != NULL);
-      SbsBaseLayer_initialize(network->layer_array[i]);
-    }
-
-    /************************ Begins Update cycle **************************/
-    for (cycle = 0; cycle < cycles; cycle ++)
-    {
-      for (i = 0; i < network->size; i++)
-      {
-        if (i < network->size - 1)
-        {
-          SbsBaseLayer_generateSpikes(network->layer_array[i]);
-
-#if defined(SAVE_SPIKES)
-          sprintf (file_name, "spike_layer[%d]_cycle[%d].csv", i, cycle);
-          Multivector_saveToCSV (network->layer_array[i]->spike_matrix, file_name);
-#endif
-        }
 
-        if (0 < i)
-          SbsBaseLayer_update(network->layer_array[i],
-              network->layer_array[i - 1]->spike_matrix);
-      }
+    free(network->autotune_cache);
+    network->autotune_cache = NULL;
 
-      if (cycle % 100 == 0)
-        printf(" - Spike cycle: %d\n", cycles);
+    if (cache_file != NULL)
+    {
+      network->autotune_cache = malloc(strlen(cache_file) + 1);
+      ASSERT(network->autotune_cache != NULL);
+      if (network->autotune_cache != NULL)
+        strcpy(network->autotune_cache, cache_file);
     }
-    /************************ Ends Update cycle ****************************/
 
-    /************************ Get inferred output **************************/
-    {
-      NeuronState max_value = 0;
-      SbsBaseLayer * output_layer = network->layer_array[network->size - 1];
-      Multivector * output_state_matrix = output_layer->state_matrix;
-      NeuronState * output_state_vector = output_state_matrix->data;
+    network->autotune = 1;
 
-      ASSERT(output_state_matrix->dimensionality == 3);
-      ASSERT(output_state_matrix->dimension_size[0] == 1);
-      ASSERT(output_state_matrix->dimension_size[1] == 1);
-      ASSERT(0 < output_state_matrix->dimension_size[2]);
+    for (i = 0; i < network->size; i ++)
+      SbsBaseNetwork_tuneLayer(network, i);
+  }
+}
 
-      for (i = 0; i < output_state_matrix->dimension_size[2]; i++)
-      {
-        NeuronState h = output_state_vector[i]; /* Ensure data alignment */
-        if (max_value < h)
-        {
-          network->inferred_output = i;
-          max_value = h;
-        }
-      }
-    }
+static uint32_t SbsBaseNetwork_getCycle(SbsNetwork * network)
+{
+  uint32_t cycle = 0;
+
+  ASSERT(network != NULL);
+  if (network != NULL)
+  {
+    cycle = ((SbsBaseNetwork *) network)->cycle;
   }
+
+  return cycle;
 }
 
 static uint8_t SbsBaseNetwork_getInferredOutput(SbsNetwork * network)
@@ -880,24 +4211,61 @@ static void SbsBaseNetwork_getOutputVector(SbsNetwork * network_ptr, NeuronState
     ASSERT(output_state_matrix->dimension_size[1] == 1);
     ASSERT(0 < output_state_matrix->dimension_size[2]);
 
-    * output_vector = output_state_matrix->data;
+    * output_vector = (network->ensemble_output != NULL) ? network->ensemble_output
+                                                         : output_state_matrix->data;
     * output_vector_size = output_state_matrix->dimension_size[2];
   }
 }
 
-static size_t SbsBaseNetwork_getMemorySize(SbsNetwork * network)
+static size_t SbsBaseNetwork_getMemoryReport(SbsNetwork * network_ptr, SbsLayerMemory * report, uint16_t size)
 {
-  return Memory_getBlockSize();
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  SbsLayerMemory   memory;
+  size_t           total = 0;
+  uint16_t         i;
+
+  ASSERT(network != NULL);
+  ASSERT((report != NULL) || (size == 0));
+
+  if (network == NULL)
+    return 0;
+
+  for (i = 0; i < network->size; i ++)
+  {
+    SbsBaseLayer * layer = network->layer_array[i];
+
+    SbsMemory_planLayer(layer, &memory);
+
+    /* Buffers past the arena */
+    memory.arena_bytes = 0;
+
+    if (layer->state_matrix->heap_data)
+      memory.heap_bytes += memory.state_bytes;
+    else
+      memory.arena_bytes += Memory_align(memory.state_bytes);
+
+    if (layer->spike_matrix->heap_data)
+      memory.heap_bytes += memory.spike_bytes;
+    else
+      memory.arena_bytes += Memory_align(memory.spike_bytes);
+
+    total += memory.arena_bytes + memory.heap_bytes;
+
+    if ((report != NULL) && (i < size))
+      report[i] = memory;
+  }
+
+  return total;
 }
 /*****************************************************************************/
 
-static SbsLayer * SbsInputLayer_new(uint16_t rows, uint16_t columns, uint16_t neurons)
+static SbsLayer * SbsInputLayer_new(uint32_t rows, uint32_t columns, uint16_t neurons)
 {
   return (SbsLayer *) SbsBaseLayer_new(rows, columns, neurons, 0, 0, ROW_SHIFT, 0);
 }
 
-static SbsLayer * SbsConvolutionLayer_new(uint16_t rows,
-                                            uint16_t columns,
+static SbsLayer * SbsConvolutionLayer_new(uint32_t rows,
+                                            uint32_t columns,
                                             uint16_t neurons,
                                             uint16_t kernel_size,
                                             WeightShift weight_shift,
@@ -907,8 +4275,8 @@ static SbsLayer * SbsConvolutionLayer_new(uint16_t rows,
                            neurons_prev_Layer);
 }
 
-static SbsLayer * SbsPoolingLayer_new(uint16_t rows,
-                                    uint16_t columns,
+static SbsLayer * SbsPoolingLayer_new(uint32_t rows,
+                                    uint32_t columns,
                                     uint16_t neurons,
                                     uint16_t kernel_size,
                                     WeightShift weight_shift,
@@ -936,89 +4304,256 @@ static SbsLayer * SbsOutputLayer_new(uint16_t neurons,
 }
 /*****************************************************************************/
 
-static SbsWeightMatrix SbsWeightMatrix_new(uint16_t rows, uint16_t columns, char * file_name)
+const SbsContext _SbsContext = {SbsBaseContext_new,
+                                SbsBaseContext_delete,
+                                SbsBaseContext_seed,
+                                SbsBaseContext_setOption,
+                                SbsBaseContext_getMemorySize};
+
+/************************ Asynchronous inference *****************************/
+/* Submitted networks queue up for a pool of worker threads shared by all the
+ * networks of the process. The pool mutex guards the queue and the async_*
+ * fields of every network */
+
+typedef enum
 {
-  Multivector * weight_watrix = NULL;
+  ASYNC_IDLE,
+  ASYNC_QUEUED,
+  ASYNC_RUNNING
+} SbsAsyncState;
 
-  ASSERT(file_name != NULL);
+#ifndef USE_XILINX
+typedef struct
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t  work_cond;  /* Workers wait for networks */
+  pthread_cond_t  done_cond;  /* wait() waits for inferences */
+  SbsNetwork *    head;
+  SbsNetwork *    tail;
+  uint8_t         workers;
+} SbsAsyncPool;
+
+static SbsAsyncPool SbsAsync_pool = { PTHREAD_MUTEX_INITIALIZER,
+                                      PTHREAD_COND_INITIALIZER,
+                                      PTHREAD_COND_INITIALIZER,
+                                      NULL, NULL, 0 };
+#endif
 
-  if (file_name != NULL)
-  {
-    weight_watrix = Multivector_new(sizeof(Weight), 2, rows, columns);
+static void SbsBaseNetwork_runAsync(SbsBaseNetwork * network)
+{
+  SbsBaseNetwork_updateCycle((SbsNetwork *) network, network->async_cycles);
 
-    ASSERT(weight_watrix != NULL);
-    ASSERT(weight_watrix->dimensionality == 2);
-    ASSERT(weight_watrix->data != NULL);
-    ASSERT(weight_watrix->dimension_size[0] == rows);
-    ASSERT(weight_watrix->dimension_size[1] == columns);
+  if (network->async_callback != NULL)
+    network->async_callback(network->async_data, (SbsNetwork *) network);
+}
 
-    if ((weight_watrix != NULL)
-        && (weight_watrix->dimensionality == 2)
-        && (weight_watrix->data != NULL)
-        && (weight_watrix->dimension_size[0] == rows)
-        && (weight_watrix->dimension_size[1] == columns))
+#ifndef USE_XILINX
+static void * SbsAsync_workerThread(void * argument)
+{
+  SbsAsyncPool *   pool = &SbsAsync_pool;
+  SbsBaseNetwork * network;
+
+  (void) argument;
+
+  pthread_mutex_lock(&pool->mutex);
+  for (;;)
+  {
+    if (pool->head == NULL)
     {
-#ifdef USE_XILINX
-      FIL fil; /* File object */
-      FRESULT rc;
-      rc = f_open (&fil, file_name, FA_READ);
-      ASSERT(rc == FR_OK);
+      pthread_cond_wait(&pool->work_cond, &pool->mutex);
+      continue;
+    }
 
-      if (rc == FR_OK)
-      {
-        size_t read_size;
-        size_t data_size = rows * columns * sizeof(Weight);
-        rc = f_read (&fil, weight_watrix->data, data_size, &read_size);
-        ASSERT((rc == FR_OK) && (read_size == data_size));
-        f_close (&fil);
-      }
-      else Multivector_delete (&weight_watrix);
+    network = (SbsBaseNetwork *) pool->head;
+    pool->head = network->async_next;
+    if (pool->head == NULL) pool->tail = NULL;
+
+    network->async_next  = NULL;
+    network->async_state = ASYNC_RUNNING;
+    pthread_mutex_unlock(&pool->mutex);
+
+    SbsBaseNetwork_runAsync(network);
+
+    pthread_mutex_lock(&pool->mutex);
+    network->async_state = ASYNC_IDLE;
+    pthread_cond_broadcast(&pool->done_cond);
+  }
+
+  return NULL;
+}
+
+/* Called with the pool mutex held. The workers live as long as the process */
+static void SbsAsync_startWorkers(SbsAsyncPool * pool)
+{
+  long           cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  pthread_attr_t attributes;
+  pthread_t      thread;
+
+  if (cpus < 1) cpus = 1;
+  if (SBS_ASYNC_WORKERS < cpus) cpus = SBS_ASYNC_WORKERS;
+
+  pthread_attr_init(&attributes);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+  for (; (pool->workers < cpus)
+         && (pthread_create(&thread, &attributes, SbsAsync_workerThread, NULL) == 0);
+       pool->workers ++);
+
+  pthread_attr_destroy(&attributes);
+}
+#endif
+
+static int SbsBaseNetwork_submit(SbsNetwork * network_ptr, uint16_t cycles,
+                                 SbsInferenceCallback callback, void * data)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  int              accepted = 0;
+
+  ASSERT(network != NULL);
+  ASSERT(0 < cycles);
+
+  if ((network == NULL) || (cycles == 0))
+    return 0;
+
+#ifdef USE_XILINX
+  network->async_cycles   = cycles;
+  network->async_callback = callback;
+  network->async_data     = data;
+  SbsBaseNetwork_runAsync(network);
+  accepted = 1;
 #else
-      FILE * file = fopen(file_name, "rb");
+  {
+    SbsAsyncPool * pool = &SbsAsync_pool;
 
-      ASSERT(file != NULL);
+    pthread_mutex_lock(&pool->mutex);
 
-      if (file != NULL)
+    if (pool->workers == 0)
+      SbsAsync_startWorkers(pool);
+
+    if (network->async_state == ASYNC_IDLE)
+    {
+      network->async_cycles   = cycles;
+      network->async_callback = callback;
+      network->async_data     = data;
+      accepted = 1;
+
+      if (pool->workers == 0)
       {
-        size_t data_size = rows * columns * sizeof(Weight);
-        size_t read_result = fread(weight_watrix->data, 1, data_size, file);
-        ASSERT(data_size == read_result);
-        fclose(file);
+        /* No thread could be started, run here */
+        network->async_state = ASYNC_RUNNING;
+        pthread_mutex_unlock(&pool->mutex);
+        SbsBaseNetwork_runAsync(network);
+        pthread_mutex_lock(&pool->mutex);
+        network->async_state = ASYNC_IDLE;
+        pthread_cond_broadcast(&pool->done_cond);
       }
       else
-        Multivector_delete(&weight_watrix);
-#endif
+      {
+        network->async_state = ASYNC_QUEUED;
+        network->async_next  = NULL;
+
+        if (pool->tail != NULL)
+          ((SbsBaseNetwork *) pool->tail)->async_next = network_ptr;
+        else
+          pool->head = network_ptr;
+        pool->tail = network_ptr;
+
+        pthread_cond_signal(&pool->work_cond);
+      }
     }
+
+    pthread_mutex_unlock(&pool->mutex);
   }
+#endif
 
-  return weight_watrix;
+  return accepted;
 }
 
-/*****************************************************************************/
+static int SbsBaseNetwork_poll(SbsNetwork * network_ptr)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+  int              idle;
+
+  ASSERT(network != NULL);
+
+  if (network == NULL)
+    return 1;
+
+#ifdef USE_XILINX
+  idle = (network->async_state == ASYNC_IDLE);
+#else
+  pthread_mutex_lock(&SbsAsync_pool.mutex);
+  idle = (network->async_state == ASYNC_IDLE);
+  pthread_mutex_unlock(&SbsAsync_pool.mutex);
+#endif
+
+  return idle;
+}
+
+static void SbsBaseNetwork_wait(SbsNetwork * network_ptr)
+{
+  SbsBaseNetwork * network = (SbsBaseNetwork *) network_ptr;
+
+  ASSERT(network != NULL);
+
+  if (network == NULL)
+    return;
+
+#ifndef USE_XILINX
+  pthread_mutex_lock(&SbsAsync_pool.mutex);
+  while (network->async_state != ASYNC_IDLE)
+    pthread_cond_wait(&SbsAsync_pool.done_cond, &SbsAsync_pool.mutex);
+  pthread_mutex_unlock(&SbsAsync_pool.mutex);
+#endif
+}
 
-SbsNetwork _SbsNetwork = {SbsBaseNetwork_new,
-                          SbsBaseNetwork_delete,
-                          SbsBaseNetwork_giveLayer,
-                          SbsBaseNetwork_loadInput,
-                          SbsBaseNetwork_updateCycle,
-                          SbsBaseNetwork_getInferredOutput,
-                          SbsBaseNetwork_getInputLabel,
-                          SbsBaseNetwork_getOutputVector,
-                          SbsBaseNetwork_getMemorySize};
-
-SbsLayer _SbsLayer = {SbsBaseLayer_new,
-                      SbsBaseLayer_delete,
-                      SbsBaseLayer_setEpsilon,
-                      SbsBaseLayer_giveWeights};
-
-SbsNew sbs_new = {SbsBaseNetwork_new,
+const SbsNetwork _SbsNetwork = {SbsBaseNetwork_new,
+                                SbsBaseNetwork_delete,
+                                SbsBaseNetwork_giveLayer,
+                                SbsBaseNetwork_loadInput,
+                                SbsBaseNetwork_updateCycle,
+                                SbsBaseNetwork_getInferredOutput,
+                                SbsBaseNetwork_getInputLabel,
+                                SbsBaseNetwork_getOutputVector,
+                                SbsBaseNetwork_getMemoryReport,
+                                SbsBaseNetwork_reset,
+                                SbsBaseNetwork_step,
+                                SbsBaseNetwork_getCycle,
+                                SbsBaseNetwork_setWarmStart,
+                                SbsBaseNetwork_loadInputBuffer,
+                                SbsBaseNetwork_setSpikeTrace,
+                                SbsBaseNetwork_setTelemetry,
+                                SbsBaseNetwork_getTelemetry,
+                                SbsBaseNetwork_getTelemetryJSON,
+                                SbsBaseNetwork_setPhaseHook,
+                                SbsBaseNetwork_checkpoint,
+                                SbsBaseNetwork_restore,
+                                SbsBaseNetwork_autotune,
+                                SbsBaseNetwork_setEnsemble,
+                                SbsBaseNetwork_setAccelerator,
+                                SbsBaseNetwork_submit,
+                                SbsBaseNetwork_poll,
+                                SbsBaseNetwork_wait};
+
+const SbsLayer _SbsLayer = {SbsBaseLayer_new,
+                            SbsBaseLayer_delete,
+                            SbsBaseLayer_setEpsilon,
+                            SbsBaseLayer_giveWeights,
+                            SbsBaseLayer_pruneWeights,
+                            SbsBaseLayer_setUpdateOrder,
+                            SbsBaseLayer_setSparseState,
+                            SbsBaseLayer_setStateLayout};
+
+SbsNew sbs_new = {SbsBaseContext_new,
+                  SbsBaseNetwork_new,
                   SbsBaseLayer_new,
                   SbsWeightMatrix_new,
                   SbsInputLayer_new,
                   SbsConvolutionLayer_new,
                   SbsPoolingLayer_new,
                   SbsFullyConnectedLayer_new,
-                  SbsOutputLayer_new};
+                  SbsOutputLayer_new,
+                  SbsMemory_plan};
 
 
 /*****************************************************************************/
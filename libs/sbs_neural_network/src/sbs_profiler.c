@@ -0,0 +1,435 @@
+/*
+ * sbs_profiler.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+
+#include "sbs_profiler.h"
+
+#if defined(__linux__) && !defined(USE_XILINX)
+#define SBS_PROFILER_PERF
+#include "time.h"
+#include "unistd.h"
+#include "sys/syscall.h"
+#include "linux/perf_event.h"
+#if defined (__x86_64__) || defined(__amd64__)
+#include "cpuid.h"
+#endif
+#endif
+
+#define ASSERT(expr)  assert(expr)
+
+#define SBS_PROFILER_GROUPS 2   /* Core events, FP events */
+#define SBS_PROFILER_PHASES 2
+#define SBS_PROFILER_LINE   64  /* Bytes moved per last level miss */
+
+/*****************************************************************************/
+
+typedef struct
+{
+  uint64_t calls;
+  double   time;
+  uint64_t count[PROFILER_EVENTS];
+  uint64_t enabled[SBS_PROFILER_GROUPS];
+  uint64_t running[SBS_PROFILER_GROUPS];
+} SbsProfilerSample;
+
+struct SbsProfiler
+{
+  uint16_t            layers;
+  uint32_t            range_cycles;
+  uint16_t            ranges;
+  uint32_t            events;
+
+  int                 leader[SBS_PROFILER_GROUPS];
+  uint8_t             group_size[SBS_PROFILER_GROUPS];
+  SbsProfilerEvent    group_event[SBS_PROFILER_GROUPS][PROFILER_EVENTS];
+  int                 fd[PROFILER_EVENTS];
+
+  uint64_t            begin[SBS_PROFILER_GROUPS][3 + PROFILER_EVENTS];
+  double              begin_time;
+
+  SbsProfilerSample * sample;  /* [layers][phases][ranges] */
+};
+
+/*****************************************************************************/
+
+static double SbsProfiler_now(void)
+{
+#ifdef SBS_PROFILER_PERF
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+#else
+  return 0.0;
+#endif
+}
+
+#ifdef SBS_PROFILER_PERF
+static int SbsProfiler_isIntel(void)
+{
+#if defined (__x86_64__) || defined(__amd64__)
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid(0, &eax, &ebx, &ecx, &edx)
+      && (ebx == 0x756E6547) && (edx == 0x49656E69) && (ecx == 0x6C65746E); /* GenuineIntel */
+#else
+  return 0;
+#endif
+}
+
+static int SbsProfiler_open(SbsProfilerEvent event, int group_fd)
+{
+  struct perf_event_attr attribute;
+
+  memset(&attribute, 0x00, sizeof(attribute));
+  attribute.size = sizeof(attribute);
+  attribute.exclude_kernel = 1;
+  attribute.exclude_hv = 1;
+  attribute.read_format = PERF_FORMAT_GROUP
+                        | PERF_FORMAT_TOTAL_TIME_ENABLED
+                        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  switch (event)
+  {
+    case PROFILER_CYCLES:
+      attribute.type = PERF_TYPE_HARDWARE;
+      attribute.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PROFILER_INSTRUCTIONS:
+      attribute.type = PERF_TYPE_HARDWARE;
+      attribute.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PROFILER_CACHE_REFERENCES:
+      attribute.type = PERF_TYPE_HARDWARE;
+      attribute.config = PERF_COUNT_HW_CACHE_REFERENCES;
+      break;
+    case PROFILER_CACHE_MISSES:
+      attribute.type = PERF_TYPE_HARDWARE;
+      attribute.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case PROFILER_L1D_MISSES:
+      attribute.type = PERF_TYPE_HW_CACHE;
+      attribute.config = PERF_COUNT_HW_CACHE_L1D
+                       | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                       | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case PROFILER_BRANCH_MISSES:
+      attribute.type = PERF_TYPE_HARDWARE;
+      attribute.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    default:
+      /* FP_ARITH_INST_RETIRED (event 0xC7), single precision umasks */
+      if (!SbsProfiler_isIntel()) return -1;
+      attribute.type = PERF_TYPE_RAW;
+      attribute.config = 0xC7 | ((event == PROFILER_FP_SCALAR) ? 0x0200 :
+                                 (event == PROFILER_FP_128)    ? 0x0800 :
+                                 (event == PROFILER_FP_256)    ? 0x2000 : 0x8000);
+      break;
+  }
+
+  return (int) syscall(__NR_perf_event_open, &attribute, 0, -1, group_fd, 0);
+}
+
+static int SbsProfiler_read(SbsProfiler * profiler, uint8_t group, uint64_t * value)
+{
+  size_t size = (3 + profiler->group_size[group]) * sizeof(uint64_t);
+
+  return (profiler->leader[group] != -1)
+      && (read(profiler->leader[group], value, size) == (ssize_t) size);
+}
+#endif
+
+static void SbsProfiler_hook(void * data, uint16_t layer, SbsPhase phase, uint8_t end, uint32_t cycle)
+{
+  SbsProfiler * profiler = data;
+
+  if ((profiler == NULL) || (profiler->layers <= layer))
+    return;
+
+  if (!end)
+  {
+#ifdef SBS_PROFILER_PERF
+    uint8_t group;
+    for (group = 0; group < SBS_PROFILER_GROUPS; group ++)
+      SbsProfiler_read(profiler, group, profiler->begin[group]);
+#endif
+    profiler->begin_time = SbsProfiler_now();
+  }
+  else
+  {
+    uint16_t range = cycle / profiler->range_cycles;
+    SbsProfilerSample * sample;
+
+    if (profiler->ranges <= range) range = profiler->ranges - 1;
+
+    sample = &profiler->sample[((size_t) layer * SBS_PROFILER_PHASES + phase) * profiler->ranges + range];
+    sample->time += SbsProfiler_now() - profiler->begin_time;
+    sample->calls ++;
+
+#ifdef SBS_PROFILER_PERF
+    {
+      uint64_t value[3 + PROFILER_EVENTS];
+      uint8_t  group;
+      uint8_t  i;
+
+      for (group = 0; group < SBS_PROFILER_GROUPS; group ++)
+        if (SbsProfiler_read(profiler, group, value))
+        {
+          sample->enabled[group] += value[1] - profiler->begin[group][1];
+          sample->running[group] += value[2] - profiler->begin[group][2];
+
+          for (i = 0; i < profiler->group_size[group]; i ++)
+            sample->count[profiler->group_event[group][i]] += value[3 + i] - profiler->begin[group][3 + i];
+        }
+    }
+#endif
+  }
+}
+
+/*****************************************************************************/
+
+SbsProfiler * SbsProfiler_new(uint16_t layers, uint32_t range_cycles, uint16_t ranges)
+{
+  SbsProfiler * profiler = NULL;
+
+  ASSERT(0 < layers);
+  ASSERT(0 < range_cycles);
+  ASSERT(0 < ranges);
+
+  if ((0 < layers) && (0 < range_cycles) && (0 < ranges))
+    profiler = calloc(1, sizeof(SbsProfiler));
+
+  ASSERT(profiler != NULL);
+
+  if (profiler != NULL)
+  {
+    uint8_t group;
+    int     event;
+
+    profiler->layers = layers;
+    profiler->range_cycles = range_cycles;
+    profiler->ranges = ranges;
+    profiler->sample = calloc((size_t) layers * SBS_PROFILER_PHASES * ranges, sizeof(SbsProfilerSample));
+
+    for (event = 0; event < PROFILER_EVENTS; event ++)
+      profiler->fd[event] = -1;
+
+    for (group = 0; group < SBS_PROFILER_GROUPS; group ++)
+      profiler->leader[group] = -1;
+
+#ifdef SBS_PROFILER_PERF
+    for (event = 0; event < PROFILER_EVENTS; event ++)
+    {
+      group = (event < PROFILER_FP_SCALAR) ? 0 : 1;
+
+      /* The first event that opens leads its group */
+      profiler->fd[event] = SbsProfiler_open(event, profiler->leader[group]);
+
+      if (profiler->fd[event] != -1)
+      {
+        if (profiler->leader[group] == -1)
+          profiler->leader[group] = profiler->fd[event];
+
+        profiler->group_event[group][profiler->group_size[group] ++] = event;
+        profiler->events |= 1u << event;
+      }
+    }
+#endif
+
+    ASSERT(profiler->sample != NULL);
+
+    if (profiler->sample == NULL)
+      SbsProfiler_delete(&profiler);
+  }
+
+  return profiler;
+}
+
+void SbsProfiler_delete(SbsProfiler ** profiler)
+{
+  ASSERT(profiler != NULL);
+  ASSERT(*profiler != NULL);
+
+  if ((profiler != NULL) && (*profiler != NULL))
+  {
+#ifdef SBS_PROFILER_PERF
+    int event;
+
+    /* Members before their leaders */
+    for (event = PROFILER_EVENTS - 1; 0 <= event; event --)
+      if ((*profiler)->fd[event] != -1)
+        close((*profiler)->fd[event]);
+#endif
+
+    free((*profiler)->sample);
+    free(*profiler);
+    *profiler = NULL;
+  }
+}
+
+void SbsProfiler_attach(SbsProfiler * profiler, SbsNetwork * network)
+{
+  ASSERT(network != NULL);
+
+  if (network != NULL)
+    network->setPhaseHook(network, (profiler != NULL) ? SbsProfiler_hook : NULL, profiler);
+}
+
+void SbsProfiler_reset(SbsProfiler * profiler)
+{
+  ASSERT(profiler != NULL);
+
+  if (profiler != NULL)
+    memset(profiler->sample, 0x00,
+           (size_t) profiler->layers * SBS_PROFILER_PHASES * profiler->ranges * sizeof(SbsProfilerSample));
+}
+
+uint32_t SbsProfiler_getEvents(SbsProfiler * profiler)
+{
+  return (profiler != NULL) ? profiler->events : 0;
+}
+
+/* Sums the ranges [first, last] of a layer phase, with counts scaled up when
+ * the kernel multiplexed the groups */
+static void SbsProfiler_sum(SbsProfiler * profiler, uint16_t layer, SbsPhase phase,
+                            uint16_t first, uint16_t last, double * count,
+                            uint64_t * calls, double * time)
+{
+  SbsProfilerSample * sample = &profiler->sample[((size_t) layer * SBS_PROFILER_PHASES + phase) * profiler->ranges];
+  uint64_t enabled[SBS_PROFILER_GROUPS] = { 0 };
+  uint64_t running[SBS_PROFILER_GROUPS] = { 0 };
+  uint16_t range;
+  int      event;
+
+  memset(count, 0x00, PROFILER_EVENTS * sizeof(double));
+  *calls = 0;
+  *time = 0.0;
+
+  for (range = first; range <= last; range ++)
+  {
+    *calls += sample[range].calls;
+    *time += sample[range].time;
+
+    for (event = 0; event < PROFILER_EVENTS; event ++)
+      count[event] += sample[range].count[event];
+
+    for (event = 0; event < SBS_PROFILER_GROUPS; event ++)
+    {
+      enabled[event] += sample[range].enabled[event];
+      running[event] += sample[range].running[event];
+    }
+  }
+
+  for (event = 0; event < PROFILER_EVENTS; event ++)
+  {
+    uint8_t group = (event < PROFILER_FP_SCALAR) ? 0 : 1;
+    if ((0 < running[group]) && (running[group] < enabled[group]))
+      count[event] *= (double) enabled[group] / running[group];
+  }
+}
+
+uint64_t SbsProfiler_getCount(SbsProfiler * profiler, uint16_t layer, SbsPhase phase,
+                              SbsProfilerEvent event)
+{
+  double   count[PROFILER_EVENTS];
+  uint64_t calls;
+  double   time;
+
+  ASSERT(profiler != NULL);
+  ASSERT((profiler == NULL) || (layer < profiler->layers));
+  ASSERT(event < PROFILER_EVENTS);
+
+  if ((profiler == NULL) || (profiler->layers <= layer) || (PROFILER_EVENTS <= event))
+    return 0;
+
+  SbsProfiler_sum(profiler, layer, phase, 0, profiler->ranges - 1, count, &calls, &time);
+
+  return (uint64_t) count[event];
+}
+
+static double SbsProfiler_ratio(double numerator, double denominator)
+{
+  return (0.0 < denominator) ? numerator / denominator : 0.0;
+}
+
+void SbsProfiler_print(SbsProfiler * profiler)
+{
+  static const char * phase_name[SBS_PROFILER_PHASES] = { "generate", "update" };
+  double   count[PROFILER_EVENTS];
+  uint64_t calls;
+  double   time;
+  uint32_t events;
+  uint16_t layer;
+  uint8_t  phase;
+  uint16_t range;
+
+  ASSERT(profiler != NULL);
+  if (profiler == NULL) return;
+
+  events = profiler->events;
+
+  if (!(events & (1u << PROFILER_CYCLES)))
+    printf("\n Hardware counters unavailable (check perf_event_paranoid), wall time only\n");
+  else if (!(events & (1u << PROFILER_FP_SCALAR)))
+    printf("\n FP counters unavailable, FLOP columns left empty\n");
+
+  printf("\n layer  phase      calls   time ms    IPC  L1D miss/ki  LLC miss%%  br miss/ki"
+         "  GFLOP/s  vector%%  FLOP/B\n");
+
+  for (layer = 0; layer < profiler->layers; layer ++)
+    for (phase = 0; phase < SBS_PROFILER_PHASES; phase ++)
+    {
+      double flops;
+      double vector;
+
+      SbsProfiler_sum(profiler, layer, phase, 0, profiler->ranges - 1, count, &calls, &time);
+
+      if (calls == 0) continue;
+
+      vector = 4.0 * count[PROFILER_FP_128] + 8.0 * count[PROFILER_FP_256]
+             + 16.0 * count[PROFILER_FP_512];
+      flops = count[PROFILER_FP_SCALAR] + vector;
+
+      printf(" %5d  %-8s %7llu  %8.1f", layer, phase_name[phase], (unsigned long long) calls, 1e3 * time);
+
+      if (events & (1u << PROFILER_CYCLES))
+        printf("  %5.2f  %11.2f  %8.2f%%  %10.2f",
+               SbsProfiler_ratio(count[PROFILER_INSTRUCTIONS], count[PROFILER_CYCLES]),
+               SbsProfiler_ratio(1e3 * count[PROFILER_L1D_MISSES], count[PROFILER_INSTRUCTIONS]),
+               SbsProfiler_ratio(100.0 * count[PROFILER_CACHE_MISSES], count[PROFILER_CACHE_REFERENCES]),
+               SbsProfiler_ratio(1e3 * count[PROFILER_BRANCH_MISSES], count[PROFILER_INSTRUCTIONS]));
+
+      if (events & (1u << PROFILER_FP_SCALAR))
+        printf("  %7.2f  %6.1f%%  %6.2f",
+               SbsProfiler_ratio(flops * 1e-9, time),
+               SbsProfiler_ratio(100.0 * vector, flops),
+               SbsProfiler_ratio(flops, SBS_PROFILER_LINE * count[PROFILER_CACHE_MISSES]));
+
+      printf("\n");
+    }
+
+  if ((events & (1u << PROFILER_CYCLES)) && (1 < profiler->ranges))
+  {
+    printf("\n IPC of the update phase per range of %u cycles\n range ", profiler->range_cycles);
+    for (layer = 1; layer < profiler->layers; layer ++)
+      printf("  layer %d", layer);
+    printf("\n");
+
+    for (range = 0; range < profiler->ranges; range ++)
+    {
+      printf(" %5u ", range);
+      for (layer = 1; layer < profiler->layers; layer ++)
+      {
+        SbsProfiler_sum(profiler, layer, PHASE_UPDATE, range, range, count, &calls, &time);
+        printf("  %7.2f", SbsProfiler_ratio(count[PROFILER_INSTRUCTIONS], count[PROFILER_CYCLES]));
+      }
+      printf("\n");
+    }
+  }
+}
@@ -0,0 +1,673 @@
+/*
+ * sbs_spike_trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "assert.h"
+
+#include "sbs_spike_trace.h"
+
+#ifdef USE_XILINX
+#include "ff.h"
+#else
+#include "pthread.h"
+#endif
+
+#define ASSERT(expr)  assert(expr)
+
+#define SBS_SPIKE_TRACE_LAYERS 32 /* Bits of the layer mask */
+
+/*****************************************************************************/
+
+struct SbsSpikeTrace
+{
+#ifdef USE_XILINX
+  FIL             file;
+#else
+  FILE *          file;
+  pthread_t       flusher;
+  pthread_mutex_t mutex;
+  pthread_cond_t  data_cond;   /* The flusher waits for records */
+  pthread_cond_t  space_cond;  /* The recorder waits for the flusher */
+  uint8_t         stop;
+#endif
+  uint8_t *       buffer;      /* Ring buffer */
+  size_t          buffer_size;
+  size_t          head;        /* Next byte to write */
+  size_t          tail;        /* Next byte to flush */
+  size_t          used;
+
+  SbsSpikeTraceEncoding encoding;
+  uint8_t *       scratch;     /* Encoded record */
+  size_t          scratch_size;
+  uint16_t *      previous[SBS_SPIKE_TRACE_LAYERS]; /* Last record per layer, TRACE_DELTA */
+  size_t          previous_size[SBS_SPIKE_TRACE_LAYERS];
+
+  uint32_t        layer_mask;
+  uint32_t        first_cycle;
+  uint32_t        last_cycle;
+  uint32_t        stride;
+
+  SbsSpikeTraceStatistics statistics;
+};
+
+/*****************************************************************************/
+
+static int SbsSpikeTrace_write(SbsSpikeTrace * trace, const void * data, size_t size)
+{
+#ifdef USE_XILINX
+  UINT written = 0;
+  f_write(&trace->file, data, size, &written);
+  return written == size;
+#else
+  return fwrite(data, 1, size, trace->file) == size;
+#endif
+}
+
+/* Writes out the bytes between tail and head; the mutex is released meanwhile,
+ * the recorder only fills the free part of the ring */
+static void SbsSpikeTrace_drain(SbsSpikeTrace * trace)
+{
+  size_t size = trace->used;
+  size_t first = trace->buffer_size - trace->tail;
+
+  if (size < first) first = size;
+
+#ifndef USE_XILINX
+  pthread_mutex_unlock(&trace->mutex);
+#endif
+
+  SbsSpikeTrace_write(trace, &trace->buffer[trace->tail], first);
+  if (first < size)
+    SbsSpikeTrace_write(trace, trace->buffer, size - first);
+
+#ifndef USE_XILINX
+  pthread_mutex_lock(&trace->mutex);
+#endif
+
+  trace->tail = (trace->tail + size) % trace->buffer_size;
+  trace->used -= size;
+  trace->statistics.written_size += size;
+}
+
+#ifndef USE_XILINX
+static void * SbsSpikeTrace_flusherThread(void * argument)
+{
+  SbsSpikeTrace * trace = argument;
+
+  pthread_mutex_lock(&trace->mutex);
+  while (!trace->stop || trace->used)
+  {
+    if (trace->used)
+    {
+      SbsSpikeTrace_drain(trace);
+      pthread_cond_broadcast(&trace->space_cond);
+    }
+    else
+      pthread_cond_wait(&trace->data_cond, &trace->mutex);
+  }
+  pthread_mutex_unlock(&trace->mutex);
+
+  return NULL;
+}
+#endif
+
+static void SbsSpikeTrace_push(SbsSpikeTrace * trace, const void * data, size_t size)
+{
+  const uint8_t * source = data;
+  size_t first;
+
+#ifndef USE_XILINX
+  pthread_mutex_lock(&trace->mutex);
+#endif
+
+  if (trace->buffer_size - trace->used < size)
+  {
+    trace->statistics.stalls ++;
+#ifdef USE_XILINX
+    SbsSpikeTrace_drain(trace);
+#else
+    pthread_cond_signal(&trace->data_cond);
+    while (trace->used && (trace->buffer_size - trace->used < size))
+      pthread_cond_wait(&trace->space_cond, &trace->mutex);
+#endif
+  }
+
+  if (trace->buffer_size < size)
+  {
+    /* Larger than the whole ring, the ring is empty by now */
+    SbsSpikeTrace_write(trace, data, size);
+    trace->statistics.written_size += size;
+  }
+  else
+  {
+    first = trace->buffer_size - trace->head;
+    if (size < first) first = size;
+
+    memcpy(&trace->buffer[trace->head], source, first);
+    memcpy(trace->buffer, source + first, size - first);
+
+    trace->head = (trace->head + size) % trace->buffer_size;
+    trace->used += size;
+  }
+
+#ifndef USE_XILINX
+  /* Wake the flusher at half capacity to keep room for the recorder */
+  if (trace->buffer_size / 2 <= trace->used)
+    pthread_cond_signal(&trace->data_cond);
+
+  pthread_mutex_unlock(&trace->mutex);
+#endif
+}
+
+/*****************************************************************************/
+
+static size_t SbsSpikeTrace_encodeDelta(uint8_t * output,
+                                        const uint16_t * spike,
+                                        uint16_t * previous,
+                                        size_t count)
+{
+  uint8_t * start = output;
+  size_t i;
+
+  for (i = 0; i < count; i ++)
+  {
+    int32_t  delta = (int32_t) spike[i] - (int32_t) previous[i];
+    uint32_t value = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+
+    while (0x80 <= value)
+    {
+      *output++ = (uint8_t) (value | 0x80);
+      value >>= 7;
+    }
+    *output++ = (uint8_t) value;
+
+    previous[i] = spike[i];
+  }
+
+  return output - start;
+}
+
+static size_t SbsSpikeTrace_encodePacked(uint8_t * output, const uint16_t * spike, size_t count)
+{
+  uint8_t * start = output;
+  uint16_t  maximum = 0;
+  uint8_t   bits = 0;
+  uint32_t  accumulator = 0;
+  uint8_t   accumulated = 0;
+  size_t    i;
+
+  for (i = 0; i < count; i ++)
+    if (maximum < spike[i]) maximum = spike[i];
+
+  while (maximum >> bits) bits ++;
+
+  *output++ = bits;
+
+  for (i = 0; (0 < bits) && (i < count); i ++)
+  {
+    accumulator |= (uint32_t) spike[i] << accumulated;
+    accumulated += bits;
+
+    while (8 <= accumulated)
+    {
+      *output++ = (uint8_t) accumulator;
+      accumulator >>= 8;
+      accumulated -= 8;
+    }
+  }
+
+  if (accumulated)
+    *output++ = (uint8_t) accumulator;
+
+  return output - start;
+}
+
+static uint16_t * SbsSpikeTrace_previous(uint16_t ** previous, size_t * previous_size, size_t count)
+{
+  /* A layer changing shape starts over from zeros */
+  if (*previous_size != count)
+  {
+    free(*previous);
+    *previous = calloc(count, sizeof(uint16_t));
+    *previous_size = (*previous != NULL) ? count : 0;
+  }
+
+  return *previous;
+}
+
+/*****************************************************************************/
+
+SbsSpikeTrace * SbsSpikeTrace_new(const char * file_name,
+                                  size_t buffer_size,
+                                  SbsSpikeTraceEncoding encoding)
+{
+  SbsSpikeTrace * trace = NULL;
+  SbsSpikeTraceHeader header = { SBS_SPIKE_TRACE_MAGIC, SBS_SPIKE_TRACE_VERSION, 0 };
+  int opened;
+
+  ASSERT(file_name != NULL);
+  ASSERT(0 < buffer_size);
+  ASSERT(encoding <= TRACE_PACKED);
+
+  if ((file_name != NULL) && (0 < buffer_size) && (encoding <= TRACE_PACKED))
+    trace = calloc(1, sizeof(SbsSpikeTrace));
+
+  ASSERT(trace != NULL);
+
+  if (trace != NULL)
+  {
+    trace->buffer = malloc(buffer_size);
+    trace->buffer_size = buffer_size;
+    trace->encoding = encoding;
+    trace->layer_mask = (uint32_t) -1;
+    trace->last_cycle = (uint32_t) -1;
+    trace->stride = 1;
+
+#ifdef USE_XILINX
+    opened = (f_open(&trace->file, file_name, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK);
+#else
+    trace->file = fopen(file_name, "wb");
+    opened = (trace->file != NULL);
+#endif
+
+    ASSERT(opened);
+    ASSERT(trace->buffer != NULL);
+
+    if (opened && (trace->buffer != NULL))
+    {
+      SbsSpikeTrace_write(trace, &header, sizeof(header));
+      trace->statistics.written_size = sizeof(header);
+#ifndef USE_XILINX
+      pthread_mutex_init(&trace->mutex, NULL);
+      pthread_cond_init(&trace->data_cond, NULL);
+      pthread_cond_init(&trace->space_cond, NULL);
+
+      opened = (pthread_create(&trace->flusher, NULL, SbsSpikeTrace_flusherThread, trace) == 0);
+      ASSERT(opened);
+
+      if (!opened)
+      {
+        pthread_mutex_destroy(&trace->mutex);
+        pthread_cond_destroy(&trace->data_cond);
+        pthread_cond_destroy(&trace->space_cond);
+      }
+#endif
+    }
+
+    if (!opened || (trace->buffer == NULL))
+    {
+#ifdef USE_XILINX
+      if (opened) f_close(&trace->file);
+#else
+      if (trace->file != NULL) fclose(trace->file);
+#endif
+      free(trace->buffer);
+      free(trace);
+      trace = NULL;
+    }
+  }
+
+  return trace;
+}
+
+void SbsSpikeTrace_delete(SbsSpikeTrace ** trace_ptr)
+{
+  ASSERT(trace_ptr != NULL);
+  ASSERT(*trace_ptr != NULL);
+
+  if ((trace_ptr != NULL) && (*trace_ptr != NULL))
+  {
+    SbsSpikeTrace * trace = *trace_ptr;
+    int i;
+
+#ifdef USE_XILINX
+    SbsSpikeTrace_drain(trace);
+    f_close(&trace->file);
+#else
+    pthread_mutex_lock(&trace->mutex);
+    trace->stop = 1;
+    pthread_cond_signal(&trace->data_cond);
+    pthread_mutex_unlock(&trace->mutex);
+
+    pthread_join(trace->flusher, NULL);
+
+    pthread_mutex_destroy(&trace->mutex);
+    pthread_cond_destroy(&trace->data_cond);
+    pthread_cond_destroy(&trace->space_cond);
+
+    fclose(trace->file);
+#endif
+
+    for (i = 0; i < SBS_SPIKE_TRACE_LAYERS; i ++)
+      free(trace->previous[i]);
+
+    free(trace->scratch);
+    free(trace->buffer);
+    free(trace);
+
+    *trace_ptr = NULL;
+  }
+}
+
+void SbsSpikeTrace_setFilter(SbsSpikeTrace * trace,
+                             uint32_t layer_mask,
+                             uint32_t first_cycle,
+                             uint32_t last_cycle,
+                             uint32_t stride)
+{
+  ASSERT(trace != NULL);
+  ASSERT(first_cycle <= last_cycle);
+  ASSERT(0 < stride);
+
+  if ((trace != NULL) && (first_cycle <= last_cycle) && (0 < stride))
+  {
+    trace->layer_mask = layer_mask;
+    trace->first_cycle = first_cycle;
+    trace->last_cycle = last_cycle;
+    trace->stride = stride;
+  }
+}
+
+int SbsSpikeTrace_isSampled(SbsSpikeTrace * trace, uint16_t layer, uint32_t cycle)
+{
+  return (trace != NULL)
+      && (layer < SBS_SPIKE_TRACE_LAYERS)
+      && ((trace->layer_mask >> layer) & 1)
+      && (trace->first_cycle <= cycle) && (cycle <= trace->last_cycle)
+      && ((cycle - trace->first_cycle) % trace->stride == 0);
+}
+
+void SbsSpikeTrace_record(SbsSpikeTrace * trace,
+                          uint16_t layer,
+                          uint32_t cycle,
+                          const uint16_t * spike,
+                          uint32_t rows,
+                          uint32_t columns)
+{
+  ASSERT(trace != NULL);
+  ASSERT(spike != NULL);
+
+  if ((trace != NULL) && (spike != NULL) && SbsSpikeTrace_isSampled(trace, layer, cycle))
+  {
+    size_t count = (size_t) rows * columns;
+    size_t scratch_size = sizeof(SbsSpikeTraceRecord) + 3 * count + 1; /* Worst case: 3-byte varints */
+    SbsSpikeTraceRecord * record;
+    uint8_t * payload;
+    uint16_t * previous;
+
+    if (trace->scratch_size < scratch_size)
+    {
+      free(trace->scratch);
+      trace->scratch = malloc(scratch_size);
+      trace->scratch_size = (trace->scratch != NULL) ? scratch_size : 0;
+    }
+
+    ASSERT(trace->scratch != NULL);
+    if (trace->scratch == NULL) return;
+
+    record = (SbsSpikeTraceRecord *) trace->scratch;
+    payload = trace->scratch + sizeof(SbsSpikeTraceRecord);
+
+    record->layer = layer;
+    record->encoding = trace->encoding;
+    record->reserved = 0;
+    record->rows = rows;
+    record->columns = columns;
+    record->cycle = cycle;
+
+    switch (trace->encoding)
+    {
+      case TRACE_DELTA:
+        previous = SbsSpikeTrace_previous(&trace->previous[layer], &trace->previous_size[layer], count);
+        if (previous != NULL)
+        {
+          record->size = SbsSpikeTrace_encodeDelta(payload, spike, previous, count);
+          break;
+        }
+        /* Without a previous record it is stored raw */
+        /* falls through */
+      case TRACE_RAW:
+        record->encoding = TRACE_RAW;
+        record->size = count * sizeof(uint16_t);
+        memcpy(payload, spike, record->size);
+        break;
+      case TRACE_PACKED:
+        record->size = SbsSpikeTrace_encodePacked(payload, spike, count);
+        break;
+    }
+
+    SbsSpikeTrace_push(trace, trace->scratch, sizeof(SbsSpikeTraceRecord) + record->size);
+
+    trace->statistics.records ++;
+    trace->statistics.raw_size += sizeof(SbsSpikeTraceRecord) + count * sizeof(uint16_t);
+  }
+}
+
+void SbsSpikeTrace_flush(SbsSpikeTrace * trace)
+{
+  ASSERT(trace != NULL);
+
+  if (trace != NULL)
+  {
+#ifdef USE_XILINX
+    SbsSpikeTrace_drain(trace);
+    f_sync(&trace->file);
+#else
+    pthread_mutex_lock(&trace->mutex);
+    pthread_cond_signal(&trace->data_cond);
+    while (trace->used)
+      pthread_cond_wait(&trace->space_cond, &trace->mutex);
+    fflush(trace->file);
+    pthread_mutex_unlock(&trace->mutex);
+#endif
+  }
+}
+
+void SbsSpikeTrace_getStatistics(SbsSpikeTrace * trace, SbsSpikeTraceStatistics * statistics)
+{
+  ASSERT(trace != NULL);
+  ASSERT(statistics != NULL);
+
+  if ((trace != NULL) && (statistics != NULL))
+  {
+#ifndef USE_XILINX
+    pthread_mutex_lock(&trace->mutex);
+#endif
+    *statistics = trace->statistics;
+#ifndef USE_XILINX
+    pthread_mutex_unlock(&trace->mutex);
+#endif
+  }
+}
+
+/*****************************************************************************/
+#ifndef USE_XILINX
+
+struct SbsSpikeTraceReader
+{
+  FILE *     file;
+  uint8_t *  payload;
+  size_t     payload_size;
+  uint16_t * spike;
+  size_t     spike_size;
+  uint16_t * previous[SBS_SPIKE_TRACE_LAYERS];
+  size_t     previous_size[SBS_SPIKE_TRACE_LAYERS];
+};
+
+static int SbsSpikeTrace_decodeDelta(const uint8_t * input, size_t size,
+                                     uint16_t * spike, uint16_t * previous, size_t count)
+{
+  const uint8_t * end = input + size;
+  size_t i;
+
+  for (i = 0; i < count; i ++)
+  {
+    uint32_t value = 0;
+    uint8_t  shift = 0;
+    int32_t  delta;
+
+    do
+    {
+      if ((end <= input) || (28 < shift)) return 0;
+      value |= (uint32_t) (*input & 0x7F) << shift;
+      shift += 7;
+    } while (*input++ & 0x80);
+
+    delta = (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+    spike[i] = previous[i] = (uint16_t) (previous[i] + delta);
+  }
+
+  return input == end;
+}
+
+static int SbsSpikeTrace_decodePacked(const uint8_t * input, size_t size,
+                                      uint16_t * spike, size_t count)
+{
+  const uint8_t * end = input + size;
+  uint32_t accumulator = 0;
+  uint8_t  accumulated = 0;
+  uint8_t  bits;
+  size_t   i;
+
+  if (size < 1) return 0;
+
+  bits = *input++;
+  if (16 < bits) return 0;
+
+  for (i = 0; i < count; i ++)
+  {
+    while (accumulated < bits)
+    {
+      if (end <= input) return 0;
+      accumulator |= (uint32_t) *input++ << accumulated;
+      accumulated += 8;
+    }
+
+    spike[i] = (uint16_t) (accumulator & ((1u << bits) - 1));
+    accumulator >>= bits;
+    accumulated -= bits;
+  }
+
+  return input == end;
+}
+
+SbsSpikeTraceReader * SbsSpikeTraceReader_new(const char * file_name)
+{
+  SbsSpikeTraceReader * reader = NULL;
+  SbsSpikeTraceHeader header;
+  FILE * file;
+
+  ASSERT(file_name != NULL);
+
+  file = (file_name != NULL) ? fopen(file_name, "rb") : NULL;
+
+  if (file != NULL)
+  {
+    if ((fread(&header, sizeof(header), 1, file) == 1)
+        && (header.magic == SBS_SPIKE_TRACE_MAGIC)
+        && (header.version == SBS_SPIKE_TRACE_VERSION))
+      reader = calloc(1, sizeof(SbsSpikeTraceReader));
+
+    if (reader != NULL)
+      reader->file = file;
+    else
+      fclose(file);
+  }
+
+  return reader;
+}
+
+void SbsSpikeTraceReader_delete(SbsSpikeTraceReader ** reader_ptr)
+{
+  ASSERT(reader_ptr != NULL);
+  ASSERT(*reader_ptr != NULL);
+
+  if ((reader_ptr != NULL) && (*reader_ptr != NULL))
+  {
+    SbsSpikeTraceReader * reader = *reader_ptr;
+    int i;
+
+    for (i = 0; i < SBS_SPIKE_TRACE_LAYERS; i ++)
+      free(reader->previous[i]);
+
+    fclose(reader->file);
+    free(reader->payload);
+    free(reader->spike);
+    free(reader);
+
+    *reader_ptr = NULL;
+  }
+}
+
+int SbsSpikeTraceReader_next(SbsSpikeTraceReader * reader,
+                             SbsSpikeTraceRecord * record,
+                             const uint16_t ** spike)
+{
+  size_t count;
+  int    decoded = 0;
+
+  ASSERT(reader != NULL);
+  ASSERT(record != NULL);
+  ASSERT(spike != NULL);
+
+  if ((reader == NULL) || (record == NULL) || (spike == NULL)
+      || (fread(record, sizeof(SbsSpikeTraceRecord), 1, reader->file) != 1)
+      || (SBS_SPIKE_TRACE_LAYERS <= record->layer))
+    return 0;
+
+  count = (size_t) record->rows * record->columns;
+
+  if (reader->payload_size < record->size)
+  {
+    free(reader->payload);
+    reader->payload = malloc(record->size);
+    reader->payload_size = (reader->payload != NULL) ? record->size : 0;
+  }
+
+  if (reader->spike_size < count)
+  {
+    free(reader->spike);
+    reader->spike = malloc(count * sizeof(uint16_t));
+    reader->spike_size = (reader->spike != NULL) ? count : 0;
+  }
+
+  if ((reader->payload_size < record->size) || (reader->spike_size < count)
+      || (fread(reader->payload, 1, record->size, reader->file) != record->size))
+    return 0;
+
+  switch (record->encoding)
+  {
+    case TRACE_RAW:
+      decoded = (record->size == count * sizeof(uint16_t));
+      if (decoded)
+        memcpy(reader->spike, reader->payload, record->size);
+      break;
+    case TRACE_DELTA:
+    {
+      uint16_t * previous = SbsSpikeTrace_previous(&reader->previous[record->layer],
+                                                   &reader->previous_size[record->layer],
+                                                   count);
+      decoded = (previous != NULL)
+             && SbsSpikeTrace_decodeDelta(reader->payload, record->size,
+                                          reader->spike, previous, count);
+      break;
+    }
+    case TRACE_PACKED:
+      decoded = SbsSpikeTrace_decodePacked(reader->payload, record->size,
+                                           reader->spike, count);
+      break;
+  }
+
+  *spike = reader->spike;
+
+  return decoded;
+}
+
+#endif
+/*****************************************************************************/
@@ -0,0 +1,24 @@
+/*
+ * sbs_neural_network_golden.h
+ *
+ *  Generated by sbs_neural_network_test --generate
+ */
+
+#ifndef SBS_NEURAL_NETWORK_GOLDEN_H_
+#define SBS_NEURAL_NETWORK_GOLDEN_H_
+
+/* 2 patterns, 200 cycles, seed 666 */
+static const SbsTestGolden SbsTest_golden =
+{
+  {
+    { 0x3E0AA03F, 0x3D0F1F9A, 0x3E2CDC50, 0x3E4747A9, 0x3DA931F7, 0x3C936BBD, 0x3CA50ACD, 0x3D7C8882, 0x3E6DBCEC, 0x3D53B3B3 },
+    { 0x3E80F893, 0x3DCC6731, 0x3E4BBCFE, 0x3DC3D89B, 0x3D65FD09, 0x3D2E2269, 0x3D8FC5F3, 0x3D1A90D9, 0x3DB86469, 0x3D69C268 }
+  },
+  { 8, 0 },
+  {
+    { 0x440E7AC3, 0x231B7CA3, 0x2C5F41B2, 0x6C7126B2, 0x4E1CB324, 0xDDF936F6 },
+    { 0x91F25DEB, 0x0DA7E06E, 0x60DF806F, 0xA77EB974, 0x4E9092A7, 0xFD95E7A5 }
+  }
+};
+
+#endif /* SBS_NEURAL_NETWORK_GOLDEN_H_ */
@@ -0,0 +1,1038 @@
+/*
+ * sbs_neural_network_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ *
+ *  Golden-output regression tests. The MNIST topology runs with synthetic
+ *  weights and inputs drawn from fixed seeds. The deterministic paths must
+ *  reproduce sbs_neural_network_golden.h bit for bit. The approximate ones
+ *  (different update order, pruned weights, sparse states) round differently,
+ *  and a single flipped spike sends the sampling on another trajectory, so
+ *  they run a short continuation of the golden run, from its states and
+ *  draws. Their spikes, layer by layer, and their output vectors must stay
+ *  within a fraction of the spread of continuations with other draws. A
+ *  layer whose update is disabled must not.
+ *
+ *  Usage: sbs_neural_network_test              runs the suite, returns the failures
+ *         sbs_neural_network_test --generate   prints a new golden header
+ *
+ *  The golden data assumes IEEE single precision without contraction into
+ *  fused multiply-adds (e.g. -ffp-contract=off where FMA is available).
+ */
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+#include "float.h"
+
+#include "sbs_neural_network.h"
+#include "sbs_spike_trace.h"
+#include "mt19937int.h"
+#include "buffered_file.h"
+
+#define SBS_TEST_LAYERS       7
+#define SBS_TEST_CLASSES      10
+#define SBS_TEST_PATTERNS     2
+#define SBS_TEST_CYCLES       200
+#define SBS_TEST_SHORT_CYCLES 20
+#define SBS_TEST_SEED         666
+#define SBS_TEST_SPREAD_SEEDS 3       /* Continuations with other draws bounding the approximate paths */
+#define SBS_TEST_SPREAD_MARGIN 0.5    /* Of their mean L1 distance of the output vectors */
+#define SBS_TEST_SPIKE_MARGIN 0.15    /* Of their mean fraction of changed spikes, per layer */
+#define SBS_TEST_PRUNE_THRESHOLD 1e-3f /* Above the small half of the synthetic weights */
+#define SBS_TEST_SPARSE_STATE 1e-3f   /* Drops about 2% of the weight reads */
+#define SBS_TEST_TRACE_FILE   "sbs_neural_network_test_trace.bin"
+#define SBS_TEST_AUTOTUNE_FILE "sbs_neural_network_test_autotune.txt"
+#define SBS_TEST_INPUT_FILE   "sbs_neural_network_test_input.bin"
+#define SBS_TEST_BLOCK_SIZE   500     /* Splits the neuron vectors across blocks */
+
+/* Dense MNIST topology, one x86-64 core at -O2: 1926 to 2190 cycles/s over three runs.
+ * The floor allows half of it, for slower hosts and noise; override with -D */
+#ifndef SBS_TEST_MIN_CYCLES_PER_SECOND
+#define SBS_TEST_BASELINE_CYCLES_PER_SECOND 2000
+#define SBS_TEST_MIN_CYCLES_PER_SECOND (SBS_TEST_BASELINE_CYCLES_PER_SECOND / 2)
+#endif
+
+#define SBS_TEST_INPUT_SIZE   (24 * 24 * 50 * sizeof(NeuronState) + 1)
+#define SBS_TEST_POSITIONS    (24 * 24) /* Of the largest spiking layer */
+
+typedef struct
+{
+  uint32_t output[SBS_TEST_PATTERNS][SBS_TEST_CLASSES];        /* NeuronState bits */
+  uint8_t  inferred_output[SBS_TEST_PATTERNS];
+  uint32_t spike_hash[SBS_TEST_PATTERNS][SBS_TEST_LAYERS - 1]; /* FNV-1a of every spike */
+} SbsTestGolden;
+
+#include "sbs_neural_network_golden.h"
+
+typedef struct
+{
+  SbsContext * context;
+  SbsNetwork * network;
+  SbsLayer *   layer[SBS_TEST_LAYERS];
+} SbsTestModel;
+
+/* Checkpoints of the golden run, one per pattern */
+typedef struct
+{
+  void * snapshot[SBS_TEST_PATTERNS];
+  size_t size[SBS_TEST_PATTERNS];
+} SbsTestWarmStart;
+
+/* Spikes of a continuation, layer by layer, every pattern in turn */
+typedef struct
+{
+  uint16_t spike[SBS_TEST_LAYERS - 1][SBS_TEST_PATTERNS * SBS_TEST_SHORT_CYCLES * SBS_TEST_POSITIONS];
+  size_t   count[SBS_TEST_LAYERS - 1];
+} SbsTestSpikes;
+
+typedef struct
+{
+  double output;                       /* Mean L1 distance of the output vectors */
+  double spikes[SBS_TEST_LAYERS - 1];  /* Mean fraction of changed spikes */
+} SbsTestSpread;
+
+static const struct
+{
+  const char * file_name;
+  uint16_t     rows;
+  uint16_t     columns;
+} SbsTest_weights[SBS_TEST_LAYERS - 1] =
+{
+  { "sbs_test_W_X_H1.bin",  2 * 5 * 5,  32 },
+  { "sbs_test_W_H1_H2.bin", 32 * 2 * 2, 32 },
+  { "sbs_test_W_H2_H3.bin", 32 * 5 * 5, 64 },
+  { "sbs_test_W_H3_H4.bin", 64 * 2 * 2, 64 },
+  { "sbs_test_W_H4_H5.bin", 64 * 4 * 4, 1024 },
+  { "sbs_test_W_H5_HY.bin", 1024,       SBS_TEST_CLASSES }
+};
+
+static uint8_t SbsTest_input[SBS_TEST_PATTERNS][SBS_TEST_INPUT_SIZE];
+static int     SbsTest_failures;
+static uint32_t SbsTest_seed = SBS_TEST_SEED;
+static size_t  SbsTest_arenaSize;   /* Of the models made after, 0: the planned size */
+static uint8_t SbsTest_sampling;    /* SbsSampling of the models made after */
+static size_t  SbsTest_prunedSize;  /* Sparse bytes SBS_TEST_PRUNE_THRESHOLD leaves */
+static size_t  SbsTest_keptWeights;
+
+static SbsTestSpikes SbsTest_referenceSpikes;
+static SbsTestSpikes SbsTest_spikes;
+
+static const float SbsTest_epsilon[SBS_TEST_LAYERS] =
+{
+  0.0f, 0.1, 0.1 / 4.0, 0.1 / 25.0, 0.1 / 4.0, 0.1 / 16.0, 0.1
+};
+
+/*****************************************************************************/
+
+static float SbsTest_random(MT19937 * random)
+{
+  return (float) MT19937_genrand(random) / (float) 0xFFFFFFFF;
+}
+
+/* Half of the weights small, as in trained layers. Counts the weights kept by
+ * SBS_TEST_PRUNE_THRESHOLD and their SparseMatrix size: 32-bit row offsets,
+ * a 16-bit column index and a value per weight */
+static int SbsTest_writeWeights(void)
+{
+  MT19937 random;
+  int     i;
+
+  MT19937_sgenrand(&random, SBS_TEST_SEED);
+
+  SbsTest_prunedSize  = 0;
+  SbsTest_keptWeights = 0;
+
+  for (i = 0; i < SBS_TEST_LAYERS - 1; i ++)
+  {
+    FILE * file = fopen(SbsTest_weights[i].file_name, "wb");
+    size_t n;
+
+    if (file == NULL) return 0;
+
+    for (n = 0; n < (size_t) SbsTest_weights[i].rows * SbsTest_weights[i].columns; n ++)
+    {
+      float weight = SbsTest_random(&random);
+      if (SbsTest_random(&random) < 0.5f) weight *= 1e-4f;
+      fwrite(&weight, sizeof(weight), 1, file);
+      SbsTest_keptWeights += (SBS_TEST_PRUNE_THRESHOLD < weight);
+    }
+
+    fclose(file);
+
+    SbsTest_prunedSize += ((size_t) SbsTest_weights[i].rows + 1) * sizeof(uint32_t);
+  }
+
+  SbsTest_prunedSize += SbsTest_keptWeights * (sizeof(uint16_t) + sizeof(float));
+
+  return 1;
+}
+
+/* Normalized random populations in the input file layout, label last */
+static void SbsTest_generateInput(void)
+{
+  MT19937 random;
+  int     pattern;
+
+  MT19937_sgenrand(&random, SBS_TEST_SEED + 1);
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    NeuronState * data = (NeuronState *) SbsTest_input[pattern];
+    int position;
+    int neuron;
+
+    for (position = 0; position < 24 * 24; position ++)
+    {
+      float sum = 0.0f;
+
+      for (neuron = 0; neuron < 50; neuron ++)
+      {
+        float h = SbsTest_random(&random);
+        data[position * 50 + neuron] = h * h * h * h;
+        sum += data[position * 50 + neuron];
+      }
+
+      for (neuron = 0; neuron < 50; neuron ++)
+        data[position * 50 + neuron] /= sum;
+    }
+
+    SbsTest_input[pattern][SBS_TEST_INPUT_SIZE - 1] = 1 + pattern % SBS_TEST_CLASSES;
+  }
+}
+
+static SbsLayer * SbsTest_newLayer(SbsLayer * layer, float epsilon, int weights)
+{
+  if (0 <= weights)
+  {
+    layer->setEpsilon(layer, epsilon);
+    layer->giveWeights(layer, sbs_new.WeightMatrix(SbsTest_weights[weights].rows,
+                                                   SbsTest_weights[weights].columns,
+                                                   (char *) SbsTest_weights[weights].file_name));
+  }
+
+  return layer;
+}
+
+/* MNIST topology, see sbs_app.c, in an arena of the planned size */
+static void SbsTest_newModel(SbsTestModel * model)
+{
+  SbsLayer ** layer = model->layer;
+  int         i;
+
+  layer[0] = SbsTest_newLayer(sbs_new.InputLayer(24, 24, 50), SbsTest_epsilon[0], -1);
+  layer[1] = SbsTest_newLayer(sbs_new.ConvolutionLayer(24, 24, 32, 1, ROW_SHIFT, 50), SbsTest_epsilon[1], 0);
+  layer[2] = SbsTest_newLayer(sbs_new.PoolingLayer(12, 12, 32, 2, COLUMN_SHIFT, 32), SbsTest_epsilon[2], 1);
+  layer[3] = SbsTest_newLayer(sbs_new.ConvolutionLayer(8, 8, 64, 5, COLUMN_SHIFT, 32), SbsTest_epsilon[3], 2);
+  layer[4] = SbsTest_newLayer(sbs_new.PoolingLayer(4, 4, 64, 2, COLUMN_SHIFT, 64), SbsTest_epsilon[4], 3);
+  layer[5] = SbsTest_newLayer(sbs_new.FullyConnectedLayer(1024, 4, ROW_SHIFT, 64), SbsTest_epsilon[5], 4);
+  layer[6] = SbsTest_newLayer(sbs_new.OutputLayer(SBS_TEST_CLASSES, ROW_SHIFT, 0), SbsTest_epsilon[6], 5);
+
+  model->context = sbs_new.Context(SbsTest_arenaSize ? SbsTest_arenaSize
+                                                    : sbs_new.MemoryPlan(layer, SBS_TEST_LAYERS, NULL),
+                                   SBS_TEST_SEED);
+  model->context->setOption(model->context, PROGRESS_INTERVAL, 0);
+  model->context->setOption(model->context, SAMPLING, SbsTest_sampling);
+  model->network = sbs_new.Network(model->context);
+
+  for (i = 0; i < SBS_TEST_LAYERS; i ++)
+    model->network->giveLayer(model->network, layer[i]);
+}
+
+/* The planned arena holds every layer buffer, aligned */
+static int SbsTest_memoryPlan(SbsTestModel * model, char * detail)
+{
+  SbsLayerMemory report[SBS_TEST_LAYERS];
+  NeuronState *  output_vector;
+  uint16_t       output_vector_size;
+  size_t         heap_size = 0;
+  size_t         total;
+  int            i;
+
+  total = model->network->getMemoryReport(model->network, report, SBS_TEST_LAYERS);
+  model->network->getOutputVector(model->network, &output_vector, &output_vector_size);
+
+  for (i = 0; i < SBS_TEST_LAYERS; i ++)
+    heap_size += report[i].heap_bytes;
+
+  sprintf(detail, "%lu bytes, %lu on the heap", (unsigned long) total, (unsigned long) heap_size);
+
+  return (heap_size == 0)
+      && (total == sbs_new.MemoryPlan(model->layer, SBS_TEST_LAYERS, NULL))
+      && (report[0].state_bytes == 24 * 24 * 50 * sizeof(NeuronState))
+      && (report[2].spike_bytes == 12 * 12 * sizeof(uint16_t))
+      && (report[5].weight_bytes == 64 * 4 * 4 * 1024 * sizeof(float))
+      && (((uintptr_t) output_vector & (SBS_MEMORY_ALIGNMENT - 1)) == 0);
+}
+
+static void SbsTest_deleteModel(SbsTestModel * model)
+{
+  model->network->delete(&model->network);
+  model->context->delete(&model->context);
+}
+
+static double SbsTest_now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+static void SbsTest_readOutput(SbsNetwork * network, SbsTestGolden * result, int pattern)
+{
+  NeuronState * output_vector;
+  uint16_t      output_vector_size;
+  int           i;
+
+  network->getOutputVector(network, &output_vector, &output_vector_size);
+
+  for (i = 0; (i < output_vector_size) && (i < SBS_TEST_CLASSES); i ++)
+  {
+    NeuronState h = output_vector[i]; /* Ensure data alignment */
+    memcpy(&result->output[pattern][i], &h, sizeof(h));
+  }
+
+  result->inferred_output[pattern] = network->getInferredOutput(network);
+}
+
+/* FNV-1a of the spikes of every layer, read back from the trace */
+static void SbsTest_hashTrace(SbsTestGolden * result, int pattern)
+{
+  SbsSpikeTraceReader * reader = SbsSpikeTraceReader_new(SBS_TEST_TRACE_FILE);
+  SbsSpikeTraceRecord   record;
+  const uint16_t *      spike;
+  int                   layer;
+  size_t                i;
+
+  for (layer = 0; layer < SBS_TEST_LAYERS - 1; layer ++)
+    result->spike_hash[pattern][layer] = 2166136261u;
+
+  if (reader == NULL) return;
+
+  while (SbsSpikeTraceReader_next(reader, &record, &spike))
+    if (record.layer < SBS_TEST_LAYERS - 1)
+      for (i = 0; i < (size_t) record.rows * record.columns; i ++)
+      {
+        uint32_t * hash = &result->spike_hash[pattern][record.layer];
+        *hash = (*hash ^ (spike[i] & 0xFF)) * 16777619u;
+        *hash = (*hash ^ (spike[i] >> 8)) * 16777619u;
+      }
+
+  SbsSpikeTraceReader_delete(&reader);
+}
+
+/* Input loaded from a file through 'backend' against the same bytes from
+ * memory, compared as checkpoints of the whole network */
+static int SbsTest_loadInputFile(SbsTestModel * model, BufferedFileBackend backend)
+{
+  SbsNetwork * network = model->network;
+  FILE *       file = fopen(SBS_TEST_INPUT_FILE, "wb");
+  size_t       size;
+  uint8_t *    expected;
+  uint8_t *    loaded;
+  int          passed;
+
+  if (file == NULL) return 0;
+  fwrite(SbsTest_input[1], 1, SBS_TEST_INPUT_SIZE, file);
+  fclose(file);
+
+  network->reset(network);
+  network->loadInputBuffer(network, SbsTest_input[1], SBS_TEST_INPUT_SIZE);
+  size = network->checkpoint(network, NULL, 0);
+  expected = malloc(size);
+  loaded = malloc(size);
+  network->checkpoint(network, expected, size);
+
+  network->loadInputBuffer(network, SbsTest_input[0], SBS_TEST_INPUT_SIZE);
+  BufferedFile_setDefault(backend, SBS_TEST_BLOCK_SIZE);
+  passed = network->loadInput(network, SBS_TEST_INPUT_FILE);
+  BufferedFile_setDefault(BUFFERED_FILE_PREAD, 0);
+  network->checkpoint(network, loaded, size);
+
+  passed = passed && (memcmp(expected, loaded, size) == 0);
+
+  free(expected);
+  free(loaded);
+  remove(SBS_TEST_INPUT_FILE);
+
+  /* A missing file is reported */
+  passed = passed && !network->loadInput(network, SBS_TEST_INPUT_FILE);
+
+  return passed;
+}
+
+/* Runs every pattern from the same seed. 'split' > 0 runs it as two steps,
+ * checkpointing after 'split' cycles and resuming on a second model */
+static double SbsTest_run(SbsTestModel * model, SbsTestGolden * result, uint16_t cycles,
+                          int trace, uint16_t split)
+{
+  SbsNetwork * network = model->network;
+  double       time = 0.0;
+  double       start;
+  int          pattern;
+
+  memset(result, 0x00, sizeof(SbsTestGolden));
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    SbsSpikeTrace * spike_trace = trace ? SbsSpikeTrace_new(SBS_TEST_TRACE_FILE, 1 << 20, TRACE_RAW) : NULL;
+
+    model->context->seed(model->context, SbsTest_seed);
+    network->loadInputBuffer(network, SbsTest_input[pattern], SBS_TEST_INPUT_SIZE);
+    network->setSpikeTrace(network, spike_trace);
+
+    start = SbsTest_now();
+
+    if (split == 0)
+      network->updateCycle(network, cycles);
+    else
+    {
+      SbsTestModel resumed;
+      size_t       size;
+      void *       snapshot;
+
+      network->reset(network);
+      network->step(network, split);
+
+      size = network->checkpoint(network, NULL, 0);
+      snapshot = malloc(size);
+      network->checkpoint(network, snapshot, size);
+
+      SbsTest_newModel(&resumed);
+      resumed.network->restore(resumed.network, snapshot, size);
+      resumed.network->setSpikeTrace(resumed.network, spike_trace);
+      resumed.network->step(resumed.network, cycles - split);
+      SbsTest_readOutput(resumed.network, result, pattern);
+      SbsTest_deleteModel(&resumed);
+
+      free(snapshot);
+    }
+
+    time += SbsTest_now() - start;
+
+    network->setSpikeTrace(network, NULL);
+
+    if (split == 0)
+      SbsTest_readOutput(network, result, pattern);
+
+    if (spike_trace != NULL)
+    {
+      SbsSpikeTrace_delete(&spike_trace);
+      SbsTest_hashTrace(result, pattern);
+      remove(SBS_TEST_TRACE_FILE);
+    }
+  }
+
+  return time;
+}
+
+/*****************************************************************************/
+
+static void SbsTest_report(const char * name, int passed, const char * detail)
+{
+  printf(" [%s] %-28s %s\n", passed ? "PASS" : "FAIL", name, detail);
+  SbsTest_failures += !passed;
+}
+
+static void SbsTest_compareExact(const char * name, SbsTestGolden * result, int spikes)
+{
+  char detail[80] = "";
+  int  passed = (memcmp(result->output, SbsTest_golden.output, sizeof(result->output)) == 0)
+             && (memcmp(result->inferred_output, SbsTest_golden.inferred_output,
+                        sizeof(result->inferred_output)) == 0);
+
+  if (!passed)
+    sprintf(detail, "output vectors differ");
+  else if (spikes && memcmp(result->spike_hash, SbsTest_golden.spike_hash, sizeof(result->spike_hash)))
+  {
+    passed = 0;
+    sprintf(detail, "spike trains differ");
+  }
+
+  SbsTest_report(name, passed, detail);
+}
+
+/* Mean L1 distance of the output vectors */
+static double SbsTest_distance(const SbsTestGolden * result, const SbsTestGolden * reference)
+{
+  double distance = 0.0;
+  int    pattern;
+  int    i;
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+    for (i = 0; i < SBS_TEST_CLASSES; i ++)
+    {
+      float h;
+      float g;
+      memcpy(&h, &result->output[pattern][i], sizeof(h));
+      memcpy(&g, &reference->output[pattern][i], sizeof(g));
+      distance += (h < g) ? g - h : h - g;
+    }
+
+  return distance / SBS_TEST_PATTERNS;
+}
+
+/* Golden runs, checkpointed at their end */
+static int SbsTest_warmStart(SbsTestModel * model, SbsTestWarmStart * warm)
+{
+  SbsNetwork * network = model->network;
+  int          pattern;
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    model->context->seed(model->context, SbsTest_seed);
+    network->loadInputBuffer(network, SbsTest_input[pattern], SBS_TEST_INPUT_SIZE);
+    network->updateCycle(network, SBS_TEST_CYCLES);
+
+    warm->size[pattern] = network->checkpoint(network, NULL, 0);
+    warm->snapshot[pattern] = malloc(warm->size[pattern]);
+    if (warm->snapshot[pattern] == NULL) return 0;
+    network->checkpoint(network, warm->snapshot[pattern], warm->size[pattern]);
+  }
+
+  return 1;
+}
+
+/* SBS_TEST_SHORT_CYCLES more cycles of every golden run, with the draws of
+ * 'seed' (0: the checkpointed ones), recording the output and the spikes */
+static void SbsTest_continue(SbsTestModel * model, SbsTestWarmStart * warm, uint32_t seed,
+                             SbsTestGolden * result, SbsTestSpikes * spikes)
+{
+  SbsNetwork * network = model->network;
+  int          pattern;
+
+  memset(result, 0x00, sizeof(SbsTestGolden));
+  memset(spikes->count, 0x00, sizeof(spikes->count));
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    SbsSpikeTrace *       spike_trace = SbsSpikeTrace_new(SBS_TEST_TRACE_FILE, 1 << 20, TRACE_RAW);
+    SbsSpikeTraceReader * reader;
+    SbsSpikeTraceRecord   record;
+    const uint16_t *      spike;
+
+    network->restore(network, warm->snapshot[pattern], warm->size[pattern]);
+    if (seed != 0)
+      model->context->seed(model->context, seed);
+
+    network->setSpikeTrace(network, spike_trace);
+    network->step(network, SBS_TEST_SHORT_CYCLES);
+    network->setSpikeTrace(network, NULL);
+    SbsTest_readOutput(network, result, pattern);
+
+    if (spike_trace == NULL) continue;
+    SbsSpikeTrace_delete(&spike_trace);
+
+    reader = SbsSpikeTraceReader_new(SBS_TEST_TRACE_FILE);
+    while ((reader != NULL) && SbsSpikeTraceReader_next(reader, &record, &spike))
+    {
+      size_t size = (size_t) record.rows * record.columns;
+
+      if ((record.layer < SBS_TEST_LAYERS - 1)
+          && (spikes->count[record.layer] + size <= sizeof(spikes->spike[0]) / sizeof(uint16_t)))
+      {
+        memcpy(&spikes->spike[record.layer][spikes->count[record.layer]], spike, size * sizeof(uint16_t));
+        spikes->count[record.layer] += size;
+      }
+    }
+    SbsSpikeTraceReader_delete(&reader);
+    remove(SBS_TEST_TRACE_FILE);
+  }
+}
+
+/* Fraction of the spikes of 'layer' that differ from the reference continuation */
+static double SbsTest_changedSpikes(SbsTestSpikes * spikes, int layer)
+{
+  size_t changed = 0;
+  size_t i;
+
+  if ((spikes->count[layer] == 0) || (spikes->count[layer] != SbsTest_referenceSpikes.count[layer]))
+    return 1.0;
+
+  for (i = 0; i < spikes->count[layer]; i ++)
+    changed += (spikes->spike[layer][i] != SbsTest_referenceSpikes.spike[layer][i]);
+
+  return (double) changed / spikes->count[layer];
+}
+
+/* How far continuations with other draws go from the reference one */
+static void SbsTest_spread(SbsTestModel * model, SbsTestWarmStart * warm,
+                           SbsTestGolden * reference, SbsTestSpread * spread)
+{
+  SbsTestGolden result;
+  int           i;
+  int           layer;
+
+  memset(spread, 0x00, sizeof(SbsTestSpread));
+
+  for (i = 1; i <= SBS_TEST_SPREAD_SEEDS; i ++)
+  {
+    SbsTest_continue(model, warm, SBS_TEST_SEED + i, &result, &SbsTest_spikes);
+    spread->output += SbsTest_distance(&result, reference) / SBS_TEST_SPREAD_SEEDS;
+
+    for (layer = 1; layer < SBS_TEST_LAYERS - 1; layer ++)
+      spread->spikes[layer] += SbsTest_changedSpikes(&SbsTest_spikes, layer) / SBS_TEST_SPREAD_SEEDS;
+  }
+}
+
+/* 1 when the continuation stays within the margins of 'spread', 'detail'
+ * tells the largest fraction of the spread it took */
+static int SbsTest_withinSpread(SbsTestGolden * result, SbsTestGolden * reference,
+                                SbsTestSpread * spread, char * detail)
+{
+  double output = SbsTest_distance(result, reference) / spread->output;
+  double spikes = 0.0;
+  int    worst = 1;
+  int    layer;
+
+  for (layer = 1; layer < SBS_TEST_LAYERS - 1; layer ++)
+  {
+    double changed = SbsTest_changedSpikes(&SbsTest_spikes, layer) / spread->spikes[layer];
+
+    if (spikes < changed)
+    {
+      spikes = changed;
+      worst = layer;
+    }
+  }
+
+  sprintf(detail, "output %.3f, spikes %.3f (layer %d) of spread", output, spikes, worst);
+
+  return (output <= SBS_TEST_SPREAD_MARGIN) && (spikes <= SBS_TEST_SPIKE_MARGIN);
+}
+
+/* Weight bytes read by every layer in the last run */
+static uint64_t SbsTest_weightBytes(SbsTestModel * model)
+{
+  SbsLayerTelemetry telemetry;
+  uint64_t          bytes = 0;
+  int               i;
+
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+  {
+    model->network->getTelemetry(model->network, i, &telemetry);
+    bytes += telemetry.weight_bytes;
+  }
+
+  return bytes;
+}
+
+/* 'engaged' tells whether the mode did change the arithmetic */
+static void SbsTest_compareApproximate(const char * name, SbsTestGolden * result,
+                                       SbsTestGolden * reference, SbsTestSpread * spread,
+                                       int engaged)
+{
+  char detail[80];
+  int  passed = SbsTest_withinSpread(result, reference, spread, detail);
+
+  if (engaged)
+    SbsTest_report(name, passed, detail);
+  else
+    SbsTest_report(name, 0, "mode not engaged");
+}
+
+typedef struct
+{
+  SbsTestGolden * result;
+  int             pattern;
+} SbsTestCompletion;
+
+static void SbsTest_complete(void * data, SbsNetwork * network)
+{
+  SbsTestCompletion * completion = data;
+  SbsTest_readOutput(network, completion->result, completion->pattern);
+}
+
+/* Two runs of updateCycle(), the second one keeping every state with a
+ * warm start blend of 1: the same draws and arithmetic as a single run */
+static void SbsTest_runWarm(SbsTestModel * model, SbsTestGolden * result, uint16_t cycles,
+                            uint16_t split)
+{
+  SbsNetwork * network = model->network;
+  int          pattern;
+
+  memset(result, 0x00, sizeof(SbsTestGolden));
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    model->context->seed(model->context, SbsTest_seed);
+    network->loadInputBuffer(network, SbsTest_input[pattern], SBS_TEST_INPUT_SIZE);
+
+    network->setWarmStart(network, 0.0f);
+    network->updateCycle(network, split);
+    network->setWarmStart(network, 1.0f);
+    network->updateCycle(network, cycles - split);
+    network->setWarmStart(network, 0.0f);
+
+    SbsTest_readOutput(network, result, pattern);
+  }
+}
+
+/* A state below FLT_MIN survives a reset with a warm start blend of 1 */
+static int SbsTest_warmSmallState(SbsTestModel * model)
+{
+  SbsNetwork *  network = model->network;
+  NeuronState * output_vector;
+  uint16_t      output_vector_size;
+  NeuronState   h = FLT_MIN / 4.0f;
+  NeuronState   kept;
+
+  network->loadInputBuffer(network, SbsTest_input[0], SBS_TEST_INPUT_SIZE);
+  network->updateCycle(network, SBS_TEST_SHORT_CYCLES);
+
+  network->getOutputVector(network, &output_vector, &output_vector_size);
+  memcpy(output_vector, &h, sizeof(h));
+
+  network->setWarmStart(network, 1.0f);
+  network->reset(network);
+  network->setWarmStart(network, 0.0f);
+
+  network->getOutputVector(network, &output_vector, &output_vector_size);
+  memcpy(&kept, output_vector, sizeof(kept));
+
+  return memcmp(&kept, &h, sizeof(h)) == 0;
+}
+
+/* A weight file one weight short of the matrix must not load */
+static int SbsTest_shortWeights(void)
+{
+  static const char * file_name = "sbs_test_W_short.bin";
+  FILE *            file = fopen(file_name, "wb");
+  float             weight = 0.5f;
+  SbsWeightMatrix   weights;
+  int               i;
+
+  if (file == NULL)
+    return 0;
+
+  for (i = 0; i < 32 * 32 - 1; i ++)
+    fwrite(&weight, sizeof(weight), 1, file);
+
+  fclose(file);
+
+  weights = sbs_new.WeightMatrix(32, 32, (char *) file_name);
+  remove(file_name);
+
+  return (weights == NULL);
+}
+
+/* Every pattern in flight at once on a network of its own */
+static void SbsTest_runAsync(SbsTestGolden * result, uint16_t cycles)
+{
+  SbsTestModel      model[SBS_TEST_PATTERNS];
+  SbsTestCompletion completion[SBS_TEST_PATTERNS];
+  int               pattern;
+
+  memset(result, 0x00, sizeof(SbsTestGolden));
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    SbsTest_newModel(&model[pattern]);
+    model[pattern].network->loadInputBuffer(model[pattern].network, SbsTest_input[pattern],
+                                            SBS_TEST_INPUT_SIZE);
+    completion[pattern].result  = result;
+    completion[pattern].pattern = pattern;
+    model[pattern].network->submit(model[pattern].network, cycles, SbsTest_complete,
+                                   &completion[pattern]);
+  }
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    model[pattern].network->wait(model[pattern].network);
+    SbsTest_deleteModel(&model[pattern]);
+  }
+}
+
+static void SbsTest_printGolden(SbsTestGolden * golden)
+{
+  int pattern;
+  int i;
+
+  printf("/*\n * sbs_neural_network_golden.h\n *\n"
+         " *  Generated by sbs_neural_network_test --generate\n */\n\n"
+         "#ifndef SBS_NEURAL_NETWORK_GOLDEN_H_\n#define SBS_NEURAL_NETWORK_GOLDEN_H_\n\n"
+         "/* %d patterns, %d cycles, seed %d */\n"
+         "static const SbsTestGolden SbsTest_golden =\n{\n  {\n",
+         SBS_TEST_PATTERNS, SBS_TEST_CYCLES, SBS_TEST_SEED);
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    printf("    {");
+    for (i = 0; i < SBS_TEST_CLASSES; i ++)
+      printf("%s0x%08X", i ? ", " : " ", golden->output[pattern][i]);
+    printf(" }%s\n", (pattern < SBS_TEST_PATTERNS - 1) ? "," : "");
+  }
+
+  printf("  },\n  {");
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+    printf("%s%d", pattern ? ", " : " ", golden->inferred_output[pattern]);
+  printf(" },\n  {\n");
+
+  for (pattern = 0; pattern < SBS_TEST_PATTERNS; pattern ++)
+  {
+    printf("    {");
+    for (i = 0; i < SBS_TEST_LAYERS - 1; i ++)
+      printf("%s0x%08X", i ? ", " : " ", golden->spike_hash[pattern][i]);
+    printf(" }%s\n", (pattern < SBS_TEST_PATTERNS - 1) ? "," : "");
+  }
+
+  printf("  }\n};\n\n#endif /* SBS_NEURAL_NETWORK_GOLDEN_H_ */\n");
+}
+
+/*****************************************************************************/
+
+int main(int argc, char ** argv)
+{
+  SbsTestModel  model;
+  SbsTestGolden result;
+  SbsTestGolden reference;
+  SbsTestGolden random;
+  SbsAccelerator * device;
+  SbsTestWarmStart warm;
+  SbsTestSpread spread;
+  char          detail[120];
+  double        time;
+  uint64_t      dense_bytes;
+  size_t        dense_size;
+  size_t        size;
+  int           i;
+
+  if (!SbsTest_writeWeights())
+  {
+    printf("Unable to write the synthetic weights\n");
+    return 1;
+  }
+
+  SbsTest_generateInput();
+  SbsTest_newModel(&model);
+
+  for (i = 0; i < SBS_TEST_LAYERS - 1; i ++)
+    remove(SbsTest_weights[i].file_name);
+
+  if ((argc == 2) && (strcmp(argv[1], "--generate") == 0))
+  {
+    SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+    SbsTest_printGolden(&result);
+    SbsTest_deleteModel(&model);
+    return 0;
+  }
+
+  printf("\n Spike by Spike golden-output regression (%d patterns, %d cycles)\n\n",
+         SBS_TEST_PATTERNS, SBS_TEST_CYCLES);
+
+  /* Deterministic paths */
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+  SbsTest_compareExact("dense", &result, 1);
+
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 0, 0);
+  SbsTest_compareExact("dense, repeated", &result, 0);
+
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, SBS_TEST_CYCLES / 3);
+  SbsTest_compareExact("checkpoint and resume", &result, 1);
+
+  /* Resumed with its buffers on the heap, copied one by one */
+  SbsTest_arenaSize = SBS_MEMORY_ALIGNMENT;
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 0, SBS_TEST_CYCLES / 3);
+  SbsTest_arenaSize = 0;
+  SbsTest_compareExact("checkpoint, heap buffers", &result, 0);
+
+  SbsTest_runWarm(&model, &result, SBS_TEST_CYCLES, SBS_TEST_CYCLES / 3);
+  SbsTest_compareExact("warm start, blend 1", &result, 0);
+  SbsTest_report("warm start, small states", SbsTest_warmSmallState(&model), "");
+
+  SbsTest_report("memory plan", SbsTest_memoryPlan(&model, detail), detail);
+
+  /* Fused window updates: the raster order arithmetic, spikes included */
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setUpdateOrder(model.layer[i], WINDOW_ORDER);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+  SbsTest_compareExact("window order", &result, 1);
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setUpdateOrder(model.layer[i], RASTER_ORDER);
+
+  /* Tiled updates: every position keeps its update order, whatever the tile */
+  model.context->setOption(model.context, UPDATE_TILE, 3);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+  SbsTest_compareExact("update tiles", &result, 1);
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setUpdateOrder(model.layer[i], WINDOW_ORDER);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 0, 0);
+  SbsTest_compareExact("update tiles, window order", &result, 0);
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setUpdateOrder(model.layer[i], RASTER_ORDER);
+  model.context->setOption(model.context, UPDATE_TILE, 0);
+
+  /* States stored neuron by neuron, the input layer included */
+  for (i = 0; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setStateLayout(model.layer[i], NEURON_MAJOR);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+  SbsTest_compareExact("neuron-major states", &result, 1);
+  for (i = 0; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setStateLayout(model.layer[i], POSITION_MAJOR);
+
+  /* Updates offloaded to the reference device, computed in submit() and by
+   * worker threads. A queue shorter than the layers refuses some updates */
+  for (i = 0; i <= 3; i += 3)
+  {
+    device = SbsCpuAccelerator_new(i, 4);
+    model.network->setAccelerator(model.network, device);
+    SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+    model.network->setAccelerator(model.network, NULL);
+    device->delete(&device);
+    SbsTest_compareExact((i == 0) ? "accelerator, inline" : "accelerator, 3 workers", &result, 1);
+  }
+
+  SbsTest_runAsync(&result, SBS_TEST_CYCLES);
+  SbsTest_compareExact("asynchronous, network pool", &result, 0);
+
+  /* Every file backend, with blocks that split the reads */
+  for (i = BUFFERED_FILE_STDIO; i <= BUFFERED_FILE_FATFS; i ++)
+  {
+    static const char * backend_name[] = { "", "stdio", "pread", "mmap", "FatFs" };
+    SbsTest_report("input file", SbsTest_loadInputFile(&model, i), backend_name[i]);
+  }
+
+  /* Approximate paths, continuing the golden runs from their states and draws */
+  if (!SbsTest_warmStart(&model, &warm))
+  {
+    printf("Unable to checkpoint the golden runs\n");
+    return 1;
+  }
+  SbsTest_continue(&model, &warm, 0, &reference, &SbsTest_referenceSpikes);
+  SbsTest_spread(&model, &warm, &reference, &spread);
+
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setUpdateOrder(model.layer[i], WEIGHT_ROW_ORDER);
+  SbsTest_continue(&model, &warm, 0, &result, &SbsTest_spikes);
+  SbsTest_compareApproximate("weight row order", &result, &reference, &spread, 1);
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->setUpdateOrder(model.layer[i], RASTER_ORDER);
+
+  for (size = 0, dense_size = 0, i = 1; i < SBS_TEST_LAYERS; i ++)
+  {
+    size += model.layer[i]->pruneWeights(model.layer[i], SBS_TEST_PRUNE_THRESHOLD);
+    dense_size += (size_t) SbsTest_weights[i - 1].rows * SbsTest_weights[i - 1].columns * sizeof(float);
+  }
+  sprintf(detail, "%lu of %lu weights kept", (unsigned long) SbsTest_keptWeights,
+          (unsigned long) (dense_size / sizeof(float)));
+  SbsTest_report("sparse weights, pruned", size == SbsTest_prunedSize, detail);
+  SbsTest_continue(&model, &warm, 0, &result, &SbsTest_spikes);
+  SbsTest_compareApproximate("sparse weights", &result, &reference, &spread,
+                             (0 < size) && (size < dense_size));
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+    model.layer[i]->pruneWeights(model.layer[i], -1.0f);
+
+  /* Not on the fully connected layer, whose uniform state is below the threshold */
+  model.network->setTelemetry(model.network, TELEMETRY_WEIGHT_BYTES);
+  SbsTest_continue(&model, &warm, 0, &result, &SbsTest_spikes);
+  dense_bytes = SbsTest_weightBytes(&model);
+  for (i = 1; i < SBS_TEST_LAYERS - 2; i ++)
+    model.layer[i]->setSparseState(model.layer[i], SBS_TEST_SPARSE_STATE, 0);
+  model.network->setTelemetry(model.network, TELEMETRY_WEIGHT_BYTES);
+  SbsTest_continue(&model, &warm, 0, &result, &SbsTest_spikes);
+  SbsTest_compareApproximate("sparse state", &result, &reference, &spread,
+                             SbsTest_weightBytes(&model) < dense_bytes);
+  model.network->setTelemetry(model.network, 0);
+  for (i = 1; i < SBS_TEST_LAYERS - 2; i ++)
+    model.layer[i]->setSparseState(model.layer[i], -1.0f, 0);
+
+  /* A layer that no longer updates must fall outside the spread */
+  for (i = 1; i < SBS_TEST_LAYERS; i ++)
+  {
+    model.layer[i]->setEpsilon(model.layer[i], 0.0f);
+    SbsTest_continue(&model, &warm, 0, &result, &SbsTest_spikes);
+    model.layer[i]->setEpsilon(model.layer[i], SbsTest_epsilon[i]);
+    sprintf(detail, "layer %d, ", i);
+    SbsTest_report("update disabled, rejected",
+                   !SbsTest_withinSpread(&result, &reference, &spread, detail + strlen(detail)), detail);
+  }
+
+  for (i = 0; i < SBS_TEST_PATTERNS; i ++)
+    free(warm.snapshot[i]);
+
+  /* Modes switched off again */
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+  SbsTest_compareExact("dense, after mode changes", &result, 1);
+
+  /* Kernel variants chosen by timing, then again from the cache. Bit for bit
+   * only without fused multiply-adds, as the golden data */
+  model.network->autotune(model.network, SBS_TEST_AUTOTUNE_FILE);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+  SbsTest_compareExact("dense, autotuned", &result, 1);
+
+  model.network->autotune(model.network, SBS_TEST_AUTOTUNE_FILE);
+  remove(SBS_TEST_AUTOTUNE_FILE);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 0, 0);
+  SbsTest_compareExact("dense, autotune cache", &result, 0);
+
+  /* Independent chains: reproducible whatever the thread scheduling */
+  model.network->setEnsemble(model.network, 4);
+  SbsTest_run(&model, &reference, SBS_TEST_SHORT_CYCLES, 0, 0);
+  SbsTest_run(&model, &result, SBS_TEST_SHORT_CYCLES, 0, 0);
+  model.network->setEnsemble(model.network, 1);
+  SbsTest_report("ensemble, repeated",
+                 memcmp(result.output, reference.output, sizeof(result.output)) == 0, "");
+
+  /* Quasi-random sampling: other draws than SAMPLING_RANDOM, reproducible, and
+   * the default draws untouched afterwards */
+  SbsTest_run(&model, &random, SBS_TEST_SHORT_CYCLES, 1, 0);
+  for (i = SAMPLING_R1; i <= SAMPLING_ANTITHETIC; i ++)
+  {
+    model.context->setOption(model.context, SAMPLING, i);
+    SbsTest_run(&model, &reference, SBS_TEST_SHORT_CYCLES, 1, 0);
+    SbsTest_run(&model, &result, SBS_TEST_SHORT_CYCLES, 0, 0);
+    sprintf(detail, "mode %d", i);
+    SbsTest_report("sampling, changed",
+                   memcmp(reference.spike_hash, random.spike_hash, sizeof(random.spike_hash))
+                   && memcmp(reference.output, random.output, sizeof(random.output)), detail);
+    SbsTest_report("sampling, repeated",
+                   memcmp(result.output, reference.output, sizeof(result.output)) == 0, detail);
+
+    /* Resumed on a model that never ran, so the offsets come from the checkpoint */
+    SbsTest_sampling = i;
+    SbsTest_run(&model, &result, SBS_TEST_SHORT_CYCLES, 1, SBS_TEST_SHORT_CYCLES / 2);
+    SbsTest_sampling = SAMPLING_RANDOM;
+    SbsTest_report("sampling, resumed",
+                   (memcmp(result.output, reference.output, sizeof(result.output)) == 0)
+                   && (memcmp(result.spike_hash, reference.spike_hash, sizeof(result.spike_hash)) == 0),
+                   detail);
+  }
+  model.context->setOption(model.context, SAMPLING, SAMPLING_RANDOM);
+  SbsTest_run(&model, &result, SBS_TEST_CYCLES, 0, 0);
+  SbsTest_compareExact("dense, after sampling modes", &result, 0);
+
+  /* Throughput, timed without the trace */
+  time = SbsTest_run(&model, &result, SBS_TEST_CYCLES, 0, 0);
+  sprintf(detail, "%.0f cycles/s (minimum %d)",
+          SBS_TEST_PATTERNS * SBS_TEST_CYCLES / time, SBS_TEST_MIN_CYCLES_PER_SECOND);
+  SbsTest_report("throughput", SBS_TEST_MIN_CYCLES_PER_SECOND <= SBS_TEST_PATTERNS * SBS_TEST_CYCLES / time,
+                 detail);
+
+  SbsTest_deleteModel(&model);
+
+  SbsTest_report("short weight file", SbsTest_shortWeights(), "");
+
+  /* Weights used in place from a file mapping, as the large ones are */
+  if (SbsTest_writeWeights())
+  {
+    BufferedFile_setDefault(BUFFERED_FILE_MMAP, 0);
+    SbsTest_newModel(&model);
+    BufferedFile_setDefault(BUFFERED_FILE_PREAD, 0);
+
+    SbsTest_run(&model, &result, SBS_TEST_CYCLES, 1, 0);
+    SbsTest_compareExact("mapped weights", &result, 1);
+
+    SbsTest_deleteModel(&model);
+
+    for (i = 0; i < SBS_TEST_LAYERS - 1; i ++)
+      remove(SbsTest_weights[i].file_name);
+  }
+  else
+    SbsTest_report("mapped weights", 0, "unable to write the weights");
+
+  printf("\n %d failure%s\n", SbsTest_failures, (SbsTest_failures == 1) ? "" : "s");
+
+  return SbsTest_failures;
+}
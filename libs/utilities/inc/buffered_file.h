@@ -0,0 +1,76 @@
+/*
+ * buffered_file.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+#ifndef LIBS_UTILITIES_BUFFERED_FILE_H_
+#define LIBS_UTILITIES_BUFFERED_FILE_H_
+
+/* Sequential binary reads through one large aligned block buffer. Small reads
+ * are served from the buffer, reads of a block or more go straight to the
+ * destination. Backends: stdio, POSIX pread() with read-ahead hints, a
+ * memory mapping, and FatFs (the SD card on the board, ff_posix.h on Linux) */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+#define BUFFERED_FILE_BLOCK_SIZE (64 * 1024) /* Default transfer size */
+#define BUFFERED_FILE_ALIGNMENT  4096        /* Of the block buffer */
+
+/**************************** Type Definitions *******************************/
+
+typedef enum
+{
+  BUFFERED_FILE_DEFAULT, /* The process default, see BufferedFile_setDefault() */
+  BUFFERED_FILE_STDIO,
+  BUFFERED_FILE_PREAD,
+  BUFFERED_FILE_MMAP,
+  BUFFERED_FILE_FATFS    /* The only backend on the board */
+} BufferedFileBackend;
+
+typedef struct
+{
+  uint64_t files;
+  uint64_t reads;      /* BufferedFile_read() calls */
+  uint64_t transfers;  /* Backend reads: block fills and direct reads */
+  uint64_t bytes;      /* Bytes delivered */
+  double   time;       /* Seconds in BufferedFile_read() */
+} BufferedFileStatistics;
+
+typedef struct BufferedFile BufferedFile;
+
+/************************** Function Prototypes ******************************/
+
+/* Note: 'block_size' 0 takes the process default. Returns NULL when the file cannot be opened */
+BufferedFile * BufferedFile_new        (const char * file_name,
+                                        BufferedFileBackend backend,
+                                        size_t block_size);
+void           BufferedFile_delete     (BufferedFile ** file);
+/* Returns the bytes read, less than 'size' only at the end of the file or on an error */
+size_t         BufferedFile_read       (BufferedFile * file, void * data, size_t size);
+uint64_t       BufferedFile_getSize    (BufferedFile * file);
+/* Note: the whole file with BUFFERED_FILE_MMAP, valid until delete; NULL otherwise */
+const void *   BufferedFile_getMapping (BufferedFile * file);
+
+/* Note: used by the library loaders, BUFFERED_FILE_PREAD (FatFs on the board) and
+ * BUFFERED_FILE_BLOCK_SIZE unless changed */
+void           BufferedFile_setDefault (BufferedFileBackend backend, size_t block_size);
+
+/* Process totals over the files deleted so far */
+void           BufferedFile_getStatistics   (BufferedFileStatistics * statistics);
+void           BufferedFile_resetStatistics (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LIBS_UTILITIES_BUFFERED_FILE_H_ */
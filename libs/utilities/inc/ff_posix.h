@@ -0,0 +1,84 @@
+/*
+ * ff_posix.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+#ifndef LIBS_UTILITIES_FF_POSIX_H_
+#define LIBS_UTILITIES_FF_POSIX_H_
+
+/* Host stand-in for the FatFs file API (ff.h) over POSIX file descriptors, so
+ * the code paths of the board run and can be tested on Linux. Only the calls
+ * the libraries use are provided. Optionally, every f_read() is delayed like an
+ * SD card transfer: a command latency plus the bytes over a bandwidth */
+
+#ifndef USE_XILINX
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+#define FA_READ          0x01
+#define FA_WRITE         0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW    0x04
+#define FA_CREATE_ALWAYS 0x08
+#define FA_OPEN_ALWAYS   0x10
+#define FA_OPEN_APPEND   0x30
+
+#define f_size(fp) ((fp)->obj_size)
+#define f_tell(fp) ((fp)->fptr)
+#define f_eof(fp)  ((fp)->fptr == (fp)->obj_size)
+
+/**************************** Type Definitions *******************************/
+
+typedef unsigned int UINT;
+typedef uint8_t      BYTE;
+typedef char         TCHAR;
+typedef uint64_t     FSIZE_t;
+
+typedef enum
+{
+  FR_OK = 0,
+  FR_DISK_ERR,
+  FR_INT_ERR,
+  FR_NOT_READY,
+  FR_NO_FILE,
+  FR_NO_PATH,
+  FR_INVALID_NAME,
+  FR_DENIED,
+  FR_EXIST,
+  FR_INVALID_OBJECT
+} FRESULT;
+
+typedef struct
+{
+  int     fd;
+  FSIZE_t fptr;
+  FSIZE_t obj_size;
+} FIL;
+
+/************************** Function Prototypes ******************************/
+
+FRESULT f_open  (FIL * fp, const TCHAR * path, BYTE mode);
+FRESULT f_close (FIL * fp);
+FRESULT f_read  (FIL * fp, void * buff, UINT btr, UINT * br);
+FRESULT f_write (FIL * fp, const void * buff, UINT btw, UINT * bw);
+FRESULT f_lseek (FIL * fp, FSIZE_t ofs);
+
+/* Simulated card timing of every f_read(), 0 and 0 (default) for none */
+void    ff_posix_setTiming (double command_latency, double bytes_per_second);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* USE_XILINX */
+#endif /* LIBS_UTILITIES_FF_POSIX_H_ */
@@ -0,0 +1,389 @@
+/*
+ * buffered_file.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+/***************************** Include Files *********************************/
+#include "buffered_file.h"
+#include "miscellaneous.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#ifdef USE_XILINX
+#include "ff.h"
+#include "xtime_l.h"
+#else
+#include "ff_posix.h"
+#include "fcntl.h"
+#include "pthread.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#endif
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/**************************** Type Definitions *******************************/
+
+struct BufferedFile
+{
+  BufferedFileBackend backend;
+#ifdef USE_XILINX
+  FIL                 fil;
+#else
+  FIL                 fil;
+  FILE *              stream;
+  int                 fd;
+  uint8_t *           mapping;
+#endif
+  uint64_t            size;
+  uint64_t            offset;      /* Of the next backend read */
+  uint8_t *           allocation;
+  uint8_t *           buffer;      /* Aligned inside allocation */
+  size_t              block_size;
+  size_t              fill;        /* Valid bytes in buffer */
+  size_t              position;    /* Next byte to deliver from buffer */
+  BufferedFileStatistics statistics;
+};
+
+/************************** Constant Definitions *****************************/
+
+/************************** Variable Definitions *****************************/
+
+#ifdef USE_XILINX
+static BufferedFileBackend BufferedFile_defaultBackend = BUFFERED_FILE_FATFS;
+#else
+static BufferedFileBackend BufferedFile_defaultBackend = BUFFERED_FILE_PREAD;
+static pthread_mutex_t     BufferedFile_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static size_t              BufferedFile_defaultBlockSize = BUFFERED_FILE_BLOCK_SIZE;
+static BufferedFileStatistics BufferedFile_totals;
+
+/************************** Function Prototypes ******************************/
+
+/*****************************************************************************/
+
+static double BufferedFile_now (void)
+{
+#ifdef USE_XILINX
+  XTime time;
+  XTime_GetTime (&time);
+  return (double) time / (double) COUNTS_PER_SECOND;
+#else
+  struct timespec time;
+  clock_gettime (CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+/* One backend read at 'offset' */
+static size_t BufferedFile_transfer (BufferedFile * file, void * data, size_t size)
+{
+  size_t count = 0;
+
+  file->statistics.transfers ++;
+
+  switch (file->backend)
+  {
+#ifndef USE_XILINX
+    case BUFFERED_FILE_STDIO:
+      count = fread (data, 1, size, file->stream);
+      break;
+
+    case BUFFERED_FILE_PREAD:
+    {
+      ssize_t result;
+
+      while (count < size)
+      {
+        result = pread (file->fd, (uint8_t *) data + count, size - count,
+                        (off_t) (file->offset + count));
+        if (result <= 0) break;
+        count += (size_t) result;
+      }
+
+      /* Read-ahead: the kernel fetches the next block while this one is consumed */
+      posix_fadvise (file->fd, (off_t) (file->offset + count), (off_t) file->block_size,
+                     POSIX_FADV_WILLNEED);
+      break;
+    }
+
+    case BUFFERED_FILE_MMAP:
+      if (file->offset < file->size)
+      {
+        count = (file->size - file->offset < size) ? (size_t) (file->size - file->offset) : size;
+        memcpy (data, &file->mapping[file->offset], count);
+      }
+      break;
+#endif
+
+    case BUFFERED_FILE_FATFS:
+    default:
+    {
+      UINT read_size = 0;
+
+      /* f_read takes a UINT count */
+      while (count < size)
+      {
+        UINT chunk = (0x7FFFFFFF < size - count) ? 0x7FFFFFFF : (UINT) (size - count);
+
+        if ((f_read (&file->fil, (uint8_t *) data + count, chunk, &read_size) != FR_OK)
+            || (read_size == 0))
+          break;
+
+        count += read_size;
+      }
+      break;
+    }
+  }
+
+  file->offset += count;
+
+  return count;
+}
+
+BufferedFile * BufferedFile_new (const char * file_name,
+                                 BufferedFileBackend backend,
+                                 size_t block_size)
+{
+  BufferedFile * file;
+  int            opened = 0;
+
+  ASSERT(file_name != NULL);
+
+  if (file_name == NULL)
+    return NULL;
+
+  file = calloc (1, sizeof(BufferedFile));
+  ASSERT(file != NULL);
+
+  if (file == NULL)
+    return NULL;
+
+  file->backend    = (backend == BUFFERED_FILE_DEFAULT) ? BufferedFile_defaultBackend : backend;
+  file->block_size = (0 < block_size) ? block_size : BufferedFile_defaultBlockSize;
+
+#ifdef USE_XILINX
+  file->backend = BUFFERED_FILE_FATFS;
+#else
+  file->fd = -1;
+
+  if (file->backend == BUFFERED_FILE_STDIO)
+  {
+    file->stream = fopen (file_name, "rb");
+    opened = (file->stream != NULL);
+
+    if (opened)
+    {
+      /* The block buffer replaces the stdio one */
+      setvbuf (file->stream, NULL, _IONBF, 0);
+      fseek (file->stream, 0, SEEK_END);
+      file->size = (uint64_t) ftell (file->stream);
+      fseek (file->stream, 0, SEEK_SET);
+    }
+  }
+  else if ((file->backend == BUFFERED_FILE_PREAD) || (file->backend == BUFFERED_FILE_MMAP))
+  {
+    struct stat status;
+
+    file->fd = open (file_name, O_RDONLY);
+    opened = (file->fd != -1) && (fstat (file->fd, &status) == 0);
+
+    if (opened)
+    {
+      file->size = (uint64_t) status.st_size;
+
+      if (file->backend == BUFFERED_FILE_PREAD)
+        posix_fadvise (file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      else if (0 < file->size)
+      {
+        file->mapping = mmap (NULL, (size_t) file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+        opened = (file->mapping != MAP_FAILED);
+        if (!opened) file->mapping = NULL;
+      }
+    }
+  }
+  else
+#endif
+  {
+    file->backend = BUFFERED_FILE_FATFS;
+    opened = (f_open (&file->fil, file_name, FA_READ) == FR_OK);
+
+    if (opened)
+      file->size = f_size (&file->fil);
+  }
+
+  /* The mapping needs no block buffer */
+  if (opened && (file->backend != BUFFERED_FILE_MMAP))
+  {
+    file->allocation = malloc (file->block_size + BUFFERED_FILE_ALIGNMENT - 1);
+    ASSERT(file->allocation != NULL);
+    opened = (file->allocation != NULL);
+
+    if (opened)
+      file->buffer = (uint8_t *) (((uintptr_t) file->allocation + BUFFERED_FILE_ALIGNMENT - 1)
+                                  & ~(uintptr_t) (BUFFERED_FILE_ALIGNMENT - 1));
+  }
+
+  if (!opened)
+  {
+#ifndef USE_XILINX
+    if (file->stream != NULL) fclose (file->stream);
+    if (file->mapping != NULL) munmap (file->mapping, (size_t) file->size);
+    if (file->fd != -1) close (file->fd);
+    if (file->backend == BUFFERED_FILE_FATFS) f_close (&file->fil);
+#else
+    f_close (&file->fil);
+#endif
+    free (file->allocation);
+    free (file);
+    return NULL;
+  }
+
+  file->statistics.files = 1;
+
+  return file;
+}
+
+void BufferedFile_delete (BufferedFile ** file_ptr)
+{
+  BufferedFile * file;
+
+  ASSERT(file_ptr != NULL);
+
+  if ((file_ptr == NULL) || (*file_ptr == NULL))
+    return;
+
+  file = *file_ptr;
+
+#ifndef USE_XILINX
+  if (file->stream != NULL) fclose (file->stream);
+  if (file->mapping != NULL) munmap (file->mapping, (size_t) file->size);
+  if (file->fd != -1) close (file->fd);
+  if (file->backend == BUFFERED_FILE_FATFS) f_close (&file->fil);
+
+  pthread_mutex_lock (&BufferedFile_mutex);
+#else
+  f_close (&file->fil);
+#endif
+
+  BufferedFile_totals.files     += file->statistics.files;
+  BufferedFile_totals.reads     += file->statistics.reads;
+  BufferedFile_totals.transfers += file->statistics.transfers;
+  BufferedFile_totals.bytes     += file->statistics.bytes;
+  BufferedFile_totals.time      += file->statistics.time;
+
+#ifndef USE_XILINX
+  pthread_mutex_unlock (&BufferedFile_mutex);
+#endif
+
+  free (file->allocation);
+  free (file);
+  *file_ptr = NULL;
+}
+
+size_t BufferedFile_read (BufferedFile * file, void * data, size_t size)
+{
+  uint8_t * destination = data;
+  size_t    total = 0;
+  size_t    count;
+  double    start;
+
+  ASSERT(file != NULL);
+  ASSERT((data != NULL) || (size == 0));
+
+  if ((file == NULL) || (data == NULL))
+    return 0;
+
+  start = BufferedFile_now ();
+
+  while (total < size)
+  {
+    count = file->fill - file->position;
+
+    if (0 < count)
+    {
+      if (size - total < count) count = size - total;
+      memcpy (&destination[total], &file->buffer[file->position], count);
+      file->position += count;
+    }
+    else if ((file->buffer == NULL) || (file->block_size <= size - total))
+    {
+      /* Whole blocks bypass the buffer */
+      count = size - total;
+      if (file->buffer != NULL) count -= count % file->block_size;
+      count = BufferedFile_transfer (file, &destination[total], count);
+      if (count == 0) break;
+    }
+    else
+    {
+      file->position = 0;
+      file->fill = BufferedFile_transfer (file, file->buffer, file->block_size);
+      if (file->fill == 0) break;
+      continue;
+    }
+
+    total += count;
+  }
+
+  file->statistics.reads ++;
+  file->statistics.bytes += total;
+  file->statistics.time += BufferedFile_now () - start;
+
+  return total;
+}
+
+uint64_t BufferedFile_getSize (BufferedFile * file)
+{
+  ASSERT(file != NULL);
+  return (file != NULL) ? file->size : 0;
+}
+
+const void * BufferedFile_getMapping (BufferedFile * file)
+{
+  ASSERT(file != NULL);
+#ifdef USE_XILINX
+  return NULL;
+#else
+  return (file != NULL) ? file->mapping : NULL;
+#endif
+}
+
+void BufferedFile_setDefault (BufferedFileBackend backend, size_t block_size)
+{
+  if (backend != BUFFERED_FILE_DEFAULT)
+    BufferedFile_defaultBackend = backend;
+
+  BufferedFile_defaultBlockSize = (0 < block_size) ? block_size : BUFFERED_FILE_BLOCK_SIZE;
+}
+
+void BufferedFile_getStatistics (BufferedFileStatistics * statistics)
+{
+  ASSERT(statistics != NULL);
+
+  if (statistics == NULL)
+    return;
+
+#ifndef USE_XILINX
+  pthread_mutex_lock (&BufferedFile_mutex);
+#endif
+  *statistics = BufferedFile_totals;
+#ifndef USE_XILINX
+  pthread_mutex_unlock (&BufferedFile_mutex);
+#endif
+}
+
+void BufferedFile_resetStatistics (void)
+{
+#ifndef USE_XILINX
+  pthread_mutex_lock (&BufferedFile_mutex);
+#endif
+  memset (&BufferedFile_totals, 0x00, sizeof(BufferedFile_totals));
+#ifndef USE_XILINX
+  pthread_mutex_unlock (&BufferedFile_mutex);
+#endif
+}
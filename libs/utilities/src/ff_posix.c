@@ -0,0 +1,195 @@
+/*
+ * ff_posix.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Yarib Nevarez
+ */
+/***************************** Include Files *********************************/
+#ifndef USE_XILINX
+#include "ff_posix.h"
+#include "miscellaneous.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/stat.h"
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/**************************** Type Definitions *******************************/
+
+/************************** Constant Definitions *****************************/
+
+/************************** Variable Definitions *****************************/
+
+static double ff_posix_command_latency;
+static double ff_posix_bytes_per_second;
+
+/************************** Function Prototypes ******************************/
+
+/*****************************************************************************/
+
+static void ff_posix_delay (size_t bytes)
+{
+  double          delay = ff_posix_command_latency;
+  struct timespec time;
+
+  if (0.0 < ff_posix_bytes_per_second)
+    delay += bytes / ff_posix_bytes_per_second;
+
+  if (0.0 < delay)
+  {
+    time.tv_sec  = (time_t) delay;
+    time.tv_nsec = (long) ((delay - time.tv_sec) * 1e9);
+    while ((nanosleep (&time, &time) != 0) && (errno == EINTR));
+  }
+}
+
+static FRESULT ff_posix_result (int error)
+{
+  switch (error)
+  {
+    case ENOENT:  return FR_NO_FILE;
+    case ENOTDIR: return FR_NO_PATH;
+    case EACCES:
+    case EPERM:   return FR_DENIED;
+    case EEXIST:  return FR_EXIST;
+    default:      return FR_DISK_ERR;
+  }
+}
+
+FRESULT f_open (FIL * fp, const TCHAR * path, BYTE mode)
+{
+  struct stat status;
+  int         flags;
+
+  ASSERT(fp != NULL);
+  ASSERT(path != NULL);
+
+  if ((fp == NULL) || (path == NULL))
+    return FR_INVALID_OBJECT;
+
+  flags = ((mode & FA_READ) && (mode & FA_WRITE)) ? O_RDWR
+        : (mode & FA_WRITE) ? O_WRONLY : O_RDONLY;
+
+  if (mode & FA_CREATE_ALWAYS)          flags |= O_CREAT | O_TRUNC;
+  else if (mode & FA_CREATE_NEW)        flags |= O_CREAT | O_EXCL;
+  else if (mode & FA_OPEN_ALWAYS)       flags |= O_CREAT;
+
+  fp->fd = open (path, flags, 0644);
+
+  if (fp->fd == -1)
+    return ff_posix_result (errno);
+
+  fp->fptr     = 0;
+  fp->obj_size = (fstat (fp->fd, &status) == 0) ? (FSIZE_t) status.st_size : 0;
+
+  if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND)
+    fp->fptr = fp->obj_size;
+
+  return FR_OK;
+}
+
+FRESULT f_close (FIL * fp)
+{
+  ASSERT(fp != NULL);
+
+  if ((fp == NULL) || (fp->fd == -1))
+    return FR_INVALID_OBJECT;
+
+  close (fp->fd);
+  fp->fd = -1;
+
+  return FR_OK;
+}
+
+FRESULT f_read (FIL * fp, void * buff, UINT btr, UINT * br)
+{
+  ssize_t count;
+  UINT    total = 0;
+
+  ASSERT(fp != NULL);
+  ASSERT(br != NULL);
+
+  if ((fp == NULL) || (fp->fd == -1) || (br == NULL))
+    return FR_INVALID_OBJECT;
+
+  while (total < btr)
+  {
+    count = pread (fp->fd, (BYTE *) buff + total, btr - total, (off_t) (fp->fptr + total));
+
+    if (count < 0)
+    {
+      if (errno == EINTR) continue;
+      *br = total;
+      fp->fptr += total;
+      return FR_DISK_ERR;
+    }
+
+    if (count == 0)
+      break;
+
+    total += (UINT) count;
+  }
+
+  ff_posix_delay (total);
+
+  *br = total;
+  fp->fptr += total;
+
+  return FR_OK;
+}
+
+FRESULT f_write (FIL * fp, const void * buff, UINT btw, UINT * bw)
+{
+  ssize_t count;
+  UINT    total = 0;
+
+  ASSERT(fp != NULL);
+  ASSERT(bw != NULL);
+
+  if ((fp == NULL) || (fp->fd == -1) || (bw == NULL))
+    return FR_INVALID_OBJECT;
+
+  while (total < btw)
+  {
+    count = pwrite (fp->fd, (const BYTE *) buff + total, btw - total, (off_t) (fp->fptr + total));
+
+    if (count <= 0)
+    {
+      if ((count < 0) && (errno == EINTR)) continue;
+      break;
+    }
+
+    total += (UINT) count;
+  }
+
+  *bw = total;
+  fp->fptr += total;
+
+  if (fp->obj_size < fp->fptr)
+    fp->obj_size = fp->fptr;
+
+  return (total == btw) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_lseek (FIL * fp, FSIZE_t ofs)
+{
+  ASSERT(fp != NULL);
+
+  if ((fp == NULL) || (fp->fd == -1))
+    return FR_INVALID_OBJECT;
+
+  fp->fptr = ofs;
+
+  return FR_OK;
+}
+
+void ff_posix_setTiming (double command_latency, double bytes_per_second)
+{
+  ff_posix_command_latency  = (0.0 < command_latency) ? command_latency : 0.0;
+  ff_posix_bytes_per_second = (0.0 < bytes_per_second) ? bytes_per_second : 0.0;
+}
+
+#endif /* USE_XILINX */